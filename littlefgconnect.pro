@@ -45,11 +45,15 @@
 # ATOOLS_QUIET
 # Optional. Set this to "true" to avoid qmake messages.
 #
+# LITTLEFGCONNECT_TRACE
+# Optional. Set this to "true" to compile in trace zones. A Chrome trace JSON file is written when
+# disconnecting and on exit. Has no runtime cost if not set.
+#
 # =============================================================================
 # End of configuration documentation
 # =============================================================================
 
-QT += core gui xml network svg
+QT += core gui xml network svg websockets concurrent
 
 CONFIG += build_all c++14
 CONFIG -= debug_and_release debug_and_release_target
@@ -68,6 +72,7 @@ OPENSSL_PATH=$$(OPENSSL_PATH)
 GIT_PATH=$$(ATOOLS_GIT_PATH)
 DEPLOY_BASE=$$(DEPLOY_BASE)
 QUIET=$$(ATOOLS_QUIET)
+TRACE=$$(LITTLEFGCONNECT_TRACE)
 
 # =======================================================================
 # Fill defaults for unset
@@ -130,6 +135,8 @@ DEFINES += GIT_REVISION=$$GIT_REVISION
 DEFINES += QT_NO_CAST_FROM_BYTEARRAY
 DEFINES += QT_NO_CAST_TO_ASCII
 
+isEqual(TRACE, "true") : DEFINES += LFGC_TRACE
+
 # =======================================================================
 # Print values when running qmake
 
@@ -158,19 +165,68 @@ message(-----------------------------------)
 # Files
 
 SOURCES +=\
+  src/callsignindex.cpp \
   src/constants.cpp \
+  src/datagramrelay.cpp \
   src/fgconnect.cpp \
+  src/fieldreader.cpp \
+  src/flightrecorder.cpp \
+  src/flightrecordreader.cpp \
+  src/frameassembler.cpp \
+  src/inprocesshandler.cpp \
+  src/inputfilter.cpp \
   src/main.cpp \  
   src/mainwindow.cpp \
+  src/multiplayerlistener.cpp \
+  src/multiplayerprotocol.cpp \
+  src/onlinepresencefetcher.cpp \
+  src/onlinestatusparser.cpp \
   src/optionsdialog.cpp \
-  src/sharedmemorywriter.cpp
+  src/outputsink.cpp \
+  src/propertysubscriber.cpp \
+  src/publishscheduler.cpp \
+  src/sharedmemorywriter.cpp \
+  src/snapshotregion.cpp \
+  src/statusserver.cpp \
+  src/stringpool.cpp \
+  src/tracezone.cpp \
+  src/trackhistory.cpp \
+  src/trafficdecoder.cpp \
+  src/trafficpredictor.cpp \
+  src/trafficstore.cpp \
+  src/weathercache.cpp
 
 HEADERS  += \
+  src/callsignindex.h \
   src/constants.h \
+  src/datagramrelay.h \
   src/fgconnect.h \
+  src/fieldreader.h \
+  src/flightrecorder.h \
+  src/flightrecordreader.h \
+  src/frameassembler.h \
+  src/inprocesshandler.h \
+  src/inputfilter.h \
   src/mainwindow.h \
+  src/multiplayerlistener.h \
+  src/multiplayerprotocol.h \
+  src/onlinepresencefetcher.h \
+  src/onlinestatusparser.h \
   src/optionsdialog.h \
-  src/sharedmemorywriter.h
+  src/outputsink.h \
+  src/propertysubscriber.h \
+  src/publishscheduler.h \
+  src/sharedmemorywriter.h \
+  src/snapshotlayout.h \
+  src/snapshotregion.h \
+  src/statusserver.h \
+  src/stringpool.h \
+  src/tracezone.h \
+  src/trackhistory.h \
+  src/trafficdecoder.h \
+  src/trafficpredictor.h \
+  src/trafficstore.h \
+  src/weathercache.h
 
 FORMS    += mainwindow.ui \
   optionsdialog.ui
@@ -251,11 +307,13 @@ unix:!macx {
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libicudata.so*  $$DEPLOY_DIR_LIB &&
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libicui18n.so*  $$DEPLOY_DIR_LIB &&
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libicuuc.so*  $$DEPLOY_DIR_LIB &&
+  deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libQt5Concurrent.so*  $$DEPLOY_DIR_LIB &&
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libQt5Core.so*  $$DEPLOY_DIR_LIB &&
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libQt5DBus.so*  $$DEPLOY_DIR_LIB &&
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libQt5Gui.so*  $$DEPLOY_DIR_LIB &&
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libQt5Network.so*  $$DEPLOY_DIR_LIB &&
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libQt5Svg.so*  $$DEPLOY_DIR_LIB &&
+  deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libQt5WebSockets.so*  $$DEPLOY_DIR_LIB &&
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libQt5Widgets.so*  $$DEPLOY_DIR_LIB &&
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libQt5X11Extras.so*  $$DEPLOY_DIR_LIB &&
   deploy.commands += cp -vfa $$[QT_INSTALL_LIBS]/libQt5XcbQpa.so*  $$DEPLOY_DIR_LIB &&
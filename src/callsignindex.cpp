@@ -0,0 +1,89 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "callsignindex.h"
+
+#include "trafficstore.h"
+
+#include <QHash>
+
+#include <algorithm>
+
+namespace lfgc {
+
+/* Smallest table size. Power of two. */
+static const int MIN_SLOTS = 64;
+
+void CallsignIndex::build(const TrafficStore& storeParam)
+{
+  store = &storeParam;
+
+  // Keep the load factor at 0.5 or below to have short probe sequences
+  int size = MIN_SLOTS;
+  while(size < store->size() * 2)
+    size *= 2;
+
+  if(table.size() < size)
+    table.resize(size);
+  mask = size - 1;
+  std::fill(table.begin(), table.begin() + size, Slot{0u, -1});
+
+  for(int row = 0; row < store->size(); row++)
+  {
+    const QString& callsign = store->getCallsign(row);
+    if(callsign.isEmpty())
+      continue;
+
+    uint hash = qHash(callsign);
+    int index = static_cast<int>(hash) & mask;
+    bool duplicate = false;
+    while(table.at(index).row != -1)
+    {
+      const Slot& slot = table.at(index);
+      if(slot.hash == hash && store->getCallsign(slot.row) == callsign)
+      {
+        duplicate = true;
+        break;
+      }
+      index = (index + 1) & mask;
+    }
+
+    if(!duplicate)
+      table[index] = {hash, row};
+  }
+}
+
+int CallsignIndex::find(const QString& callsign) const
+{
+  if(store == nullptr || callsign.isEmpty())
+    return -1;
+
+  uint hash = qHash(callsign);
+  int index = static_cast<int>(hash) & mask;
+  while(table.at(index).row != -1)
+  {
+    const Slot& slot = table.at(index);
+    if(slot.hash == hash && store->getCallsign(slot.row) == callsign)
+      return slot.row;
+    index = (index + 1) & mask;
+  }
+  return -1;
+}
+
+} // namespace lfgc
@@ -0,0 +1,64 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLEFGCONNECT_CALLSIGNINDEX_H
+#define LITTLEFGCONNECT_CALLSIGNINDEX_H
+
+#include <QVector>
+
+namespace lfgc {
+
+class TrafficStore;
+
+/*
+ * Hash index from callsign to row of a TrafficStore.
+ *
+ * Open addressing with linear probing on a table which is only grown and never freed. Keys are not copied
+ * but compared against the callsign column of the store. Rebuilding for a store of similar size does not
+ * allocate. Rows with empty callsigns are not indexed. The first row wins for duplicates in the same store.
+ *
+ * The store must not be changed between build() and find().
+ */
+class CallsignIndex
+{
+public:
+  /* Index all rows of store */
+  void build(const TrafficStore& storeParam);
+
+  /* Row for callsign or -1 if not found */
+  int find(const QString& callsign) const;
+
+private:
+  struct Slot
+  {
+    uint hash;
+    int row;
+  };
+
+  const TrafficStore *store = nullptr;
+  QVector<Slot> table;
+
+  /* Size of the table part in use minus one. The size is a power of two. table can be larger
+   * since it keeps its size from bigger traffic sets. */
+  int mask = 0;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_CALLSIGNINDEX_H
@@ -24,11 +24,35 @@
 namespace lfgc {
 /* key names for atools::settings */
 const QLatin1String SETTINGS_OPTIONS_DEFAULT_PORT("Options/DefaultPort");
+const QLatin1String SETTINGS_OPTIONS_METADATA_PORT("Options/MetadataPort");
+const QLatin1String SETTINGS_OPTIONS_PROPERTY_LISTENER_URL("Options/PropertyListenerUrl");
 const QLatin1String SETTINGS_OPTIONS_UPDATE_RATE("Options/UpdateRate");
+const QLatin1String SETTINGS_OPTIONS_PUBLISH_RATE("Options/PublishRate");
+const QLatin1String SETTINGS_OPTIONS_ADAPTIVE_PUBLISH_RATE("Options/AdaptivePublishRate");
+const QLatin1String SETTINGS_OPTIONS_FILTER_VERTICAL_SPEED("Options/FilterVerticalSpeed");
+const QLatin1String SETTINGS_OPTIONS_FILTER_GROUND_SPEED("Options/FilterGroundSpeed");
+const QLatin1String SETTINGS_OPTIONS_FILTER_INDICATED_SPEED("Options/FilterIndicatedSpeed");
+const QLatin1String SETTINGS_OPTIONS_FILTER_TRUE_AIRSPEED("Options/FilterTrueAirspeed");
+const QLatin1String SETTINGS_OPTIONS_FILTER_INDICATED_ALTITUDE("Options/FilterIndicatedAltitude");
+const QLatin1String SETTINGS_OPTIONS_FILTER_ON_GROUND("Options/FilterOnGround");
 const QLatin1String SETTINGS_OPTIONS_RECONNECT_RATE("Options/ReconnectRate");
 const QLatin1String SETTINGS_OPTIONS_FETCH_AI_AIRCRAFT("Options/FetchAiAircraft");
 const QLatin1String SETTINGS_OPTIONS_MULTIPLAYER_SERVER_HOST("Options/MultiplayerServerHost");
 const QLatin1String SETTINGS_OPTIONS_MULTIPLAYER_SERVER_PORT("Options/MultiplayerServerPort");
+const QLatin1String SETTINGS_OPTIONS_MULTIPLAYER_SERVER_TIMEOUT("Options/MultiplayerServerTimeout");
+const QLatin1String SETTINGS_OPTIONS_MULTIPLAYER_LISTEN_PORT("Options/MultiplayerListenPort");
+const QLatin1String SETTINGS_OPTIONS_DECODER_THREADS("Options/DecoderThreads");
+const QLatin1String SETTINGS_OPTIONS_TRAFFIC_PREDICTION_LIMIT("Options/TrafficPredictionLimit");
+const QLatin1String SETTINGS_OPTIONS_TRACK_HISTORY_SIZE("Options/TrackHistorySize");
+const QLatin1String SETTINGS_OPTIONS_TRACK_HISTORY_QUEUE("Options/TrackHistoryQueue");
+const QLatin1String SETTINGS_OPTIONS_SNAPSHOT_REGION("Options/SnapshotRegion");
+const QLatin1String SETTINGS_OPTIONS_SHARED_MEMORY_OUTPUT("Options/SharedMemoryOutput");
+const QLatin1String SETTINGS_OPTIONS_RECORDER_DIRECTORY("Options/RecorderDirectory");
+const QLatin1String SETTINGS_OPTIONS_RECORDER_QUEUE("Options/RecorderQueue");
+const QLatin1String SETTINGS_OPTIONS_RELAY_TARGETS("Options/RelayTargets");
+const QLatin1String SETTINGS_OPTIONS_STATUS_SERVER_PORT("Options/StatusServerPort");
+const QLatin1String SETTINGS_OPTIONS_STATUS_SERVER_ADDRESS("Options/StatusServerAddress");
+const QLatin1String SETTINGS_OPTIONS_TRACE_FILE("Options/TraceFile");
 const QLatin1String SETTINGS_OPTIONS_VERBOSE("Options/Verbose");
 const QLatin1String SETTINGS_OPTIONS_LANGUAGE("Options/Language");
 
@@ -0,0 +1,171 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "datagramrelay.h"
+
+#include <QDebug>
+#include <QHostInfo>
+#include <QUdpSocket>
+
+namespace lfgc {
+
+/* Maximum number of datagrams waiting for the relay thread. New datagrams are dropped if exceeded. */
+static const int MAX_QUEUE_SIZE = 256;
+
+DatagramRelay::DatagramRelay(const QStringList& targetList)
+{
+  qDebug() << Q_FUNC_INFO << targetList;
+
+  for(const QString& target : targetList)
+  {
+    if(!target.trimmed().isEmpty())
+    {
+      targetStrings.append(target.trimmed());
+
+      RelayTargetStatistics stats;
+      stats.target = target.trimmed();
+      statistics.append(stats);
+    }
+  }
+  queue.reserve(MAX_QUEUE_SIZE);
+}
+
+DatagramRelay::~DatagramRelay()
+{
+  qDebug() << Q_FUNC_INFO;
+}
+
+void DatagramRelay::relayDatagram(const QByteArray& datagram)
+{
+  {
+    QMutexLocker locker(&queueMutex);
+    if(queue.size() < MAX_QUEUE_SIZE)
+      // Increases only the reference count
+      queue.append(datagram);
+    else
+      queueDropped++;
+  }
+  waitCondition.wakeAll();
+}
+
+void DatagramRelay::terminateThread()
+{
+  {
+    QMutexLocker locker(&queueMutex);
+    terminate = true;
+  }
+  waitCondition.wakeAll();
+  wait();
+}
+
+QVector<RelayTargetStatistics> DatagramRelay::getStatistics() const
+{
+  QMutexLocker locker(&queueMutex);
+  return statistics;
+}
+
+void DatagramRelay::resolveTargets()
+{
+  targets.clear();
+  for(const QString& targetStr : targetStrings)
+  {
+    Target target;
+    QString host = targetStr.section(':', 0, -2);
+    bool ok;
+    target.port = static_cast<quint16>(targetStr.section(':', -1).toUInt(&ok));
+
+    if(!ok || target.port == 0 || host.isEmpty())
+      qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Invalid relay target" << targetStr;
+    else if(!target.address.setAddress(host))
+    {
+      // Not an IP address - look up host name
+      QHostInfo info = QHostInfo::fromName(host);
+      if(info.error() != QHostInfo::NoError || info.addresses().isEmpty())
+        qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot resolve relay target" << targetStr
+                   << info.errorString();
+      else
+        target.address = info.addresses().constFirst();
+    }
+
+    // Add also invalid targets to keep indexes in sync with statistics
+    targets.append(target);
+    qInfo() << "LittleFgConnect" << Q_FUNC_INFO << "Relay target" << targetStr << target.address << target.port;
+  }
+}
+
+void DatagramRelay::run()
+{
+  qDebug() << "LittleFgconnect" << Q_FUNC_INFO;
+
+  resolveTargets();
+
+  QUdpSocket socket;
+  QVector<QByteArray> batch;
+  batch.reserve(MAX_QUEUE_SIZE);
+  QVector<quint64> sent(targets.size(), 0), dropped(targets.size(), 0);
+
+  queueMutex.lock();
+  while(!terminate)
+  {
+    if(queue.isEmpty())
+      waitCondition.wait(&queueMutex);
+
+    // Take all pending datagrams and release the lock while sending
+    batch.swap(queue);
+    quint64 dropQueue = queueDropped;
+    queueDropped = 0;
+    queueMutex.unlock();
+
+    for(int i = 0; i < targets.size(); i++)
+    {
+      const Target& target = targets.at(i);
+      if(target.address.isNull())
+        dropped[i] += static_cast<quint64>(batch.size());
+      else
+      {
+        for(const QByteArray& datagram : batch)
+        {
+          if(socket.writeDatagram(datagram, target.address, target.port) == datagram.size())
+            sent[i]++;
+          else
+            dropped[i]++;
+        }
+      }
+      dropped[i] += dropQueue;
+    }
+    batch.clear();
+
+    queueMutex.lock();
+    for(int i = 0; i < statistics.size(); i++)
+    {
+      statistics[i].sent += sent.at(i);
+      statistics[i].dropped += dropped.at(i);
+    }
+    sent.fill(0);
+    dropped.fill(0);
+  }
+  queueMutex.unlock();
+
+  for(const RelayTargetStatistics& stats : getStatistics())
+    qInfo() << "LittleFgConnect" << Q_FUNC_INFO << "Relay target" << stats.target
+            << "sent" << stats.sent << "dropped" << stats.dropped;
+
+  qDebug() << "LittleFgConnect" << Q_FUNC_INFO << "terminated";
+}
+
+} // namespace lfgc
@@ -0,0 +1,100 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_DATAGRAMRELAY_H
+#define LITTLEFGCONNECT_DATAGRAMRELAY_H
+
+#include <QHostAddress>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+namespace lfgc {
+
+/* Counters for one relay target */
+struct RelayTargetStatistics
+{
+  QString target;
+  quint64 sent = 0;
+
+  /* Datagrams not sent due to socket errors or an overflowing queue */
+  quint64 dropped = 0;
+};
+
+/*
+ * Forwards all received FlightGear datagrams unchanged to a list of other UDP endpoints. This allows
+ * one FlightGear generic protocol output to feed several consumers.
+ *
+ * Datagrams are only queued by the caller and sent in batches from this thread to avoid delaying the
+ * parsing and shared memory update. Queued datagrams share their data with the caller and are not copied.
+ */
+class DatagramRelay :
+  public QThread
+{
+public:
+  /* Targets are given as "host:port" */
+  explicit DatagramRelay(const QStringList& targetList);
+  virtual ~DatagramRelay() override;
+
+  /* Queue datagram for sending to all targets. Called in the main thread context. */
+  void relayDatagram(const QByteArray& datagram);
+
+  /* Send termination signal and wait for terminated */
+  void terminateThread();
+
+  /* Get a copy of the counters for all targets */
+  QVector<RelayTargetStatistics> getStatistics() const;
+
+  bool hasTargets() const
+  {
+    return !targetStrings.isEmpty();
+  }
+
+private:
+  struct Target
+  {
+    QHostAddress address;
+    quint16 port = 0;
+  };
+
+  virtual void run() override;
+
+  /* Resolve host names. Called in thread context to avoid blocking on DNS lookups. */
+  void resolveTargets();
+
+  bool terminate = false;
+  QStringList targetStrings;
+  QVector<Target> targets;
+
+  /* Pending datagrams. Swapped out by the thread to send all in one batch. */
+  QVector<QByteArray> queue;
+
+  /* Number of datagrams dropped due to a full queue since last batch */
+  quint64 queueDropped = 0;
+
+  /* Synchronize queue and statistics access */
+  mutable QMutex queueMutex;
+  QWaitCondition waitCondition;
+
+  QVector<RelayTargetStatistics> statistics;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_DATAGRAMRELAY_H
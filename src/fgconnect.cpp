@@ -17,19 +17,27 @@
 
 #include "fgconnect.h"
 
+#include "fieldreader.h"
+#include "propertysubscriber.h"
 #include "fs/sc/simconnectuseraircraft.h"
 #include "fs/sc/simconnectdata.h"
 #include "fs/sc/simconnecttypes.h"
 #include "geo/calculations.h"
 
+#include <algorithm>
+
 using atools::geo::kgToLbs;
 using atools::geo::meterToFeet;
 using atools::geo::meterToNm;
 using atools::roundToInt;
 using atools::geo::Pos;
+using lfgc::FieldReader;
 
 namespace xpc {
 
+/* Traffic vectors which can be held by frames in the reader and the output sinks at the same time */
+static const int MAX_SPARE_AIRCRAFT_VECTORS = 4;
+
 XpConnect::XpConnect()
 {
   qDebug() << Q_FUNC_INFO;
@@ -40,151 +48,379 @@ XpConnect::~XpConnect()
   qDebug() << Q_FUNC_INFO;
 }
 
-bool XpConnect::fillSimConnectData(QString simData, QString onlineStatus, atools::fs::sc::SimConnectData& data, bool fetchAi)
+bool XpConnect::fillSimConnectData(const QByteArray& simData, atools::fs::sc::SimConnectData& data, bool fetchAi)
 {
-    Q_UNUSED(fetchAi);
-
-    QString retval = simData;
-    QStringList pieces = retval.split(";");
-
-    qDebug() << Q_FUNC_INFO << retval;
+    qDebug() << Q_FUNC_INFO << simData;
 
-    if (pieces.size() == 1) {
+    if (!simData.contains(';')) {
         return false;
     }
 
-    int index = 0;
+    // Read fields in place from the datagram - strings are resolved from the intern pool
+    FieldReader pieces(simData, ';');
     //      <name>2019-12-25T09:43:49</name>
-    QString timegmt = pieces.at(index++);
+    kinematics.zuluDateTime = readZuluDateTime(pieces);
     //      <name>7200</name>
-    int timeLocalOffset = pieces.at(index++).toInt();
+    metadata.timeLocalOffset = pieces.readInt();
     //      <name>altitudeAboveGroundFt = 0.f</name>
-    float altitudeAboveGroundFt = pieces.at(index++).toFloat();
+    kinematics.altitudeAboveGroundFt = pieces.readFloat();
     //      <name>groundAltitudeFt = 0.f</name>
-    float groundAltitudeFt = pieces.at(index++).toFloat();
+    kinematics.groundAltitudeFt = pieces.readFloat();
     //      <name>windSpeedKts = 0.f</name>
-    float windSpeedKts = pieces.at(index++).toFloat();
+    metadata.windSpeedKts = pieces.readFloat();
     //      <name>windDirectionDegT = 0.f</name>
-    float windDirectionDegT = pieces.at(index++).toFloat();
+    metadata.windDirectionDegT = pieces.readFloat();
     //      <name>ambientTemperatureCelsius = 0.f</name>
-    float ambientTemperatureCelsius = pieces.at(index++).toFloat();
+    metadata.ambientTemperatureCelsius = pieces.readFloat();
     //      <name>seaLevelPressureMbar = 0.f - inhg</name>
-    float seaLevelPressureInhg = pieces.at(index++).toFloat();
+    metadata.seaLevelPressureInhg = pieces.readFloat();
     //      <name>airplaneTotalWeightLbs
-    float airplaneTotalWeightLbsYasim = pieces.at(index++).toFloat();
+    metadata.airplaneTotalWeightLbsYasim = pieces.readFloat();
     //      <name>airplaneTotalWeightLbs
-    float airplaneTotalWeightLbsJsbsim = pieces.at(index++).toFloat();
+    metadata.airplaneTotalWeightLbsJsbsim = pieces.readFloat();
     //      <name>fuelTotalQuantityGallons = 0.f</name>
-    float fuelTotalQuantityGallons = pieces.at(index++).toFloat();
+    metadata.fuelTotalQuantityGallons = pieces.readFloat();
     //      <name>fuelTotalWeightLbs = 0.f</name>
-    float fuelTotalWeightLbs = pieces.at(index++).toFloat();
+    metadata.fuelTotalWeightLbs = pieces.readFloat();
     //      <name>fuelFlowGPH
-    float fuelFlowGPH = pieces.at(index++).toFloat();
+    metadata.fuelFlowGPH = pieces.readFloat();
     //      <name>fuelFlowPPH (in PPS)
-    float fuelFlowPPS = pieces.at(index++).toFloat();
+    metadata.fuelFlowPPS = pieces.readFloat();
     //      <name>fuelFlowGPH (yasim)
-    float fuelFlowGPH0 = pieces.at(index++).toFloat();
+    metadata.fuelFlowGPH0 = pieces.readFloat();
     //      <name>fuelFlowGPH (yasim)
-    float fuelFlowGPH1 = pieces.at(index++).toFloat();
+    metadata.fuelFlowGPH1 = pieces.readFloat();
     //      <name>fuelFlowGPH (yasim)
-    float fuelFlowGPH2 = pieces.at(index++).toFloat();
+    metadata.fuelFlowGPH2 = pieces.readFloat();
     //      <name>fuelFlowGPH (yasim)
-    float fuelFlowGPH3 = pieces.at(index++).toFloat();
+    metadata.fuelFlowGPH3 = pieces.readFloat();
     //      <name>magVarDeg = 0.f</name>
-    float magVarDeg = pieces.at(index++).toFloat();
+    metadata.magVarDeg = pieces.readFloat();
     //      <name>ambientVisibilityMeter = 0.f;f</name>
-    float ambientVisibilityMeter = pieces.at(index++).toFloat();
+    metadata.ambientVisibilityMeter = pieces.readFloat();
     //      <name>trackMagDeg = 0.f;</name>
-    float trackMagDeg = pieces.at(index++).toFloat();
+    kinematics.trackMagDeg = pieces.readFloat();
     //      <name>trackTrueDeg = 0.f;</name>
-    float trackTrueDeg = pieces.at(index++).toFloat();
+    kinematics.trackTrueDeg = pieces.readFloat();
     //      <name>airplaneTitle = ""</name>
-    QString airplaneTitle = pieces.at(index++);
+    metadata.airplaneTitle = pieces.readString(stringPool);
     //      <name>airplaneModel = ""</name>
-    QString airplaneModel = pieces.at(index++);
+    metadata.airplaneModel = pieces.readString(stringPool);
     //      <name>airplaneCallsign = ""</name>
-    QString airplaneCallsign = pieces.at(index++);
+    metadata.airplaneCallsign = pieces.readString(stringPool);
     //      <name>atools::geo::Pos position - latitude</name>
-    float latitude = pieces.at(index++).toFloat();
+    kinematics.latitude = pieces.readFloat();
     //      <name>atools::geo::Pos position - longitude</name>
-    float longitude = pieces.at(index++).toFloat();
+    kinematics.longitude = pieces.readFloat();
     //      <name>headingTrueDeg = 0.f</name>
-    float headingTrueDeg = pieces.at(index++).toFloat();
+    kinematics.headingTrueDeg = pieces.readFloat();
     //      <name>headingMagDeg = 0.f</name>
-    float headingMagDeg = pieces.at(index++).toFloat();
+    kinematics.headingMagDeg = pieces.readFloat();
     //      <name>groundSpeedKts = 0.f</name>
-    float groundSpeedKts = pieces.at(index++).toFloat();
+    kinematics.groundSpeedKts = pieces.readFloat();
     //      <name>indicatedAltitudeFt = 0.f</name>
-    float indicatedAltitudeFt = pieces.at(index++).toFloat();
+    kinematics.indicatedAltitudeFt = pieces.readFloat();
     //      <name>indicatedSpeedKts = 0.f</name>
-    float indicatedSpeedKts = pieces.at(index++).toFloat();
+    kinematics.indicatedSpeedKts = pieces.readFloat();
     //      <name>trueAirspeedKts = 0.f</name>
-    float trueAirspeedKts = pieces.at(index++).toFloat();
+    kinematics.trueAirspeedKts = pieces.readFloat();
     //      <name>machSpeed = 0.f</name>
-    float machSpeed = pieces.at(index++).toFloat();
+    kinematics.machSpeed = pieces.readFloat();
     //      <name>verticalSpeedFeetPerMin = 0.f</name>
-    float verticalSpeedFeetPerMin = pieces.at(index++).toFloat();
+    kinematics.verticalSpeedFeetPerMin = pieces.readFloat();
     //      flightModel Type (jsb or yasim)
-    QString flightModel = pieces.at(index++);
+    metadata.jsbsim = pieces.readRaw().contains("jsb");
     //      flight freeze (pause)
-    QString flightFreeze = pieces.at(index++);
+    kinematics.freeze = pieces.readRaw() == "true";
     //      flight replay (fgtape)
-    int flightReplay = pieces.at(index++).toInt();
+    kinematics.replay = pieces.readInt() == 1;
     //      multiplayer online
-    QString multiplayerOnline = pieces.at(index++);
+    metadata.multiplayerOnline = pieces.readRaw() == "true";
     //      multiplayer server
-    QString multiplayerServer = pieces.at(index++);
+    metadata.multiplayerServer = pieces.readString(stringPool);
     //      ai objects combined
-    QString aiObjectsCombined = pieces.at(index++);
+    storeAiObjects(pieces.readRaw(), fetchAi);
+
+    return buildSimConnectData(data, fetchAi);
+}
+
+bool XpConnect::fillKinematics(const QByteArray& simData, atools::fs::sc::SimConnectData& data, bool fetchAi)
+{
+  if(!simData.contains(';'))
+    return false;
+
+  // Layout of the high rate datagram
+  FieldReader pieces(simData, ';');
+  // /sim/time/gmt - 2019-12-25T09:43:49
+  kinematics.zuluDateTime = readZuluDateTime(pieces);
+  kinematics.latitude = pieces.readFloat();
+  kinematics.longitude = pieces.readFloat();
+  kinematics.altitudeAboveGroundFt = pieces.readFloat();
+  kinematics.groundAltitudeFt = pieces.readFloat();
+  kinematics.indicatedAltitudeFt = pieces.readFloat();
+  kinematics.headingTrueDeg = pieces.readFloat();
+  kinematics.headingMagDeg = pieces.readFloat();
+  kinematics.trackTrueDeg = pieces.readFloat();
+  kinematics.trackMagDeg = pieces.readFloat();
+  kinematics.groundSpeedKts = pieces.readFloat();
+  kinematics.indicatedSpeedKts = pieces.readFloat();
+  kinematics.trueAirspeedKts = pieces.readFloat();
+  kinematics.machSpeed = pieces.readFloat();
+  kinematics.verticalSpeedFeetPerMin = pieces.readFloat();
+  // flight freeze (pause) - "true" or "false"
+  kinematics.freeze = pieces.readRaw() == "true";
+  // flight replay (fgtape) - 1 if active
+  kinematics.replay = pieces.readInt() == 1;
+
+  return buildSimConnectData(data, fetchAi);
+}
+
+void XpConnect::updateMetadata(const QByteArray& metaData, bool fetchAi)
+{
+  qDebug() << Q_FUNC_INFO << metaData.size() << "bytes";
+
+  if(!metaData.contains(';'))
+    return;
+
+  // Layout of the low rate datagram
+  FieldReader pieces(metaData, ';');
+  metadata.timeLocalOffset = pieces.readInt();
+  metadata.windSpeedKts = pieces.readFloat();
+  metadata.windDirectionDegT = pieces.readFloat();
+  metadata.ambientTemperatureCelsius = pieces.readFloat();
+  metadata.seaLevelPressureInhg = pieces.readFloat();
+  metadata.airplaneTotalWeightLbsYasim = pieces.readFloat();
+  metadata.airplaneTotalWeightLbsJsbsim = pieces.readFloat();
+  metadata.fuelTotalQuantityGallons = pieces.readFloat();
+  metadata.fuelTotalWeightLbs = pieces.readFloat();
+  metadata.fuelFlowGPH = pieces.readFloat();
+  metadata.fuelFlowPPS = pieces.readFloat();
+  metadata.fuelFlowGPH0 = pieces.readFloat();
+  metadata.fuelFlowGPH1 = pieces.readFloat();
+  metadata.fuelFlowGPH2 = pieces.readFloat();
+  metadata.fuelFlowGPH3 = pieces.readFloat();
+  metadata.magVarDeg = pieces.readFloat();
+  metadata.ambientVisibilityMeter = pieces.readFloat();
+  metadata.airplaneTitle = pieces.readString(stringPool);
+  metadata.airplaneModel = pieces.readString(stringPool);
+  metadata.airplaneCallsign = pieces.readString(stringPool);
+  // flightModel Type (jsb or yasim)
+  metadata.jsbsim = pieces.readRaw().contains("jsb");
+  metadata.multiplayerOnline = pieces.readRaw() == "true";
+  metadata.multiplayerServer = pieces.readString(stringPool);
+
+  // AI objects are only parsed at the low rate
+  storeAiObjects(pieces.readRaw(), fetchAi);
+}
+
+bool XpConnect::applyProperties(const QVector<lfgc::PropertyChange>& changes,
+                                atools::fs::sc::SimConnectData& data, bool fetchAi)
+{
+  qDebug() << Q_FUNC_INFO << changes.size() << "changes";
+
+  // Values not contained in changes keep their last value
+  for(const lfgc::PropertyChange& change : changes)
+  {
+    float value = static_cast<float>(change.number);
+    switch(change.id)
+    {
+      case lfgc::PROP_TIME_GMT:
+        kinematics.zuluDateTime = QDateTime::fromString(change.text, "yyyy-MM-ddTHH:mm:ss");
+        break;
+      case lfgc::PROP_TIME_LOCAL_OFFSET:
+        metadata.timeLocalOffset = static_cast<int>(change.number);
+        break;
+      case lfgc::PROP_ALTITUDE_AGL:
+        kinematics.altitudeAboveGroundFt = value;
+        break;
+      case lfgc::PROP_GROUND_ELEVATION:
+        kinematics.groundAltitudeFt = value;
+        break;
+      case lfgc::PROP_WIND_SPEED:
+        metadata.windSpeedKts = value;
+        break;
+      case lfgc::PROP_WIND_DIRECTION:
+        metadata.windDirectionDegT = value;
+        break;
+      case lfgc::PROP_TEMPERATURE:
+        metadata.ambientTemperatureCelsius = value;
+        break;
+      case lfgc::PROP_SEA_LEVEL_PRESSURE:
+        metadata.seaLevelPressureInhg = value;
+        break;
+      case lfgc::PROP_WEIGHT_YASIM:
+        metadata.airplaneTotalWeightLbsYasim = value;
+        break;
+      case lfgc::PROP_WEIGHT_JSBSIM:
+        metadata.airplaneTotalWeightLbsJsbsim = value;
+        break;
+      case lfgc::PROP_FUEL_QUANTITY:
+        metadata.fuelTotalQuantityGallons = value;
+        break;
+      case lfgc::PROP_FUEL_WEIGHT:
+        metadata.fuelTotalWeightLbs = value;
+        break;
+      case lfgc::PROP_FUEL_FLOW_GPH:
+        metadata.fuelFlowGPH = value;
+        break;
+      case lfgc::PROP_FUEL_FLOW_PPS:
+        metadata.fuelFlowPPS = value;
+        break;
+      case lfgc::PROP_FUEL_FLOW_GPH0:
+        metadata.fuelFlowGPH0 = value;
+        break;
+      case lfgc::PROP_FUEL_FLOW_GPH1:
+        metadata.fuelFlowGPH1 = value;
+        break;
+      case lfgc::PROP_FUEL_FLOW_GPH2:
+        metadata.fuelFlowGPH2 = value;
+        break;
+      case lfgc::PROP_FUEL_FLOW_GPH3:
+        metadata.fuelFlowGPH3 = value;
+        break;
+      case lfgc::PROP_MAG_VAR:
+        metadata.magVarDeg = value;
+        break;
+      case lfgc::PROP_VISIBILITY:
+        metadata.ambientVisibilityMeter = value;
+        break;
+      case lfgc::PROP_TRACK_MAG:
+        kinematics.trackMagDeg = value;
+        break;
+      case lfgc::PROP_TRACK_TRUE:
+        kinematics.trackTrueDeg = value;
+        break;
+      case lfgc::PROP_TITLE:
+        metadata.airplaneTitle = change.text;
+        break;
+      case lfgc::PROP_MODEL:
+        metadata.airplaneModel = change.text;
+        break;
+      case lfgc::PROP_CALLSIGN:
+        metadata.airplaneCallsign = change.text;
+        break;
+      case lfgc::PROP_LATITUDE:
+        kinematics.latitude = value;
+        break;
+      case lfgc::PROP_LONGITUDE:
+        kinematics.longitude = value;
+        break;
+      case lfgc::PROP_HEADING_TRUE:
+        kinematics.headingTrueDeg = value;
+        break;
+      case lfgc::PROP_HEADING_MAG:
+        kinematics.headingMagDeg = value;
+        break;
+      case lfgc::PROP_GROUND_SPEED:
+        kinematics.groundSpeedKts = value;
+        break;
+      case lfgc::PROP_INDICATED_ALTITUDE:
+        kinematics.indicatedAltitudeFt = value;
+        break;
+      case lfgc::PROP_INDICATED_SPEED:
+        kinematics.indicatedSpeedKts = value;
+        break;
+      case lfgc::PROP_TRUE_AIRSPEED:
+        kinematics.trueAirspeedKts = value;
+        break;
+      case lfgc::PROP_MACH:
+        kinematics.machSpeed = value;
+        break;
+      case lfgc::PROP_VERTICAL_SPEED:
+        kinematics.verticalSpeedFeetPerMin = value;
+        break;
+      case lfgc::PROP_FLIGHT_MODEL:
+        metadata.jsbsim = change.text.contains("jsb");
+        break;
+      case lfgc::PROP_FREEZE:
+        kinematics.freeze = change.number > 0.;
+        break;
+      case lfgc::PROP_REPLAY:
+        kinematics.replay = static_cast<int>(change.number) == 1;
+        break;
+      case lfgc::PROP_MULTIPLAYER_ONLINE:
+        metadata.multiplayerOnline = change.number > 0.;
+        break;
+      case lfgc::PROP_MULTIPLAYER_SERVER:
+        metadata.multiplayerServer = change.text;
+        break;
+      case lfgc::PROP_NUM_PROPERTIES:
+        break;
+    }
+  }
+
+  // The AI objects field is built by the generic protocol only - multiplayer traffic comes from the server
+  storeAiObjects(QByteArray(), false);
+
+  return buildSimConnectData(data, fetchAi);
+}
+
+QDateTime XpConnect::readZuluDateTime(FieldReader& reader)
+{
+  QByteArray timegmt = reader.readRaw();
+  if(timegmt != lastTimegmt)
+  {
+    // Changes only once per second
+    lastTimegmt = QByteArray(timegmt.constData(), timegmt.size());
+    lastZuluDateTime = QDateTime::fromString(QString::fromLatin1(timegmt), "yyyy-MM-ddTHH:mm:ss");
+  }
+  return lastZuluDateTime;
+}
+
+bool XpConnect::buildSimConnectData(atools::fs::sc::SimConnectData& data, bool fetchAi)
+{
+    const Kinematics& k = kinematics;
+    const Metadata& m = metadata;
 
     atools::fs::sc::SimConnectUserAircraft& userAircraft = data.userAircraft;
 
     // Reset user aircraft
     userAircraft = atools::fs::sc::SimConnectUserAircraft();
 
-    userAircraft.position = Pos(longitude, latitude, altitudeAboveGroundFt);
+    userAircraft.position = Pos(k.longitude, k.latitude, k.altitudeAboveGroundFt);
 
     userAircraft.properties.addProp(atools::util::Prop(atools::fs::sc::PROP_XPCONNECT_VERSION, QCoreApplication::applicationVersion()));
 
     if(!userAircraft.position.isValid() || userAircraft.position.isNull()) {
+      filters.reset();
       return false;
     }
 
     // Build local time
-    QDateTime zuluDateTime = QDateTime::fromString(timegmt, "yyyy-MM-ddTHH:mm:ss");
+    QDateTime zuluDateTime = k.zuluDateTime;
     userAircraft.zuluDateTime = zuluDateTime;
-    QDateTime localDateTime(zuluDateTime.date(), zuluDateTime.time(), Qt::OffsetFromUTC, timeLocalOffset);
+    QDateTime localDateTime(zuluDateTime.date(), zuluDateTime.time(), Qt::OffsetFromUTC, m.timeLocalOffset);
     userAircraft.localDateTime = localDateTime;
 
-    userAircraft.magVarDeg = magVarDeg;
+    userAircraft.magVarDeg = m.magVarDeg;
 
     // Wind and ambient parameters
-    userAircraft.windSpeedKts = windSpeedKts;
-    userAircraft.windDirectionDegT = windDirectionDegT;
-    userAircraft.ambientTemperatureCelsius = ambientTemperatureCelsius;
-    userAircraft.totalAirTemperatureCelsius = ambientTemperatureCelsius; // FIXME - use the same value ?
-    userAircraft.seaLevelPressureMbar = seaLevelPressureInhg/0.029530f;
+    userAircraft.windSpeedKts = m.windSpeedKts;
+    userAircraft.windDirectionDegT = m.windDirectionDegT;
+    userAircraft.ambientTemperatureCelsius = m.ambientTemperatureCelsius;
+    userAircraft.totalAirTemperatureCelsius = m.ambientTemperatureCelsius; // FIXME - use the same value ?
+    userAircraft.seaLevelPressureMbar = m.seaLevelPressureInhg/0.029530f;
 
     // Ice
     // userAircraft.pitotIcePercent
     // userAircraft.structuralIcePercent
 
-    // Weight    
-    userAircraft.airplaneTotalWeightLbs = flightModel.contains("jsb") ? airplaneTotalWeightLbsJsbsim : airplaneTotalWeightLbsYasim;
+    // Weight
+    userAircraft.airplaneTotalWeightLbs = m.jsbsim ? m.airplaneTotalWeightLbsJsbsim : m.airplaneTotalWeightLbsYasim;
     // simplification
     userAircraft.airplaneMaxGrossWeightLbs = userAircraft.airplaneTotalWeightLbs;
     // simplification - does not account people & luggage weight
-    userAircraft.airplaneEmptyWeightLbs = userAircraft.airplaneTotalWeightLbs - fuelTotalWeightLbs;
+    userAircraft.airplaneEmptyWeightLbs = userAircraft.airplaneTotalWeightLbs - m.fuelTotalWeightLbs;
 
     // Fuel flow in weight
-    userAircraft.fuelTotalWeightLbs = fuelTotalWeightLbs;
-    userAircraft.fuelTotalQuantityGallons = fuelTotalQuantityGallons;
+    userAircraft.fuelTotalWeightLbs = m.fuelTotalWeightLbs;
+    userAircraft.fuelTotalQuantityGallons = m.fuelTotalQuantityGallons;
 
-    if (flightModel.contains("jsb")) {
-        userAircraft.fuelFlowGPH = fuelFlowGPH;
-        userAircraft.fuelFlowPPH = fuelFlowPPS * 3600;
+    if (m.jsbsim) {
+        userAircraft.fuelFlowGPH = m.fuelFlowGPH;
+        userAircraft.fuelFlowPPH = m.fuelFlowPPS * 3600;
     } else {
-        float temperatureFarenheit = ambientTemperatureCelsius * 1.8 + 32;
+        float temperatureFarenheit = m.ambientTemperatureCelsius * 1.8 + 32;
         // density relation of Jet A fuel:
         // fuel has 7.275 lbs/gal at -100 °F
         // fuel has 6.950 lbs/gal at 0 °F
@@ -199,39 +435,39 @@ bool XpConnect::fillSimConnectData(QString simData, QString onlineStatus, atools
         // change 0.0041 lbs/gal per 1 °F
         float fuelDensityll100 = temperatureFarenheit * -0.0041 + 6.08;
 
-        userAircraft.fuelFlowGPH = fuelFlowGPH0 + fuelFlowGPH1 + fuelFlowGPH2 + fuelFlowGPH3;
+        userAircraft.fuelFlowGPH = m.fuelFlowGPH0 + m.fuelFlowGPH1 + m.fuelFlowGPH2 + m.fuelFlowGPH3;
         userAircraft.fuelFlowPPH = userAircraft.fuelFlowGPH * fuelDensityll100 ;
     }
     // userAircraft.numberOfEngines
 
-    userAircraft.ambientVisibilityMeter = ambientVisibilityMeter;
+    userAircraft.ambientVisibilityMeter = m.ambientVisibilityMeter;
 
     // SimConnectAircraft
-    userAircraft.airplaneTitle = airplaneTitle;
-    userAircraft.airplaneModel = airplaneModel;
-    userAircraft.airplaneReg = airplaneCallsign;
+    userAircraft.airplaneTitle = m.airplaneTitle;
+    userAircraft.airplaneModel = m.airplaneModel;
+    userAircraft.airplaneReg = m.airplaneCallsign;
     // userAircraft.airplaneType;
     // userAircraft.airplaneAirline;
     // userAircraft.airplaneFlightnumber;
     // userAircraft.fromIdent;
     // userAircraft.toIdent;
 
-    userAircraft.altitudeAboveGroundFt = altitudeAboveGroundFt;
-    userAircraft.groundAltitudeFt = groundAltitudeFt;
-    userAircraft.indicatedAltitudeFt = indicatedAltitudeFt;
+    userAircraft.altitudeAboveGroundFt = k.altitudeAboveGroundFt;
+    userAircraft.groundAltitudeFt = k.groundAltitudeFt;
+    userAircraft.indicatedAltitudeFt = filters.indicatedAltitude.filter(k.indicatedAltitudeFt);
 
     // Heading and track
-    userAircraft.headingMagDeg = headingMagDeg;
-    userAircraft.headingTrueDeg = headingTrueDeg;
-    userAircraft.trackMagDeg = trackMagDeg;
-    userAircraft.trackTrueDeg = trackTrueDeg;
+    userAircraft.headingMagDeg = k.headingMagDeg;
+    userAircraft.headingTrueDeg = k.headingTrueDeg;
+    userAircraft.trackMagDeg = k.trackMagDeg;
+    userAircraft.trackTrueDeg = k.trackTrueDeg;
 
     // Speed
-    userAircraft.indicatedSpeedKts = indicatedSpeedKts;
-    userAircraft.trueAirspeedKts = trueAirspeedKts;
-    userAircraft.machSpeed = machSpeed;
-    userAircraft.verticalSpeedFeetPerMin = verticalSpeedFeetPerMin;
-    userAircraft.groundSpeedKts = groundSpeedKts;
+    userAircraft.indicatedSpeedKts = filters.indicatedSpeed.filter(k.indicatedSpeedKts);
+    userAircraft.trueAirspeedKts = filters.trueAirspeed.filter(k.trueAirspeedKts);
+    userAircraft.machSpeed = k.machSpeed;
+    userAircraft.verticalSpeedFeetPerMin = filters.verticalSpeed.filter(k.verticalSpeedFeetPerMin);
+    userAircraft.groundSpeedKts = filters.groundSpeed.filter(k.groundSpeedKts);
 
     // Model
     // userAircraft.modelRadiusFt
@@ -239,7 +475,7 @@ bool XpConnect::fillSimConnectData(QString simData, QString onlineStatus, atools
 
     // Set misc flags
     userAircraft.flags = atools::fs::sc::IS_USER | atools::fs::sc::SIM_XPLANE11; // FIXME - don't know if this is correct one
-    if((int)altitudeAboveGroundFt == 0) {
+    if(filters.onGround.update(k.altitudeAboveGroundFt)) {
       userAircraft.flags |= atools::fs::sc::ON_GROUND;
     }
 
@@ -248,10 +484,10 @@ bool XpConnect::fillSimConnectData(QString simData, QString onlineStatus, atools
     // IN_SNOW = 0x0008,  - not available
 
 
-    if (flightFreeze == "true") {
+    if (k.freeze) {
         userAircraft.flags |= atools::fs::sc::SIM_PAUSED;
     }
-    if (flightReplay == 1) {
+    if (k.replay) {
         userAircraft.flags |= atools::fs::sc::SIM_REPLAY;
     }
 
@@ -261,128 +497,203 @@ bool XpConnect::fillSimConnectData(QString simData, QString onlineStatus, atools
     userAircraft.engineType = atools::fs::sc::UNSUPPORTED;
     // PISTON = 0, JET = 1, NO_ENGINE = 2, HELO_TURBINE = 3, UNSUPPORTED = 4, TURBOPROP = 5
 
-    qDebug() << Q_FUNC_INFO << "Online: " << multiplayerOnline;
-    if (multiplayerOnline == "true") {
-        qDebug() << Q_FUNC_INFO << "Server: " << multiplayerServer;
+    qDebug() << Q_FUNC_INFO << "Online: " << m.multiplayerOnline;
+    if (m.multiplayerOnline) {
+        qDebug() << Q_FUNC_INFO << "Server: " << m.multiplayerServer;
     }
 
-    if (fetchAi) {
-
-        data.aiAircraft.clear();
-        quint32 objId = 1;
-
-        // AI objects parser
-        qDebug() << Q_FUNC_INFO << "AI Objects: " << aiObjectsCombined;
-        if (aiObjectsCombined != "") {
-            QStringList aircrafts = aiObjectsCombined.split("|");
-            foreach(QString aircraft, aircrafts) {
-                if (aircraft == "") {
-                    continue;
-                }
-
-                QStringList aircraftItem = aircraft.split("^");
-
-                if (aircraftItem.size() != 6) {
-                    qDebug() << Q_FUNC_INFO << "ERROR: AI Object size not 6 items: " << aircraft;
-                    continue;
-                }
-
-                int index = 0;
-                QString callsign = aircraftItem.at(index++);
-                QString arrivalAirportId = aircraftItem.at(index++);
-                QString departureAirportId = aircraftItem.at(index++);
-                float altitudeFt = aircraftItem.at(index++).toFloat();
-                float latitudeDeg = aircraftItem.at(index++).toFloat();
-                float longitudeDeg = aircraftItem.at(index++).toFloat();
-
-                atools::fs::sc::SimConnectAircraft aiAircraft;
-                aiAircraft.airplaneFlightnumber = callsign;
-                aiAircraft.fromIdent = departureAirportId;
-                aiAircraft.toIdent = arrivalAirportId;
-                aiAircraft.flags = atools::fs::sc::SIM_XPLANE11;
-                aiAircraft.position = Pos(longitudeDeg, latitudeDeg, altitudeFt);
-
-                // Mark fields as unavailable
-                aiAircraft.headingTrueDeg = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.headingMagDeg = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.groundSpeedKts = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.indicatedAltitudeFt = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.indicatedSpeedKts = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.trueAirspeedKts = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.machSpeed = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.verticalSpeedFeetPerMin = atools::fs::sc::SC_INVALID_FLOAT;
-
-                aiAircraft.objectId = objId;
-                aiAircraft.category = atools::fs::sc::AIRPLANE;
-                aiAircraft.engineType = atools::fs::sc::UNSUPPORTED;
-
-                data.aiAircraft.append(aiAircraft);
-
-                objId++;
-            }
-        }
-
-        // Online objects parser
-        qDebug() << Q_FUNC_INFO << "Online Users: " << onlineStatus;
-        if (onlineStatus != "") {
-            QStringList strList = onlineStatus.split("\n",Qt::SkipEmptyParts);
-            for(int index = 1;index < strList.length();index++)
-            {
-                qDebug() << strList[index];
-                if (strList[index].startsWith("#")) {
-                    continue;
-                }
-
-                QStringList userData = strList[index].split(" ");
-                // "RER@mpserver01: 1034171.664623 -6222033.096334 1007853.793531 9.138567 -80.563069 32170.780096
-                // -1.734371 0.059653 0.326972 Aircraft/757-200/Models/757-200.xml"
-                qDebug() << "Online user data: " << userData;
-                // 0 callsign
-                QString callsign = userData[0].mid(0, userData[0].indexOf("@"));
-                // 4 - lat
-                float latitudeDeg = userData[4].toFloat();
-                // 5 - lon
-                float longitudeDeg = userData[5].toFloat();
-                // 6 - altitude
-                float altitudeFt = userData[6].toFloat();
-                // 10 - model
-                QString model = userData[10].split("/").last();
-                model = model.mid(0, model.indexOf(".xml"));
-
-                qDebug() << "callsign: " << callsign
-                         << " latitude: " << latitudeDeg
-                         << " longitude: " << longitudeDeg
-                         << " altitude: " << altitudeFt
-                         << " model: " << model;
-
-                atools::fs::sc::SimConnectAircraft aiAircraft;
-                aiAircraft.airplaneFlightnumber = callsign;
-                aiAircraft.flags = atools::fs::sc::SIM_XPLANE11;
-                aiAircraft.position = Pos(longitudeDeg, latitudeDeg, altitudeFt);
-
-                // Mark fields as unavailable
-                aiAircraft.headingTrueDeg = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.headingMagDeg = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.groundSpeedKts = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.indicatedAltitudeFt = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.indicatedSpeedKts = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.trueAirspeedKts = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.machSpeed = atools::fs::sc::SC_INVALID_FLOAT;
-                aiAircraft.verticalSpeedFeetPerMin = atools::fs::sc::SC_INVALID_FLOAT;
-
-                aiAircraft.objectId = objId;
-                aiAircraft.category = atools::fs::sc::AIRPLANE;
-                aiAircraft.engineType = atools::fs::sc::UNSUPPORTED;
-
-                data.aiAircraft.append(aiAircraft);
-
-                objId++;
-            }
-        }
-
+    if (!fetchAi) {
+        aiTraffic.clear();
+        onlineTraffic.clear();
+        onlinePredictor.clear();
     }
 
     return true;
 }
 
+void XpConnect::storeAiObjects(const QByteArray& aiObjectsCombined, bool fetchAi)
+{
+  if(fetchAi)
+  {
+    // Deep copy since the field is a view on the datagram - reuses the buffer if large enough
+    pendingAiObjects.resize(aiObjectsCombined.size());
+    std::copy(aiObjectsCombined.constBegin(), aiObjectsCombined.constEnd(), pendingAiObjects.begin());
+    aiObjectsPending = true;
+  }
+  else
+  {
+    aiTraffic.clear();
+    pendingAiObjects.clear();
+    aiObjectsPending = false;
+  }
+}
+
+bool XpConnect::takeAiObjects(QByteArray& aiObjects)
+{
+  if(!aiObjectsPending)
+    return false;
+
+  aiObjects.swap(pendingAiObjects);
+  aiObjectsPending = false;
+  return true;
+}
+
+void XpConnect::setOnlineTraffic(const lfgc::TrafficStore& traffic, qint64 receiveTimeNs)
+{
+  qDebug() << Q_FUNC_INFO << "Online Users: " << traffic.size();
+  onlinePredictor.update(traffic, receiveTimeNs);
+}
+
+void XpConnect::dropTraffic(atools::fs::sc::SimConnectData& data)
+{
+  // Assigning releases the reference - clear() would detach first
+  data.aiAircraft = QVector<atools::fs::sc::SimConnectAircraft>();
+}
+
+void XpConnect::setMetarResults(atools::fs::sc::SimConnectData& data,
+                                const QVector<atools::fs::sc::MetarResult>& metarResults)
+{
+  data.metarResults = metarResults;
+}
+
+void XpConnect::materializeTraffic(atools::fs::sc::SimConnectData& data, qint64 nowNs)
+{
+  QVector<atools::fs::sc::SimConnectAircraft>& aircraft = data.aiAircraft;
+
+  if(!data.userAircraft.getPosition().isValid())
+  {
+    // Empty or invalid frame - do not attach any traffic
+    aircraft.clear();
+    trafficStatus.clear();
+    return;
+  }
+
+  onlinePredictor.predict(onlineTraffic, nowNs);
+
+  if(aircraft.capacity() > 0 && !aircraft.isDetached())
+  {
+    // Still held by a published frame - swap with a spare which is not referenced anymore
+    int spare = 0;
+    while(spare < spareAircraft.size() && spareAircraft.at(spare).capacity() > 0 &&
+          !spareAircraft.at(spare).isDetached())
+      spare++;
+
+    if(spare == spareAircraft.size())
+    {
+      if(spareAircraft.size() < MAX_SPARE_AIRCRAFT_VECTORS)
+        spareAircraft.append(QVector<atools::fs::sc::SimConnectAircraft>());
+      else
+        // All consumers are slow - detach by copying below
+        spare = -1;
+    }
+
+    if(spare != -1)
+      aircraft.swap(spareAircraft[spare]);
+  }
+
+  // Resize keeps all existing objects and their strings - only new rows are default constructed
+  aircraft.resize(aiTraffic.size() + onlineTraffic.size());
+  trafficStatus.resize(aircraft.size());
+  for(int i = 0; i < aiTraffic.size(); i++)
+    materializeRow(aiTraffic, i, aircraft, i);
+
+  // Multiplayer pilots are also in the AI objects if the simulator is connected to the same server
+  aiCallsignIndex.build(aiTraffic);
+  int count = aiTraffic.size();
+  for(int i = 0; i < onlineTraffic.size(); i++)
+  {
+    int aiRow = aiCallsignIndex.find(onlineTraffic.getCallsign(i));
+    if(aiRow == -1)
+      materializeRow(onlineTraffic, i, aircraft, count++);
+    else
+      mergeRow(onlineTraffic, i, aircraft, aiRow);
+  }
+
+  // Shrinking keeps the capacity
+  aircraft.resize(count);
+  trafficStatus.resize(count);
+}
+
+void XpConnect::materializeRow(const lfgc::TrafficStore& store, int row,
+                               QVector<atools::fs::sc::SimConnectAircraft>& aircraft, int index)
+{
+  using atools::fs::sc::SC_INVALID_FLOAT;
+
+  atools::fs::sc::SimConnectAircraft& ac = aircraft[index];
+
+  // Assign strings only if changed to avoid detaching
+  if(ac.airplaneFlightnumber != store.getCallsign(row))
+    ac.airplaneFlightnumber = store.getCallsign(row);
+  if(ac.fromIdent != store.getFromIdent(row))
+    ac.fromIdent = store.getFromIdent(row);
+  if(ac.toIdent != store.getToIdent(row))
+    ac.toIdent = store.getToIdent(row);
+
+  // Model file name like "c172p" for online pilots. Empty for AI objects which do not send it.
+  if(ac.airplaneModel != store.getModel(row))
+    ac.airplaneModel = store.getModel(row);
+
+  ac.position = Pos(store.getLonX(row), store.getLatY(row), store.getAltitudeFt(row));
+  ac.flags = atools::fs::sc::SIM_XPLANE11;
+
+  // Mark fields as unavailable if not delivered
+  ac.headingTrueDeg = store.getHeadingTrueDeg(row);
+  ac.headingMagDeg = SC_INVALID_FLOAT;
+  ac.groundSpeedKts = store.getGroundSpeedKts(row);
+  ac.indicatedAltitudeFt = SC_INVALID_FLOAT;
+  ac.indicatedSpeedKts = SC_INVALID_FLOAT;
+  ac.trueAirspeedKts = SC_INVALID_FLOAT;
+  ac.machSpeed = SC_INVALID_FLOAT;
+  ac.verticalSpeedFeetPerMin = store.getVerticalSpeedFeetPerMin(row);
+
+  ac.objectId = static_cast<quint32>(index + 1);
+  ac.category = atools::fs::sc::AIRPLANE;
+  ac.engineType = atools::fs::sc::UNSUPPORTED;
+
+  lfgc::TrafficStatus& status = trafficStatus[index];
+  status.ageSeconds = store.getAgeSeconds(row);
+  status.predicted = store.isPredicted(row);
+}
+
+void XpConnect::mergeRow(const lfgc::TrafficStore& store, int row,
+                         QVector<atools::fs::sc::SimConnectAircraft>& aircraft, int index)
+{
+  using atools::fs::sc::SC_INVALID_FLOAT;
+
+  atools::fs::sc::SimConnectAircraft& ac = aircraft[index];
+  lfgc::TrafficStatus& status = trafficStatus[index];
+
+  // Position of the fresher sample - AI objects have no age since they arrive with the frame
+  if(store.getAgeSeconds(row) < status.ageSeconds)
+  {
+    ac.position = Pos(store.getLonX(row), store.getLatY(row), store.getAltitudeFt(row));
+    if(store.getHeadingTrueDeg(row) < SC_INVALID_FLOAT)
+      ac.headingTrueDeg = store.getHeadingTrueDeg(row);
+    if(store.getGroundSpeedKts(row) < SC_INVALID_FLOAT)
+      ac.groundSpeedKts = store.getGroundSpeedKts(row);
+    if(store.getVerticalSpeedFeetPerMin(row) < SC_INVALID_FLOAT)
+      ac.verticalSpeedFeetPerMin = store.getVerticalSpeedFeetPerMin(row);
+    status.ageSeconds = store.getAgeSeconds(row);
+    status.predicted = store.isPredicted(row);
+  }
+  else
+  {
+    // Keep the fresher position but take movement values the AI objects field does not deliver
+    if(ac.headingTrueDeg >= SC_INVALID_FLOAT)
+      ac.headingTrueDeg = store.getHeadingTrueDeg(row);
+    if(ac.groundSpeedKts >= SC_INVALID_FLOAT)
+      ac.groundSpeedKts = store.getGroundSpeedKts(row);
+    if(ac.verticalSpeedFeetPerMin >= SC_INVALID_FLOAT)
+      ac.verticalSpeedFeetPerMin = store.getVerticalSpeedFeetPerMin(row);
+  }
+
+  // Model is only known from the multiplayer server
+  if(ac.airplaneModel.isEmpty() && !store.getModel(row).isEmpty())
+    ac.airplaneModel = store.getModel(row);
+  if(ac.fromIdent.isEmpty() && !store.getFromIdent(row).isEmpty())
+    ac.fromIdent = store.getFromIdent(row);
+  if(ac.toIdent.isEmpty() && !store.getToIdent(row).isEmpty())
+    ac.toIdent = store.getToIdent(row);
+}
+
 } // namespace xpc
@@ -19,15 +19,28 @@
 #ifndef LITTLEFGCONNECT_FGCONNECT_H
 #define LITTLEFGCONNECT_FGCONNECT_H
 
+#include "callsignindex.h"
+#include "inputfilter.h"
+#include "stringpool.h"
+#include "trafficpredictor.h"
+#include "trafficstore.h"
+
 #include <QCache>
+#include <QDateTime>
 
 namespace atools {
 namespace fs {
 namespace sc {
 class SimConnectData;
 class SimConnectAircraft;
+struct MetarResult;
+}
 }
 }
+
+namespace lfgc {
+class FieldReader;
+struct PropertyChange;
 }
 
 namespace xpc {
@@ -41,9 +54,142 @@ public:
   XpConnect();
   ~XpConnect();
 
-  /* Fill SimConnectData from FlightGear datarefs. Returns true if data was found */
-  bool fillSimConnectData(QString simData, QString onlineStatus, atools::fs::sc::SimConnectData& data, bool fetchAi);
+  /* Fill SimConnectData from FlightGear datarefs. Returns true if data was found.
+   * simData is the raw datagram. */
+  bool fillSimConnectData(const QByteArray& simData, atools::fs::sc::SimConnectData& data, bool fetchAi);
+
+  /* Dual rate input. Fill SimConnectData from the compact high rate datagram containing
+   * only position, attitude and speeds. Merged with the last metadata received by updateMetadata(). */
+  bool fillKinematics(const QByteArray& simData, atools::fs::sc::SimConnectData& data, bool fetchAi);
+
+  /* Dual rate input. Read the low rate datagram containing titles, weight, fuel, ambient values and the
+   * AI objects. Used for all following frames built by fillKinematics(). */
+  void updateMetadata(const QByteArray& metaData, bool fetchAi);
+
+  /* Property listener input. Apply changed properties to the last values and build SimConnectData
+   * from them. Returns true if data is valid. */
+  bool applyProperties(const QVector<lfgc::PropertyChange>& changes, atools::fs::sc::SimConnectData& data,
+                       bool fetchAi);
+
+  /* Get the raw AI objects field of the last datagram if it was not taken yet. Decoding is done by the caller
+   * outside of the data lock. See lfgc::TrafficDecoder. */
+  bool takeAiObjects(QByteArray& aiObjects);
+
+  /* Replace the AI traffic with the decoded AI objects field */
+  void setAiTraffic(const lfgc::TrafficStore& traffic)
+  {
+    aiTraffic = traffic;
+  }
+
+  /* Replace the multiplayer traffic with the pilots of a completely parsed server dump received at
+   * monotonic time receiveTimeNs */
+  void setOnlineTraffic(const lfgc::TrafficStore& traffic, qint64 receiveTimeNs);
+
+  /* Extrapolate multiplayer traffic at most this number of seconds after a dump. 0 disables. */
+  void setPredictionLimitSeconds(float value)
+  {
+    onlinePredictor.setLimitSeconds(value);
+  }
+
+  /* Set smoothing filters for noisy values. Resets all filter states. */
+  void setInputFilters(const lfgc::InputFilters& value)
+  {
+    filters = value;
+    filters.reset();
+  }
+
+  /* Copy AI and online traffic from the traffic stores into data. Reuses the aircraft objects already in data
+   * and is called only right before serialization. Multiplayer traffic is extrapolated to monotonic time nowNs.
+   * Online pilots which are also in the AI objects are merged into one aircraft by callsign. */
+  void materializeTraffic(atools::fs::sc::SimConnectData& data, qint64 nowNs);
+
+  /* Remove all traffic from data without touching vectors shared with other copies */
+  static void dropTraffic(atools::fs::sc::SimConnectData& data);
+
+  /* Replace the weather request results in data */
+  static void setMetarResults(atools::fs::sc::SimConnectData& data,
+                              const QVector<atools::fs::sc::MetarResult>& metarResults);
+
+  /* Age and predicted flag for each traffic object of the last materializeTraffic() call */
+  const QVector<lfgc::TrafficStatus>& getTrafficStatus() const
+  {
+    return trafficStatus;
+  }
+
+private:
+  /* Fast changing values from the combined or the high rate datagram */
+  struct Kinematics
+  {
+    QDateTime zuluDateTime;
+    float latitude = 0.f, longitude = 0.f, altitudeAboveGroundFt = 0.f, groundAltitudeFt = 0.f,
+          indicatedAltitudeFt = 0.f, headingTrueDeg = 0.f, headingMagDeg = 0.f, trackTrueDeg = 0.f,
+          trackMagDeg = 0.f, groundSpeedKts = 0.f, indicatedSpeedKts = 0.f, trueAirspeedKts = 0.f,
+          machSpeed = 0.f, verticalSpeedFeetPerMin = 0.f;
+    bool freeze = false, replay = false;
+  };
+
+  /* Slow changing values from the combined or the low rate datagram */
+  struct Metadata
+  {
+    int timeLocalOffset = 0;
+    float windSpeedKts = 0.f, windDirectionDegT = 0.f, ambientTemperatureCelsius = 0.f, seaLevelPressureInhg = 0.f,
+          airplaneTotalWeightLbsYasim = 0.f, airplaneTotalWeightLbsJsbsim = 0.f, fuelTotalQuantityGallons = 0.f,
+          fuelTotalWeightLbs = 0.f, fuelFlowGPH = 0.f, fuelFlowPPS = 0.f, fuelFlowGPH0 = 0.f, fuelFlowGPH1 = 0.f,
+          fuelFlowGPH2 = 0.f, fuelFlowGPH3 = 0.f, magVarDeg = 0.f, ambientVisibilityMeter = 0.f;
+    QString airplaneTitle, airplaneModel, airplaneCallsign, multiplayerServer;
+    bool jsbsim = false, multiplayerOnline = false;
+  };
+
+  /* Parse date and time. Reuses the last value if unchanged which is the case for most frames. */
+  QDateTime readZuluDateTime(lfgc::FieldReader& reader);
+
+  /* Keep a copy of the AI objects field for takeAiObjects() or clear AI traffic if not fetched */
+  void storeAiObjects(const QByteArray& aiObjectsCombined, bool fetchAi);
+
+  /* Build user aircraft from kinematics and metadata and collect traffic */
+  bool buildSimConnectData(atools::fs::sc::SimConnectData& data, bool fetchAi);
+
+  /* Copy row of store into aircraft and trafficStatus at index. Object ids are numbered by position. */
+  void materializeRow(const lfgc::TrafficStore& store, int row, QVector<atools::fs::sc::SimConnectAircraft>& aircraft,
+                      int index);
+
+  /* Merge row of store into the already materialized aircraft at index. Position and movement are taken
+   * from the fresher sample and values missing in the aircraft are filled in. */
+  void mergeRow(const lfgc::TrafficStore& store, int row, QVector<atools::fs::sc::SimConnectAircraft>& aircraft,
+                int index);
+
+  Kinematics kinematics;
+  Metadata metadata;
+
+  /* Filters applied to kinematics before building the user aircraft */
+  lfgc::InputFilters filters;
+
+  /* Last parsed time string for reuse */
+  QByteArray lastTimegmt;
+  QDateTime lastZuluDateTime;
+
+  /* Shared strings for titles, models, callsigns and idents which rarely change between frames */
+  lfgc::StringPool stringPool;
+
+  /* Traffic from the FlightGear AI objects field */
+  lfgc::TrafficStore aiTraffic;
+
+  /* Raw AI objects field not decoded yet */
+  QByteArray pendingAiObjects;
+  bool aiObjectsPending = false;
+
+  /* Traffic from the multiplayer server online status extrapolated to the time of the last frame */
+  lfgc::TrafficStore onlineTraffic;
+  lfgc::TrafficPredictor onlinePredictor;
+
+  /* Traffic vectors of earlier frames. A vector not held by any frame anymore is reused including its strings
+   * instead of detaching the one in data. */
+  QVector<QVector<atools::fs::sc::SimConnectAircraft> > spareAircraft;
+
+  /* Finds online pilots in the AI traffic. Rebuilt for each frame without allocating. */
+  lfgc::CallsignIndex aiCallsignIndex;
 
+  QVector<lfgc::TrafficStatus> trafficStatus;
 };
 
 } // namespace lfgc
@@ -0,0 +1,192 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "fieldreader.h"
+
+#include "stringpool.h"
+
+#include <cstring>
+#include <limits>
+
+namespace lfgc {
+
+/* Powers of ten for the fraction part. More digits than this are ignored. */
+static const double POW10[] =
+{1., 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+static const int MAX_FRACTION_DIGITS = 18;
+
+FieldReader::FieldReader(const char *beginParam, const char *endParam, char separatorParam)
+  : pos(beginParam), bufEnd(endParam), separator(separatorParam)
+{
+
+}
+
+FieldReader::FieldReader(const QByteArray& bytes, char separatorParam)
+  : FieldReader(bytes.constData(), bytes.constData() + bytes.size(), separatorParam)
+{
+
+}
+
+bool FieldReader::next()
+{
+  if(done)
+  {
+    begin = end = bufEnd;
+    return false;
+  }
+
+  const char *sep = static_cast<const char *>(std::memchr(pos, separator, static_cast<size_t>(bufEnd - pos)));
+  begin = pos;
+  if(sep != nullptr)
+  {
+    end = sep;
+    pos = sep + 1;
+  }
+  else
+  {
+    // Last field
+    end = bufEnd;
+    pos = bufEnd;
+    done = true;
+  }
+  return true;
+}
+
+void FieldReader::skip(int num)
+{
+  for(int i = 0; i < num; i++)
+    next();
+}
+
+float FieldReader::readFloat()
+{
+  next();
+  return static_cast<float>(parseDouble(begin, fieldLength()));
+}
+
+double FieldReader::readDouble()
+{
+  next();
+  return parseDouble(begin, fieldLength());
+}
+
+int FieldReader::readInt()
+{
+  next();
+  return parseInt(begin, fieldLength());
+}
+
+const QString& FieldReader::readString(StringPool& pool)
+{
+  next();
+  return pool.intern(begin, fieldLength());
+}
+
+QByteArray FieldReader::readRaw()
+{
+  next();
+  return QByteArray::fromRawData(begin, fieldLength());
+}
+
+/* Trim whitespace like line feeds at the end of the datagram */
+static void trim(const char *& p, const char *& e)
+{
+  while(p < e && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    p++;
+  while(e > p && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r' || e[-1] == '\n'))
+    e--;
+}
+
+int FieldReader::parseInt(const char *str, int length)
+{
+  const char *p = str, *e = str + length;
+  trim(p, e);
+
+  bool negative = false;
+  if(p < e && (*p == '-' || *p == '+'))
+    negative = *p++ == '-';
+
+  if(p == e)
+    return 0;
+
+  qint64 value = 0;
+  while(p < e && *p >= '0' && *p <= '9')
+  {
+    value = value * 10 + (*p++ - '0');
+    if(value > static_cast<qint64>(std::numeric_limits<int>::max()) + 1)
+      return 0;
+  }
+
+  if(p < e)
+    // Fraction, exponent or garbage
+    return 0;
+
+  value = negative ? -value : value;
+  return value > std::numeric_limits<int>::max() ? 0 : static_cast<int>(value);
+}
+
+double FieldReader::parseDouble(const char *str, int length)
+{
+  const char *p = str, *e = str + length;
+  trim(p, e);
+
+  if(p == e)
+    return 0.;
+
+  bool negative = false;
+  if(*p == '-' || *p == '+')
+    negative = *p++ == '-';
+
+  double value = 0.;
+  bool digits = false;
+  while(p < e && *p >= '0' && *p <= '9')
+  {
+    value = value * 10. + (*p++ - '0');
+    digits = true;
+  }
+
+  if(p < e && *p == '.')
+  {
+    p++;
+    double fraction = 0.;
+    int numFraction = 0;
+    while(p < e && *p >= '0' && *p <= '9')
+    {
+      if(numFraction < MAX_FRACTION_DIGITS)
+      {
+        fraction = fraction * 10. + (*p - '0');
+        numFraction++;
+      }
+      p++;
+      digits = true;
+    }
+    value += fraction / POW10[numFraction];
+  }
+
+  if(p < e || !digits)
+  {
+    // Exponent, nan, inf or garbage - let Qt handle it which returns 0 for invalid numbers like QString::toFloat
+    bool ok;
+    double result = QByteArray(str, length).trimmed().toDouble(&ok);
+    return ok ? result : 0.;
+  }
+
+  return negative ? -value : value;
+}
+
+} // namespace lfgc
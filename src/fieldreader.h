@@ -0,0 +1,104 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_FIELDREADER_H
+#define LITTLEFGCONNECT_FIELDREADER_H
+
+#include <QByteArray>
+
+namespace lfgc {
+
+class StringPool;
+
+/*
+ * Reads separated fields from a byte buffer in place without splitting, copying or converting
+ * the buffer to QString. Missing fields at the end are returned as empty.
+ *
+ * The buffer must stay valid while the reader is used.
+ */
+class FieldReader
+{
+public:
+  FieldReader(const char *beginParam, const char *endParam, char separatorParam);
+  FieldReader(const QByteArray& bytes, char separatorParam);
+
+  /* Advance to the next field. Returns false if the end of the buffer was reached. */
+  bool next();
+
+  /* Skip number of fields */
+  void skip(int num = 1);
+
+  /* Access the current field after calling next() */
+  const char *fieldBegin() const
+  {
+    return begin;
+  }
+
+  const char *fieldEnd() const
+  {
+    return end;
+  }
+
+  int fieldLength() const
+  {
+    return static_cast<int>(end - begin);
+  }
+
+  bool isFieldEmpty() const
+  {
+    return begin == end;
+  }
+
+  /* Read the next field and convert it. Numbers are always parsed using the C locale.
+   * Like QString::toInt readInt() returns 0 for anything but an integer, e.g. for "7200.5". */
+  float readFloat();
+  double readDouble();
+  int readInt();
+
+  /* Returns an interned string */
+  const QString& readString(StringPool& pool);
+
+  /* Returns a view on the next field without copying. Only valid as long as the buffer is. */
+  QByteArray readRaw();
+
+  /* Remainder of the buffer starting after the current field */
+  const char *remainingBegin() const
+  {
+    return pos;
+  }
+
+  const char *bufferEnd() const
+  {
+    return bufEnd;
+  }
+
+  /* Locale independent number parser. Falls back to QByteArray::toDouble for anything unusual like "nan". */
+  static double parseDouble(const char *str, int length);
+
+  /* Integer parser which behaves like QString::toInt. Returns 0 for fractions, garbage and overflow. */
+  static int parseInt(const char *str, int length);
+
+private:
+  const char *pos, *bufEnd, *begin = nullptr, *end = nullptr;
+  bool done = false;
+  char separator;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_FIELDREADER_H
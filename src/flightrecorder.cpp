@@ -0,0 +1,233 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "flightrecorder.h"
+
+#include "fs/sc/simconnectdata.h"
+#include "fs/sc/simconnectuseraircraft.h"
+
+#include <QDebug>
+
+#include <cstddef>
+#include <cstring>
+
+namespace lfgc {
+
+/* Number of rows in a full chunk. One entry in the time index per chunk. */
+static const int CHUNK_ROWS = 1024;
+
+/* Write a partial chunk if its first frame is older than this. Limits the rows lost on a crash. */
+static const int CHUNK_FLUSH_MS = 5000;
+
+#define REC_COLUMN(name, type, field) {name, type, sizeof(RecorderFrame::field), offsetof(RecorderFrame, field)}
+
+static const RecorderColumnInfo COLUMNS[REC_NUM_COLUMNS] =
+{
+  REC_COLUMN("timestamp", REC_TYPE_INT64, timestampMs),
+  REC_COLUMN("lonx", REC_TYPE_DOUBLE, lonX),
+  REC_COLUMN("laty", REC_TYPE_DOUBLE, latY),
+  REC_COLUMN("altitude_above_ground", REC_TYPE_FLOAT, altitudeAboveGroundFt),
+  REC_COLUMN("indicated_altitude", REC_TYPE_FLOAT, indicatedAltitudeFt),
+  REC_COLUMN("ground_altitude", REC_TYPE_FLOAT, groundAltitudeFt),
+  REC_COLUMN("indicated_speed", REC_TYPE_FLOAT, indicatedSpeedKts),
+  REC_COLUMN("true_airspeed", REC_TYPE_FLOAT, trueAirspeedKts),
+  REC_COLUMN("ground_speed", REC_TYPE_FLOAT, groundSpeedKts),
+  REC_COLUMN("mach", REC_TYPE_FLOAT, machSpeed),
+  REC_COLUMN("vertical_speed", REC_TYPE_FLOAT, verticalSpeedFeetPerMin),
+  REC_COLUMN("heading_true", REC_TYPE_FLOAT, headingTrueDeg),
+  REC_COLUMN("track_true", REC_TYPE_FLOAT, trackTrueDeg),
+  REC_COLUMN("fuel_weight", REC_TYPE_FLOAT, fuelTotalWeightLbs),
+  REC_COLUMN("fuel_quantity", REC_TYPE_FLOAT, fuelTotalQuantityGallons),
+  REC_COLUMN("fuel_flow_pph", REC_TYPE_FLOAT, fuelFlowPPH),
+  REC_COLUMN("fuel_flow_gph", REC_TYPE_FLOAT, fuelFlowGPH),
+  REC_COLUMN("total_weight", REC_TYPE_FLOAT, airplaneTotalWeightLbs),
+  REC_COLUMN("empty_weight", REC_TYPE_FLOAT, airplaneEmptyWeightLbs),
+  REC_COLUMN("wind_speed", REC_TYPE_FLOAT, windSpeedKts),
+  REC_COLUMN("wind_direction", REC_TYPE_FLOAT, windDirectionDegT),
+  REC_COLUMN("temperature", REC_TYPE_FLOAT, ambientTemperatureCelsius),
+  REC_COLUMN("pressure", REC_TYPE_FLOAT, seaLevelPressureMbar),
+  REC_COLUMN("flags", REC_TYPE_UINT32, flags)
+};
+
+#undef REC_COLUMN
+
+const RecorderColumnInfo& recorderColumnInfo(int column)
+{
+  return COLUMNS[column];
+}
+
+void RecorderFrame::fromSimConnectData(const atools::fs::sc::SimConnectData& data, qint64 timestamp)
+{
+  const atools::fs::sc::SimConnectUserAircraft& ac = data.getUserAircraftConst();
+
+  timestampMs = timestamp;
+  lonX = static_cast<double>(ac.getPosition().getLonX());
+  latY = static_cast<double>(ac.getPosition().getLatY());
+  altitudeAboveGroundFt = ac.getAltitudeAboveGroundFt();
+  indicatedAltitudeFt = ac.getIndicatedAltitudeFt();
+  groundAltitudeFt = ac.getGroundAltitudeFt();
+  indicatedSpeedKts = ac.getIndicatedSpeedKts();
+  trueAirspeedKts = ac.getTrueAirspeedKts();
+  groundSpeedKts = ac.getGroundSpeedKts();
+  machSpeed = ac.getMachSpeed();
+  verticalSpeedFeetPerMin = ac.getVerticalSpeedFeetPerMin();
+  headingTrueDeg = ac.getHeadingDegTrue();
+  trackTrueDeg = ac.getTrackDegTrue();
+  fuelTotalWeightLbs = ac.getFuelTotalWeightLbs();
+  fuelTotalQuantityGallons = ac.getFuelTotalQuantityGallons();
+  fuelFlowPPH = ac.getFuelFlowPPH();
+  fuelFlowGPH = ac.getFuelFlowGPH();
+  airplaneTotalWeightLbs = ac.getAirplaneTotalWeightLbs();
+  airplaneEmptyWeightLbs = ac.getAirplaneEmptyWeightLbs();
+  windSpeedKts = ac.getWindSpeedKts();
+  windDirectionDegT = ac.getWindDirectionDegT();
+  ambientTemperatureCelsius = ac.getAmbientTemperatureCelsius();
+  seaLevelPressureMbar = ac.getSeaLevelPressureMbar();
+  flags = static_cast<quint32>(ac.getFlags());
+}
+
+// ======================================================================================
+FlightRecorder::FlightRecorder(const QString& filenameParam)
+  : filename(filenameParam), file(filenameParam)
+{
+  qDebug() << Q_FUNC_INFO << filename;
+  chunkFrames.reserve(CHUNK_ROWS);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+  qDebug() << Q_FUNC_INFO;
+}
+
+QString FlightRecorder::getSinkName() const
+{
+  return QString("Recorder %1").arg(filename);
+}
+
+bool FlightRecorder::writeFileHeader()
+{
+  RecorderFileHeader header;
+  header.magic = RECORDER_FILE_MAGIC;
+  header.version = RECORDER_FILE_VERSION;
+  header.numColumns = REC_NUM_COLUMNS;
+  header.reserved = 0;
+  if(file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header))
+    return false;
+
+  for(const RecorderColumnInfo& info : COLUMNS)
+  {
+    RecorderFileColumn column;
+    std::memset(&column, 0, sizeof(column));
+    std::strncpy(column.name, info.name, sizeof(column.name) - 1);
+    column.type = info.type;
+    column.size = static_cast<quint32>(info.size);
+    if(file.write(reinterpret_cast<const char *>(&column), sizeof(column)) != sizeof(column))
+      return false;
+  }
+  return true;
+}
+
+void FlightRecorder::writeChunk()
+{
+  if(chunkFrames.isEmpty())
+    return;
+
+  int numRows = chunkFrames.size();
+  int rowSize = 0;
+  for(const RecorderColumnInfo& info : COLUMNS)
+    rowSize += info.size;
+
+  RecorderChunkHeader header;
+  header.magic = RECORDER_CHUNK_MAGIC;
+  header.numRows = static_cast<quint32>(numRows);
+  header.firstTimestampMs = chunkFrames.constFirst().timestampMs;
+  header.lastTimestampMs = chunkFrames.constLast().timestampMs;
+  header.byteSize = sizeof(RecorderChunkHeader) + static_cast<quint64>(rowSize) * static_cast<quint64>(numRows);
+
+  // Transpose rows into columns - buffer keeps its capacity between chunks
+  chunkBuffer.resize(static_cast<int>(header.byteSize));
+  char *dest = chunkBuffer.data();
+  std::memcpy(dest, &header, sizeof(header));
+  dest += sizeof(header);
+
+  for(const RecorderColumnInfo& info : COLUMNS)
+  {
+    for(const RecorderFrame& frame : chunkFrames)
+    {
+      std::memcpy(dest, reinterpret_cast<const char *>(&frame) + info.frameOffset, static_cast<size_t>(info.size));
+      dest += info.size;
+    }
+  }
+
+  if(file.write(chunkBuffer) != chunkBuffer.size())
+    qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Error writing" << filename << file.errorString();
+  else
+  {
+    file.flush();
+    numWritten += static_cast<quint64>(numRows);
+  }
+  chunkFrames.clear();
+}
+
+bool FlightRecorder::openSink()
+{
+  if(!file.open(QIODevice::WriteOnly) || !writeFileHeader())
+  {
+    qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot open" << filename << file.errorString();
+    return false;
+  }
+  return true;
+}
+
+void FlightRecorder::writeFrame(const OutputFrame& frame)
+{
+  if(!frame.userChanged || !frame.data.getUserAircraftConst().getPosition().isValid())
+    return;
+
+  RecorderFrame recorderFrame;
+  recorderFrame.fromSimConnectData(frame.data, frame.timestampMs);
+  if(chunkFrames.isEmpty())
+    chunkTimer.start();
+  chunkFrames.append(recorderFrame);
+
+  if(chunkFrames.size() >= CHUNK_ROWS || chunkTimer.elapsed() >= CHUNK_FLUSH_MS)
+    writeChunk();
+}
+
+int FlightRecorder::getIdleTimeoutMs() const
+{
+  return CHUNK_FLUSH_MS;
+}
+
+void FlightRecorder::idle()
+{
+  // No frames arrived for a while - write what is buffered
+  if(!chunkFrames.isEmpty() && chunkTimer.elapsed() >= CHUNK_FLUSH_MS)
+    writeChunk();
+}
+
+void FlightRecorder::closeSink()
+{
+  // Write the last partial chunk
+  writeChunk();
+  file.close();
+
+  qInfo() << "LittleFgConnect" << Q_FUNC_INFO << "Recorded" << numWritten << "frames to" << filename;
+}
+
+} // namespace lfgc
@@ -0,0 +1,171 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_FLIGHTRECORDER_H
+#define LITTLEFGCONNECT_FLIGHTRECORDER_H
+
+#include "outputsink.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QVector>
+
+namespace atools {
+namespace fs {
+namespace sc {
+class SimConnectData;
+}
+}
+}
+
+namespace lfgc {
+
+/* One decoded frame of the user aircraft */
+struct RecorderFrame
+{
+  /* Milliseconds since epoch UTC */
+  qint64 timestampMs;
+  double lonX, latY;
+  float altitudeAboveGroundFt, indicatedAltitudeFt, groundAltitudeFt,
+        indicatedSpeedKts, trueAirspeedKts, groundSpeedKts, machSpeed, verticalSpeedFeetPerMin,
+        headingTrueDeg, trackTrueDeg,
+        fuelTotalWeightLbs, fuelTotalQuantityGallons, fuelFlowPPH, fuelFlowGPH,
+        airplaneTotalWeightLbs, airplaneEmptyWeightLbs,
+        windSpeedKts, windDirectionDegT, ambientTemperatureCelsius, seaLevelPressureMbar;
+
+  /* atools::fs::sc::Flags */
+  quint32 flags;
+
+  /* Fill from the user aircraft of the given data */
+  void fromSimConnectData(const atools::fs::sc::SimConnectData& data, qint64 timestamp);
+};
+
+/* Column indexes. Order defines the order in the file. */
+enum RecorderColumn
+{
+  REC_TIMESTAMP, REC_LONX, REC_LATY,
+  REC_ALTITUDE_ABOVE_GROUND, REC_INDICATED_ALTITUDE, REC_GROUND_ALTITUDE,
+  REC_INDICATED_SPEED, REC_TRUE_AIRSPEED, REC_GROUND_SPEED, REC_MACH, REC_VERTICAL_SPEED,
+  REC_HEADING_TRUE, REC_TRACK_TRUE,
+  REC_FUEL_WEIGHT, REC_FUEL_QUANTITY, REC_FUEL_FLOW_PPH, REC_FUEL_FLOW_GPH,
+  REC_TOTAL_WEIGHT, REC_EMPTY_WEIGHT,
+  REC_WIND_SPEED, REC_WIND_DIRECTION, REC_TEMPERATURE, REC_PRESSURE,
+  REC_FLAGS,
+  REC_NUM_COLUMNS
+};
+
+enum RecorderColumnType : quint8
+{
+  REC_TYPE_INT64, REC_TYPE_DOUBLE, REC_TYPE_FLOAT, REC_TYPE_UINT32
+};
+
+/* Describes where a column is found in RecorderFrame */
+struct RecorderColumnInfo
+{
+  const char *name;
+  RecorderColumnType type;
+  int size, frameOffset;
+};
+
+/* Table of all columns indexed by RecorderColumn */
+const RecorderColumnInfo& recorderColumnInfo(int column);
+
+/*
+ * File layout - all values little endian as written by the platform:
+ *
+ * RecorderFileHeader
+ * RecorderFileHeader::numColumns * RecorderFileColumn
+ * Chunks until end of file. Each chunk:
+ *   RecorderChunkHeader
+ *   For each column numRows values of the column size. Columns follow each other without gaps.
+ *
+ * The chunk headers form a sparse time index which allows to seek without reading the columns.
+ * A truncated last chunk of a crashed session is ignored by the reader.
+ */
+const quint32 RECORDER_FILE_MAGIC = 0x52474c46; // "FLGR"
+const quint32 RECORDER_CHUNK_MAGIC = 0x43474c46; // "FLGC"
+const quint32 RECORDER_FILE_VERSION = 1;
+
+struct RecorderFileHeader
+{
+  quint32 magic, version, numColumns, reserved;
+};
+
+struct RecorderFileColumn
+{
+  char name[24];
+  quint32 type, size;
+};
+
+struct RecorderChunkHeader
+{
+  quint32 magic, numRows;
+  qint64 firstTimestampMs, lastTimestampMs;
+
+  /* Size including this header */
+  quint64 byteSize;
+};
+
+/*
+ * Output sink which appends the user aircraft of published frames to a columnar, chunked binary file.
+ * See FlightRecordReader for reading.
+ *
+ * Runs in its own thread as part of the OutputPipeline. Frames which only update the traffic or
+ * have no valid position are skipped. A chunk is written when it is full or when its first frame is
+ * older than a few seconds, also if no more frames arrive.
+ */
+class FlightRecorder :
+  public OutputSink
+{
+public:
+  explicit FlightRecorder(const QString& filenameParam);
+  virtual ~FlightRecorder() override;
+
+  virtual QString getSinkName() const override;
+  virtual bool openSink() override;
+  virtual void writeFrame(const OutputFrame& frame) override;
+  virtual int getIdleTimeoutMs() const override;
+  virtual void idle() override;
+  virtual void closeSink() override;
+
+  const QString& getFilename() const
+  {
+    return filename;
+  }
+
+private:
+  bool writeFileHeader();
+
+  /* Transpose all frames into column order and write one chunk */
+  void writeChunk();
+
+  QString filename;
+  QFile file;
+
+  /* Frames collected for the next chunk */
+  QVector<RecorderFrame> chunkFrames;
+
+  /* Started with the first frame of a chunk */
+  QElapsedTimer chunkTimer;
+  QByteArray chunkBuffer;
+  quint64 numWritten = 0;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_FLIGHTRECORDER_H
@@ -0,0 +1,279 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "flightrecordreader.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace lfgc {
+
+FlightRecordReader::FlightRecordReader()
+{
+  // Columns are stored one after the other in each chunk - offset is sum of previous column sizes * rows
+  for(int i = 0; i < REC_NUM_COLUMNS; i++)
+  {
+    columnOffsetPerRow[i] = rowSize;
+    rowSize += recorderColumnInfo(i).size;
+  }
+}
+
+FlightRecordReader::~FlightRecordReader()
+{
+  close();
+}
+
+bool FlightRecordReader::open(const QString& filename)
+{
+  close();
+
+  file.setFileName(filename);
+  if(!file.open(QIODevice::ReadOnly))
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot open" << filename << file.errorString();
+    return false;
+  }
+
+  qint64 fileSize = file.size();
+  mapped = file.map(0, fileSize);
+  if(mapped == nullptr)
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot map" << filename << file.errorString();
+    close();
+    return false;
+  }
+
+  // Check header and column layout
+  qint64 pos = sizeof(RecorderFileHeader) + sizeof(RecorderFileColumn) * REC_NUM_COLUMNS;
+  if(fileSize < pos)
+  {
+    qWarning() << Q_FUNC_INFO << "File too small" << filename;
+    close();
+    return false;
+  }
+
+  RecorderFileHeader header;
+  std::memcpy(&header, mapped, sizeof(header));
+  if(header.magic != RECORDER_FILE_MAGIC || header.version != RECORDER_FILE_VERSION ||
+     header.numColumns != REC_NUM_COLUMNS)
+  {
+    qWarning() << Q_FUNC_INFO << "Invalid header or version" << filename << header.version;
+    close();
+    return false;
+  }
+
+  for(int i = 0; i < REC_NUM_COLUMNS; i++)
+  {
+    RecorderFileColumn column;
+    std::memcpy(&column, mapped + sizeof(RecorderFileHeader) + sizeof(RecorderFileColumn) * static_cast<size_t>(i),
+                sizeof(column));
+    if(column.type != recorderColumnInfo(i).type || static_cast<int>(column.size) != recorderColumnInfo(i).size)
+    {
+      qWarning() << Q_FUNC_INFO << "Column mismatch" << filename << column.name;
+      close();
+      return false;
+    }
+  }
+
+  // Walk the chunk headers to build the time index
+  while(pos + static_cast<qint64>(sizeof(RecorderChunkHeader)) <= fileSize)
+  {
+    RecorderChunkHeader chunkHeader;
+    std::memcpy(&chunkHeader, mapped + pos, sizeof(chunkHeader));
+
+    if(chunkHeader.magic != RECORDER_CHUNK_MAGIC ||
+       chunkHeader.byteSize > static_cast<quint64>(fileSize - pos))
+    {
+      // Truncated by a crash
+      qWarning() << Q_FUNC_INFO << "Ignoring incomplete chunk at" << pos << "in" << filename;
+      break;
+    }
+
+    // Size has to match the rows - also catches a zero size which would never advance
+    if(chunkHeader.numRows == 0 ||
+       chunkHeader.byteSize != sizeof(RecorderChunkHeader) + static_cast<quint64>(chunkHeader.numRows) * rowSize ||
+       chunkHeader.numRows > static_cast<quint32>(std::numeric_limits<int>::max() - numRows))
+    {
+      qWarning() << Q_FUNC_INFO << "Ignoring invalid chunk at" << pos << "in" << filename
+                 << "rows" << chunkHeader.numRows << "size" << chunkHeader.byteSize;
+      break;
+    }
+
+    Chunk chunk;
+    chunk.data = mapped + pos + sizeof(RecorderChunkHeader);
+    chunk.firstRow = numRows;
+    chunk.numRows = static_cast<int>(chunkHeader.numRows);
+    chunk.firstTimestampMs = chunkHeader.firstTimestampMs;
+    chunk.lastTimestampMs = chunkHeader.lastTimestampMs;
+    chunks.append(chunk);
+
+    numRows += chunk.numRows;
+    pos += static_cast<qint64>(chunkHeader.byteSize);
+  }
+
+  qDebug() << Q_FUNC_INFO << filename << "chunks" << chunks.size() << "rows" << numRows;
+  return true;
+}
+
+void FlightRecordReader::close()
+{
+  if(mapped != nullptr)
+  {
+    file.unmap(const_cast<uchar *>(mapped));
+    mapped = nullptr;
+  }
+  file.close();
+  chunks.clear();
+  numRows = 0;
+}
+
+qint64 FlightRecordReader::getFirstTimestampMs() const
+{
+  return chunks.isEmpty() ? 0 : chunks.constFirst().firstTimestampMs;
+}
+
+qint64 FlightRecordReader::getLastTimestampMs() const
+{
+  return chunks.isEmpty() ? 0 : chunks.constLast().lastTimestampMs;
+}
+
+int FlightRecordReader::chunkIndex(int row) const
+{
+  auto it = std::upper_bound(chunks.constBegin(), chunks.constEnd(), row, [](int r, const Chunk& chunk) {
+    return r < chunk.firstRow;
+  });
+  return static_cast<int>(it - chunks.constBegin()) - 1;
+}
+
+const uchar *FlightRecordReader::valuePtr(const Chunk& chunk, int column, int rowInChunk) const
+{
+  return chunk.data + columnOffsetPerRow[column] * chunk.numRows + recorderColumnInfo(column).size * rowInChunk;
+}
+
+int FlightRecordReader::findRow(qint64 timestampMs) const
+{
+  // Find chunk using the sparse index first
+  auto it = std::lower_bound(chunks.constBegin(), chunks.constEnd(), timestampMs,
+                             [](const Chunk& chunk, qint64 ts) {
+    return chunk.lastTimestampMs < ts;
+  });
+
+  if(it == chunks.constEnd())
+    return numRows;
+
+  // Binary search in the timestamp column of this chunk only
+  const Chunk& chunk = *it;
+  int lo = 0, hi = chunk.numRows;
+  while(lo < hi)
+  {
+    int mid = (lo + hi) / 2;
+    qint64 ts;
+    std::memcpy(&ts, valuePtr(chunk, REC_TIMESTAMP, mid), sizeof(ts));
+    if(ts < timestampMs)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return chunk.firstRow + lo;
+}
+
+bool FlightRecordReader::readFrame(int row, RecorderFrame& frame) const
+{
+  if(row < 0 || row >= numRows)
+    return false;
+
+  const Chunk& chunk = chunks.at(chunkIndex(row));
+  int rowInChunk = row - chunk.firstRow;
+  for(int i = 0; i < REC_NUM_COLUMNS; i++)
+  {
+    const RecorderColumnInfo& info = recorderColumnInfo(i);
+    std::memcpy(reinterpret_cast<char *>(&frame) + info.frameOffset, valuePtr(chunk, i, rowInChunk),
+                static_cast<size_t>(info.size));
+  }
+  return true;
+}
+
+/* Convert a raw value to double */
+static double toDouble(RecorderColumnType type, const uchar *ptr)
+{
+  switch(type)
+  {
+    case REC_TYPE_INT64:
+    {
+      qint64 value;
+      std::memcpy(&value, ptr, sizeof(value));
+      return static_cast<double>(value);
+    }
+    case REC_TYPE_DOUBLE:
+    {
+      double value;
+      std::memcpy(&value, ptr, sizeof(value));
+      return value;
+    }
+    case REC_TYPE_FLOAT:
+    {
+      float value;
+      std::memcpy(&value, ptr, sizeof(value));
+      return static_cast<double>(value);
+    }
+    case REC_TYPE_UINT32:
+    {
+      quint32 value;
+      std::memcpy(&value, ptr, sizeof(value));
+      return static_cast<double>(value);
+    }
+  }
+  return 0.;
+}
+
+double FlightRecordReader::value(int column, int row, bool *ok) const
+{
+  bool valid = column >= 0 && column < REC_NUM_COLUMNS && row >= 0 && row < numRows;
+  if(ok != nullptr)
+    *ok = valid;
+  if(!valid)
+    return 0.;
+
+  const Chunk& chunk = chunks.at(chunkIndex(row));
+  return toDouble(recorderColumnInfo(column).type, valuePtr(chunk, column, row - chunk.firstRow));
+}
+
+void FlightRecordReader::readColumn(int column, int row, int numRowsToRead, QVector<double>& values) const
+{
+  if(column < 0 || column >= REC_NUM_COLUMNS || row < 0 || numRowsToRead <= 0)
+    return;
+
+  const RecorderColumnInfo& info = recorderColumnInfo(column);
+  int end = row + std::min(numRowsToRead, numRows - std::min(row, numRows));
+  values.reserve(values.size() + std::max(end - row, 0));
+
+  // Values are contiguous within a chunk - only the touched column pages are read
+  for(int c = row < end ? chunkIndex(row) : chunks.size(); c < chunks.size() && row < end; c++)
+  {
+    const Chunk& chunk = chunks.at(c);
+    int chunkEnd = std::min(end, chunk.firstRow + chunk.numRows);
+    const uchar *ptr = valuePtr(chunk, column, row - chunk.firstRow);
+    for(; row < chunkEnd; row++, ptr += info.size)
+      values.append(toDouble(info.type, ptr));
+  }
+}
+
+} // namespace lfgc
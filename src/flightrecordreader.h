@@ -0,0 +1,97 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_FLIGHTRECORDREADER_H
+#define LITTLEFGCONNECT_FLIGHTRECORDREADER_H
+
+#include "flightrecorder.h"
+
+#include <QFile>
+#include <QVector>
+
+namespace lfgc {
+
+/*
+ * Reads files written by FlightRecorder.
+ *
+ * The file is memory mapped. Opening only walks the chunk headers to build the time index.
+ * Single values or whole columns can be read without touching the other columns.
+ * Rows are numbered from 0 across all chunks.
+ */
+class FlightRecordReader
+{
+public:
+  FlightRecordReader();
+  ~FlightRecordReader();
+
+  bool open(const QString& filename);
+  void close();
+
+  /* Total number of rows in all complete chunks */
+  int size() const
+  {
+    return numRows;
+  }
+
+  /* Timestamp range of the recording in milliseconds since epoch */
+  qint64 getFirstTimestampMs() const;
+  qint64 getLastTimestampMs() const;
+
+  /* Row of the first frame with a timestamp equal to or later than timestampMs.
+   * Returns size() if all frames are earlier. */
+  int findRow(qint64 timestampMs) const;
+
+  /* Gather all columns of a row into a frame. Returns false if row is out of range. */
+  bool readFrame(int row, RecorderFrame& frame) const;
+
+  /* Read one value converted to double. Returns 0 and sets ok to false if row or column is out of range. */
+  double value(int column, int row, bool *ok = nullptr) const;
+
+  /* Read numRows values of a column converted to double starting at row and append them to values */
+  void readColumn(int column, int row, int numRows, QVector<double>& values) const;
+
+private:
+  struct Chunk
+  {
+    /* Pointer to the first column in the mapped file */
+    const uchar *data;
+    int firstRow, numRows;
+    qint64 firstTimestampMs, lastTimestampMs;
+  };
+
+  /* Index of the chunk containing row */
+  int chunkIndex(int row) const;
+
+  /* Pointer to the value in the mapped file */
+  const uchar *valuePtr(const Chunk& chunk, int column, int rowInChunk) const;
+
+  QFile file;
+  const uchar *mapped = nullptr;
+  QVector<Chunk> chunks;
+  int numRows = 0;
+
+  /* Byte offset of each column relative to the chunk data for one row */
+  int columnOffsetPerRow[REC_NUM_COLUMNS];
+
+  /* Size of all columns of one row */
+  int rowSize = 0;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_FLIGHTRECORDREADER_H
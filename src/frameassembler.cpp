@@ -0,0 +1,255 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "frameassembler.h"
+
+#include "fieldreader.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+namespace lfgc {
+
+static const char FRAME_MAGIC[] = "LFGF;";
+
+/* Maximum number of frames being assembled at the same time */
+static const int MAX_PARTIAL_FRAMES = 8;
+
+/* Limits buffer usage to MAX_PARTIAL_FRAMES * MAX_FRAGMENTS datagrams */
+static const int MAX_FRAGMENTS = 64;
+
+/* Reserve for the header "LFGF;4294967295;63;64;" */
+static const int MAX_HEADER_SIZE = 24;
+
+/* A sequence this far behind the last completed one cannot be reordering */
+static const quint32 MAX_BACKWARD_JUMP = 1000;
+
+/* Stale fragments in a row which indicate a restarted sender */
+static const int MAX_STALE_IN_ROW = 16;
+
+/* Accept any sequence after receiving no complete frame for this number of timeouts */
+static const int RESTART_TIMEOUTS = 4;
+
+FrameAssembler::FrameAssembler(int timeoutMsParam)
+  : timeoutMs(timeoutMsParam)
+{
+  partials.resize(MAX_PARTIAL_FRAMES);
+  for(PartialFrame& partial : partials)
+    partial.fragments.reserve(MAX_FRAGMENTS);
+}
+
+bool FrameAssembler::isFramed(const QByteArray& datagram)
+{
+  return datagram.startsWith(FRAME_MAGIC);
+}
+
+QVector<QByteArray> FrameAssembler::split(const QByteArray& payload, quint32 sequence, int maxDatagramSize)
+{
+  int fragmentSize = std::max(maxDatagramSize - MAX_HEADER_SIZE, 1);
+  int count = std::max((payload.size() + fragmentSize - 1) / fragmentSize, 1);
+
+  QVector<QByteArray> datagrams;
+  if(count > MAX_FRAGMENTS)
+  {
+    qWarning() << Q_FUNC_INFO << "Payload too large" << payload.size() << "for" << MAX_FRAGMENTS << "fragments";
+    return datagrams;
+  }
+
+  for(int i = 0; i < count; i++)
+  {
+    QByteArray datagram(FRAME_MAGIC);
+    datagram.append(QByteArray::number(sequence)).append(';').
+    append(QByteArray::number(i)).append(';').
+    append(QByteArray::number(count)).append(';').
+    append(payload.mid(i * fragmentSize, fragmentSize));
+    datagrams.append(datagram);
+  }
+  return datagrams;
+}
+
+void FrameAssembler::reset()
+{
+  restart();
+  statistics = FrameAssemblerStatistics();
+}
+
+void FrameAssembler::restart()
+{
+  for(PartialFrame& partial : partials)
+    release(partial);
+  hasCompleted = false;
+  lastCompleted = 0;
+  lastCompletedMs = 0;
+  staleInRow = 0;
+}
+
+bool FrameAssembler::isRestart(quint32 sequence, qint64 nowMs) const
+{
+  return lastCompleted - sequence > MAX_BACKWARD_JUMP ||
+         staleInRow + 1 >= MAX_STALE_IN_ROW ||
+         nowMs - lastCompletedMs > static_cast<qint64>(timeoutMs) * RESTART_TIMEOUTS;
+}
+
+void FrameAssembler::release(PartialFrame& partial)
+{
+  partial.used = false;
+  partial.received = 0;
+  partial.fragments.clear();
+}
+
+void FrameAssembler::expire(qint64 nowMs)
+{
+  for(PartialFrame& partial : partials)
+  {
+    if(partial.used && nowMs - partial.firstReceivedMs > timeoutMs)
+    {
+      statistics.timedOut++;
+      release(partial);
+    }
+  }
+}
+
+FrameAssembler::PartialFrame *FrameAssembler::findOrAllocate(quint32 sequence, int count, qint64 nowMs)
+{
+  PartialFrame *freeSlot = nullptr, *oldest = nullptr;
+  for(PartialFrame& partial : partials)
+  {
+    if(partial.used)
+    {
+      if(partial.sequence == sequence)
+        return &partial;
+
+      if(oldest == nullptr || isNewer(oldest->sequence, partial.sequence))
+        oldest = &partial;
+    }
+    else if(freeSlot == nullptr)
+      freeSlot = &partial;
+  }
+
+  if(freeSlot == nullptr)
+  {
+    // All slots in use - drop the oldest partial frame
+    statistics.evicted++;
+    release(*oldest);
+    freeSlot = oldest;
+  }
+
+  freeSlot->used = true;
+  freeSlot->sequence = sequence;
+  freeSlot->count = count;
+  freeSlot->received = 0;
+  freeSlot->firstReceivedMs = nowMs;
+  freeSlot->fragments.resize(count);
+  return freeSlot;
+}
+
+bool FrameAssembler::addDatagram(const QByteArray& datagram, qint64 nowMs, QByteArray& frame)
+{
+  expire(nowMs);
+
+  // Header "LFGF;<sequence>;<index>;<count>;"
+  FieldReader reader(datagram, ';');
+  reader.skip();
+  bool seqOk, indexOk, countOk;
+  reader.next();
+  quint32 sequence = QByteArray::fromRawData(reader.fieldBegin(), reader.fieldLength()).toUInt(&seqOk);
+  reader.next();
+  int index = QByteArray::fromRawData(reader.fieldBegin(), reader.fieldLength()).toInt(&indexOk);
+  reader.next();
+  int count = QByteArray::fromRawData(reader.fieldBegin(), reader.fieldLength()).toInt(&countOk);
+
+  if(!seqOk || !indexOk || !countOk || count < 1 || count > MAX_FRAGMENTS || index < 0 || index >= count)
+  {
+    statistics.invalid++;
+    return false;
+  }
+
+  if(hasCompleted && !isNewer(sequence, lastCompleted))
+  {
+    if(isRestart(sequence, nowMs))
+    {
+      // Sender started over at a lower sequence - would otherwise be dropped forever
+      qDebug() << Q_FUNC_INFO << "Sender restart at sequence" << sequence << "after" << lastCompleted;
+      statistics.restarts++;
+      restart();
+    }
+    else
+    {
+      // Reordered or duplicated - would move time backwards
+      statistics.stale++;
+      staleInRow++;
+      return false;
+    }
+  }
+  staleInRow = 0;
+
+  int payloadOffset = static_cast<int>(reader.remainingBegin() - datagram.constData());
+
+  if(count == 1)
+    // Not split - avoid the partial buffers
+    frame = datagram.mid(payloadOffset);
+  else
+  {
+    PartialFrame *partial = findOrAllocate(sequence, count, nowMs);
+    if(partial->count != count)
+    {
+      statistics.invalid++;
+      return false;
+    }
+
+    QByteArray& fragment = partial->fragments[index];
+    if(!fragment.isNull())
+    {
+      statistics.duplicates++;
+      return false;
+    }
+
+    fragment = datagram.mid(payloadOffset);
+    if(++partial->received < count)
+      return false;
+
+    int size = 0;
+    for(const QByteArray& f : partial->fragments)
+      size += f.size();
+
+    frame.clear();
+    frame.reserve(size);
+    for(const QByteArray& f : partial->fragments)
+      frame.append(f);
+    release(*partial);
+  }
+
+  hasCompleted = true;
+  lastCompleted = sequence;
+  lastCompletedMs = nowMs;
+  statistics.completed++;
+
+  // Partial frames older than this one can never be published
+  for(PartialFrame& partial : partials)
+  {
+    if(partial.used && !isNewer(partial.sequence, sequence))
+    {
+      statistics.stale++;
+      release(partial);
+    }
+  }
+  return true;
+}
+
+} // namespace lfgc
@@ -0,0 +1,125 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_FRAMEASSEMBLER_H
+#define LITTLEFGCONNECT_FRAMEASSEMBLER_H
+
+#include <QByteArray>
+#include <QVector>
+
+namespace lfgc {
+
+/* Counters of the frame assembler */
+struct FrameAssemblerStatistics
+{
+  quint64 completed = 0;
+
+  /* Partial frames dropped after the timeout or to make room for newer frames */
+  quint64 timedOut = 0, evicted = 0;
+
+  /* Frames older than the last completed one and fragments received twice */
+  quint64 stale = 0, duplicates = 0;
+
+  /* Fragments with an invalid header */
+  quint64 invalid = 0;
+
+  /* Sender restarts detected from the sequence numbers or a receive gap */
+  quint64 restarts = 0;
+};
+
+/*
+ * Reassembles frames which were split across several datagrams.
+ *
+ * A framed datagram looks like "LFGF;<sequence>;<index>;<count>;<payload>". The payloads of all
+ * fragments of a sequence concatenated by index give one datagram of the combined layout.
+ * Datagrams not starting with "LFGF;" are not framed and have to be passed on unchanged.
+ *
+ * A bounded number of partial frames is kept. Partial frames are dropped after a timeout. Completed
+ * frames with a sequence not newer than the last completed one are discarded so that the published
+ * time never goes backwards. Sequence numbers can wrap.
+ *
+ * A sender restart begins again at a low sequence. This is detected by a large backward jump, a run of
+ * stale fragments or a gap in reception. The last sequence is forgotten in this case.
+ *
+ * Not thread safe. Used in the main thread.
+ */
+class FrameAssembler
+{
+public:
+  explicit FrameAssembler(int timeoutMsParam = 500);
+
+  /* True if the datagram has the frame header */
+  static bool isFramed(const QByteArray& datagram);
+
+  /* Split payload into framed datagrams which are not larger than maxDatagramSize */
+  static QVector<QByteArray> split(const QByteArray& payload, quint32 sequence, int maxDatagramSize);
+
+  /* Add a framed datagram. Returns true and fills frame if a frame was completed by this fragment.
+   * nowMs is a monotonic time in milliseconds. */
+  bool addDatagram(const QByteArray& datagram, qint64 nowMs, QByteArray& frame);
+
+  /* Forget all partial frames, the last sequence and the statistics. Call on reconnect. */
+  void reset();
+
+  const FrameAssemblerStatistics& getStatistics() const
+  {
+    return statistics;
+  }
+
+private:
+  struct PartialFrame
+  {
+    quint32 sequence = 0;
+    int count = 0, received = 0;
+    qint64 firstReceivedMs = 0;
+    bool used = false;
+    QVector<QByteArray> fragments;
+  };
+
+  /* Serial number comparison which works across wrap around */
+  static bool isNewer(quint32 sequence, quint32 other)
+  {
+    return static_cast<qint32>(sequence - other) > 0;
+  }
+
+  void expire(qint64 nowMs);
+  PartialFrame *findOrAllocate(quint32 sequence, int count, qint64 nowMs);
+  void release(PartialFrame& partial);
+
+  /* Forget partial frames and the last sequence */
+  void restart();
+
+  /* True if sequence is stale but the sender was probably restarted */
+  bool isRestart(quint32 sequence, qint64 nowMs) const;
+
+  int timeoutMs;
+  QVector<PartialFrame> partials;
+
+  bool hasCompleted = false;
+  quint32 lastCompleted = 0;
+  qint64 lastCompletedMs = 0;
+
+  /* Stale fragments received since the last accepted one */
+  int staleInRow = 0;
+
+  FrameAssemblerStatistics statistics;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_FRAMEASSEMBLER_H
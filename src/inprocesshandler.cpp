@@ -0,0 +1,182 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "inprocesshandler.h"
+
+#include "fgconnect.h"
+#include "fs/sc/simconnectuseraircraft.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+namespace lfgc {
+
+InProcessHandler::InProcessHandler()
+{
+  qDebug() << Q_FUNC_INFO;
+}
+
+InProcessHandler::~InProcessHandler()
+{
+  qDebug() << Q_FUNC_INFO << "in process" << numInProcessFetches << "shared memory" << numSharedMemoryFetches
+           << "weather requests" << numWeatherRequests << "answered from cache" << numWeatherHits;
+}
+
+void InProcessHandler::publish(const OutputFramePtr& value)
+{
+  QMutexLocker locker(&frameMutex);
+  frame = value;
+}
+
+void InProcessHandler::setUpdateRateMs(int value)
+{
+  updateRateMs.store(value);
+
+  // Leave a pending wait which might be too long for the new rate
+  QMutexLocker locker(&waitMutex);
+  waitCondition.wakeAll();
+}
+
+void InProcessHandler::setAdaptiveIntervalMs(int value)
+{
+  adaptiveIntervalMs.store(value);
+
+  QMutexLocker locker(&waitMutex);
+  waitCondition.wakeAll();
+}
+
+void InProcessHandler::cancelWait()
+{
+  QMutexLocker locker(&waitMutex);
+  waitCanceled = true;
+  waitCondition.wakeAll();
+}
+
+void InProcessHandler::waitForNextFetch()
+{
+  QMutexLocker locker(&waitMutex);
+  if(fetchTimer.isValid())
+  {
+    // The sleep of the reader thread is part of the elapsed time
+    qint64 remainingMs;
+    while(!waitCanceled && (remainingMs = fetchIntervalMs() - fetchTimer.elapsed()) > 0)
+      waitCondition.wait(&waitMutex, static_cast<unsigned long>(remainingMs));
+  }
+  fetchTimer.start();
+}
+
+OutputFramePtr InProcessHandler::latestFrame() const
+{
+  QMutexLocker locker(&frameMutex);
+  return frame;
+}
+
+bool InProcessHandler::connect()
+{
+  if(!latestFrame().isNull())
+    return true;
+
+  return atools::fs::sc::XpConnectHandler::connect();
+}
+
+bool InProcessHandler::isConnected() const
+{
+  if(!latestFrame().isNull())
+    return true;
+
+  return atools::fs::sc::XpConnectHandler::isConnected();
+}
+
+bool InProcessHandler::fetchData(atools::fs::sc::SimConnectData& data, int radiusKm, atools::fs::sc::Options options)
+{
+  waitForNextFetch();
+
+  OutputFramePtr latest = latestFrame();
+  if(latest.isNull())
+  {
+    numSharedMemoryFetches++;
+    return atools::fs::sc::XpConnectHandler::fetchData(data, radiusKm, options);
+  }
+
+  // Shares all containers with the frame - lock is not held while copying
+  data = latest->data;
+  numInProcessFetches++;
+
+  if(latest->userChanged && latest->sequence != lastRecordedSequence)
+  {
+    lastRecordedSequence = latest->sequence;
+    weatherCache.record(data.getUserAircraftConst());
+  }
+
+  QVector<atools::fs::sc::SimConnectAircraft>& aircraft = data.getAiAircraft();
+  if(!(options & atools::fs::sc::FETCH_AI_AIRCRAFT))
+    aircraft.clear();
+  else if(radiusKm > 0 && !aircraft.isEmpty())
+  {
+    // Detaches only if something is removed
+    const atools::geo::Pos& userPos = data.getUserAircraftConst().getPosition();
+    float radiusMeter = radiusKm * 1000.f;
+    auto outside = [&userPos, radiusMeter](const atools::fs::sc::SimConnectAircraft& ac) {
+      return ac.getPosition().distanceMeterTo(userPos) > radiusMeter;
+    };
+
+    const QVector<atools::fs::sc::SimConnectAircraft>& constAircraft = aircraft;
+    if(std::any_of(constAircraft.constBegin(), constAircraft.constEnd(), outside))
+      aircraft.erase(std::remove_if(aircraft.begin(), aircraft.end(), outside), aircraft.end());
+  }
+  return true;
+}
+
+void InProcessHandler::addWeatherRequest(const atools::fs::sc::WeatherRequest& request)
+{
+  weatherRequest = request;
+  atools::fs::sc::XpConnectHandler::addWeatherRequest(request);
+}
+
+const atools::fs::sc::WeatherRequest& InProcessHandler::getWeatherRequest() const
+{
+  return weatherRequest;
+}
+
+bool InProcessHandler::fetchWeatherData(atools::fs::sc::SimConnectData& data)
+{
+  if(latestFrame().isNull())
+    return atools::fs::sc::XpConnectHandler::fetchWeatherData(data);
+
+  if(!weatherRequest.isValid())
+    return false;
+
+  // Answer with an empty result if nothing is cached to avoid waiting clients
+  atools::fs::sc::MetarResult result;
+  numWeatherRequests++;
+  if(weatherCache.lookup(weatherRequest.getStation(), weatherRequest.getPosition(), result))
+    numWeatherHits++;
+  else
+  {
+    result.requestIdent = weatherRequest.getStation();
+    result.requestPos = weatherRequest.getPosition();
+    result.timestamp = QDateTime::currentDateTimeUtc();
+  }
+
+  xpc::XpConnect::setMetarResults(data, {result});
+  return true;
+}
+
+} // namespace lfgc
@@ -0,0 +1,127 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLEFGCONNECT_INPROCESSHANDLER_H
+#define LITTLEFGCONNECT_INPROCESSHANDLER_H
+
+#include "outputsink.h"
+#include "weathercache.h"
+
+#include "fs/sc/weatherrequest.h"
+#include "fs/sc/xpconnecthandler.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+
+namespace lfgc {
+
+/*
+ * Connect handler for the DataReaderThread which takes the frames published by the SharedMemoryWriter
+ * of the same process instead of reading and deserializing the shared memory.
+ *
+ * The writer passes each frame as an immutable shared snapshot. fetchData() copies the latest one which
+ * only shares the aircraft vectors and strings. Falls back to the shared memory of the base class if no
+ * writer publishes frames, e.g. if another process owns the shared memory.
+ *
+ * Weather requests are answered from a WeatherCache which is filled with the ambient values of the user
+ * aircraft of each new frame.
+ *
+ * The DataReaderThread runs with the short update rate READER_TICK_MS and fetchData() waits for the rest of
+ * the configured rate. This allows to change the rate without restarting the reader thread. The writer
+ * passes the interval of its publish scheduler which overrides the configured rate while set.
+ *
+ * publish(), setUpdateRateMs(), setAdaptiveIntervalMs() and cancelWait() are thread safe. All other methods
+ * are called in the reader thread.
+ */
+class InProcessHandler :
+  public atools::fs::sc::XpConnectHandler
+{
+public:
+  /* Update rate for the DataReaderThread. Has to be below the smallest rate passed to setUpdateRateMs(). */
+  static const unsigned int READER_TICK_MS = 25;
+
+  InProcessHandler();
+  virtual ~InProcessHandler() override;
+
+  /* Fetch at most once per interval. Takes effect on the next fetch. Thread safe. */
+  void setUpdateRateMs(int value);
+
+  /* Interval of the publish scheduler of the writer or 0 to use the update rate. Thread safe. */
+  void setAdaptiveIntervalMs(int value);
+
+  /* Stop waiting for the next fetch. Call before terminating the reader thread. Thread safe. */
+  void cancelWait();
+
+  /* Pass the latest frame. A null pointer detaches and switches back to the shared memory. Thread safe. */
+  void publish(const lfgc::OutputFramePtr& frame);
+
+  virtual bool connect() override;
+  virtual bool isConnected() const override;
+  virtual bool fetchData(atools::fs::sc::SimConnectData& data, int radiusKm,
+                         atools::fs::sc::Options options) override;
+
+  virtual bool fetchWeatherData(atools::fs::sc::SimConnectData& data) override;
+  virtual void addWeatherRequest(const atools::fs::sc::WeatherRequest& request) override;
+  virtual const atools::fs::sc::WeatherRequest& getWeatherRequest() const override;
+
+  /* Number of frames taken in process and from the shared memory */
+  quint64 getNumInProcessFetches() const
+  {
+    return numInProcessFetches;
+  }
+
+  quint64 getNumSharedMemoryFetches() const
+  {
+    return numSharedMemoryFetches;
+  }
+
+private:
+  lfgc::OutputFramePtr latestFrame() const;
+
+  /* Wait until the fetch interval has passed since the last fetch */
+  void waitForNextFetch();
+
+  int fetchIntervalMs() const
+  {
+    int adaptive = adaptiveIntervalMs.load();
+    return adaptive > 0 ? adaptive : updateRateMs.load();
+  }
+
+  mutable QMutex frameMutex;
+  lfgc::OutputFramePtr frame;
+
+  quint64 numInProcessFetches = 0, numSharedMemoryFetches = 0;
+
+  QAtomicInt updateRateMs = 500, adaptiveIntervalMs = 0;
+  QMutex waitMutex;
+  QWaitCondition waitCondition;
+  bool waitCanceled = false;
+  QElapsedTimer fetchTimer;
+
+  /* Used in reader thread context */
+  lfgc::WeatherCache weatherCache;
+  atools::fs::sc::WeatherRequest weatherRequest;
+  quint64 lastRecordedSequence = 0, numWeatherRequests = 0, numWeatherHits = 0;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_INPROCESSHANDLER_H
@@ -0,0 +1,155 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "inputfilter.h"
+
+#include <QDebug>
+#include <QStringList>
+
+#include <algorithm>
+
+namespace lfgc {
+
+ValueFilter::ValueFilter()
+{
+  std::fill(history, history + MAX_WINDOW, 0.f);
+}
+
+ValueFilter ValueFilter::fromString(const QString& spec)
+{
+  ValueFilter filter;
+  QStringList parts = spec.trimmed().toLower().split(':');
+  const QString& name = parts.constFirst();
+
+  if(name.isEmpty() || name == "none")
+    return filter;
+
+  bool ok = parts.size() == 2;
+  if(ok && name == "ema")
+  {
+    filter.alpha = parts.at(1).toFloat(&ok);
+    ok &= filter.alpha > 0.f && filter.alpha <= 1.f;
+    filter.type = EMA;
+  }
+  else if(ok && name == "median")
+  {
+    filter.window = parts.at(1).toInt(&ok);
+    ok &= filter.window > 0 && filter.window <= MAX_WINDOW;
+    filter.type = MEDIAN;
+  }
+  else
+    ok = false;
+
+  if(!ok)
+  {
+    qWarning() << Q_FUNC_INFO << "Invalid filter" << spec;
+    return ValueFilter();
+  }
+  return filter;
+}
+
+float ValueFilter::filter(float value)
+{
+  switch(type)
+  {
+    case NONE:
+      return value;
+
+    case EMA:
+      last = initialized ? last + alpha * (value - last) : value;
+      initialized = true;
+      return last;
+
+    case MEDIAN:
+      {
+        history[nextHistory] = value;
+        nextHistory = (nextHistory + 1) % window;
+        numHistory = std::min(numHistory + 1, window);
+
+        // Copy to stack and partially sort - window is small
+        float sorted[MAX_WINDOW];
+        std::copy(history, history + numHistory, sorted);
+        std::nth_element(sorted, sorted + numHistory / 2, sorted + numHistory);
+        return sorted[numHistory / 2];
+      }
+  }
+  return value;
+}
+
+void ValueFilter::reset()
+{
+  initialized = false;
+  numHistory = nextHistory = 0;
+}
+
+OnGroundFilter::OnGroundFilter()
+{
+
+}
+
+OnGroundFilter OnGroundFilter::fromString(const QString& spec)
+{
+  OnGroundFilter filter;
+  QStringList parts = spec.trimmed().toLower().split(':');
+  const QString& name = parts.constFirst();
+
+  if(name.isEmpty() || name == "none")
+    return filter;
+
+  bool ok1 = false, ok2 = false;
+  if(parts.size() == 3 && name == "hysteresis")
+  {
+    filter.onThresholdFt = parts.at(1).toFloat(&ok1);
+    filter.offThresholdFt = parts.at(2).toFloat(&ok2);
+  }
+
+  if(!ok1 || !ok2 || filter.offThresholdFt < filter.onThresholdFt)
+  {
+    qWarning() << Q_FUNC_INFO << "Invalid on ground filter" << spec;
+    return OnGroundFilter();
+  }
+
+  filter.enabled = true;
+  return filter;
+}
+
+bool OnGroundFilter::update(float altitudeAboveGroundFt)
+{
+  if(!enabled)
+    return static_cast<int>(altitudeAboveGroundFt) == 0;
+
+  if(!initialized)
+  {
+    // Use the middle of the band for the first sample
+    onGround = altitudeAboveGroundFt < (onThresholdFt + offThresholdFt) / 2.f;
+    initialized = true;
+  }
+  else if(onGround && altitudeAboveGroundFt > offThresholdFt)
+    onGround = false;
+  else if(!onGround && altitudeAboveGroundFt < onThresholdFt)
+    onGround = true;
+
+  return onGround;
+}
+
+void OnGroundFilter::reset()
+{
+  initialized = false;
+}
+
+} // namespace lfgc
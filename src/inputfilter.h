@@ -0,0 +1,118 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_INPUTFILTER_H
+#define LITTLEFGCONNECT_INPUTFILTER_H
+
+#include <QString>
+
+namespace lfgc {
+
+/*
+ * Smoothing filter for a single noisy value like vertical speed.
+ *
+ * Configured by a string:
+ * "none" or empty: value is passed through
+ * "ema:0.2": exponential moving average with the given weight for the newest value (0 < alpha <= 1)
+ * "median:5": median of the last values. Window size is limited to MAX_WINDOW.
+ */
+class ValueFilter
+{
+public:
+  enum Type
+  {
+    NONE,
+    EMA,
+    MEDIAN
+  };
+
+  static const int MAX_WINDOW = 15;
+
+  /* Creates a pass through filter */
+  ValueFilter();
+
+  /* Parse filter description. Returns a pass through filter and prints a warning for invalid strings. */
+  static ValueFilter fromString(const QString& spec);
+
+  /* Add new value and return filtered value */
+  float filter(float value);
+
+  /* Forget history - for example after a jump in position */
+  void reset();
+
+  Type getType() const
+  {
+    return type;
+  }
+
+private:
+  Type type = NONE;
+  float alpha = 1.f;
+  int window = 1;
+
+  /* State */
+  float history[MAX_WINDOW];
+  int numHistory = 0, nextHistory = 0;
+  float last = 0.f;
+  bool initialized = false;
+};
+
+/*
+ * Hysteresis for the on ground flag based on altitude above ground to avoid flickering.
+ *
+ * Configured by a string:
+ * "none" or empty: on ground if altitude above ground truncated to feet is zero
+ * "hysteresis:1:5": on ground if below one foot and airborne again if above five feet
+ */
+class OnGroundFilter
+{
+public:
+  OnGroundFilter();
+
+  static OnGroundFilter fromString(const QString& spec);
+
+  /* Returns true if on ground */
+  bool update(float altitudeAboveGroundFt);
+
+  void reset();
+
+private:
+  bool enabled = false, onGround = false, initialized = false;
+  float onThresholdFt = 1.f, offThresholdFt = 1.f;
+};
+
+/* All filters applied to the user aircraft */
+struct InputFilters
+{
+  ValueFilter verticalSpeed, groundSpeed, indicatedSpeed, trueAirspeed, indicatedAltitude;
+  OnGroundFilter onGround;
+
+  void reset()
+  {
+    verticalSpeed.reset();
+    groundSpeed.reset();
+    indicatedSpeed.reset();
+    trueAirspeed.reset();
+    indicatedAltitude.reset();
+    onGround.reset();
+  }
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_INPUTFILTER_H
@@ -31,7 +31,7 @@
 #include "fs/sc/simconnectreply.h"
 #include "fs/sc/datareaderthread.h"
 #include "constants.h"
-#include "fs/sc/xpconnecthandler.h"
+#include "tracezone.h"
 
 #include <QMessageBox>
 #include <QCloseEvent>
@@ -53,6 +53,33 @@ const QString HELP_BRANCH = "develop/2.5"; // VERSION_NUMBER
 const QString HELP_ONLINE_URL("https://www.littlenavmap.org/manuals/littlefgconnect/" + HELP_BRANCH + "/${LANG}/");
 const QString HELP_OFFLINE_FILE("help/little-fgconnect-user-manual-${LANG}.pdf");
 
+/* Current values of settings keys to detect changes */
+static QVariantList settingsValues(std::initializer_list<QLatin1String> keys)
+{
+  QVariantList values;
+  for(const QLatin1String& key : keys)
+    values.append(Settings::instance().valueVar(key));
+  return values;
+}
+
+/* Settings used by the components which can be restarted separately in a running connection */
+static QVariantList onlineSourceSettings()
+{
+  return settingsValues({lfgc::SETTINGS_OPTIONS_FETCH_AI_AIRCRAFT, lfgc::SETTINGS_OPTIONS_MULTIPLAYER_LISTEN_PORT,
+                         lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_HOST, lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_PORT,
+                         lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_TIMEOUT});
+}
+
+static QVariantList relaySettings()
+{
+  return settingsValues({lfgc::SETTINGS_OPTIONS_RELAY_TARGETS});
+}
+
+static QVariantList propertySubscriberSettings()
+{
+  return settingsValues({lfgc::SETTINGS_OPTIONS_PROPERTY_LISTENER_URL, lfgc::SETTINGS_OPTIONS_RECONNECT_RATE});
+}
+
 MainWindow::MainWindow()
   : ui(new Ui::MainWindow)
 {
@@ -127,14 +154,15 @@ MainWindow::~MainWindow()
 {
   qDebug() << Q_FUNC_INFO;
 
+  connectHandler->cancelWait();
   dataReader->terminateThread();
   qDebug() << Q_FUNC_INFO << "dataReader terminated";
 
   delete dataReader;
   qDebug() << Q_FUNC_INFO << "dataReader deleted";
 
-  delete xpConnectHandler;
-  qDebug() << Q_FUNC_INFO << "xpConnectHandler deleted";
+  delete connectHandler;
+  qDebug() << Q_FUNC_INFO << "connectHandler deleted";
 
   atools::logging::LoggingHandler::setLogFunction(nullptr);
   qDebug() << Q_FUNC_INFO << "logging reset";
@@ -171,12 +199,14 @@ void MainWindow::options()
   bool fetchAiAircraft = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_FETCH_AI_AIRCRAFT, true).toBool();
   QString multiplayerServerHost = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_HOST, "mpserver03.flightgear.org").toString();
   int multiplayerServerPort = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_PORT, 5001).toInt();
+  QStringList relayTargets = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_RELAY_TARGETS, QStringList()).toStringList();
 
   dialog.setUpdateRate(updateRateMs);
   dialog.setPort(port);
   dialog.setFetchAiAircraft(fetchAiAircraft);
   dialog.setMultiplayerServerHost(multiplayerServerHost);
   dialog.setMultiplayerServerPort(multiplayerServerPort);
+  dialog.setRelayTargets(relayTargets);
 
   int result = dialog.exec();
 
@@ -187,6 +217,7 @@ void MainWindow::options()
     settings.setValue(lfgc::SETTINGS_OPTIONS_FETCH_AI_AIRCRAFT, dialog.isFetchAiAircraft());
     settings.setValue(lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_HOST, dialog.getMultiplayerServerHost());
     settings.setValue(lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_PORT, dialog.getMultiplayerServerPort());
+    settings.setValue(lfgc::SETTINGS_OPTIONS_RELAY_TARGETS, dialog.getRelayTargets());
 
     settings.syncSettings();
 
@@ -196,13 +227,12 @@ void MainWindow::options()
     }
     dataReader->setSimconnectOptions(options);
 
-    if(dialog.getUpdateRate() != updateRateMs)
-    {
-      // Update rate changed - restart data readers
-      dataReader->terminateThread();
-      dataReader->setUpdateRate(dialog.getUpdateRate());
-      dataReader->start();
-    }
+    // Picked up by the next fetch of the running reader thread
+    connectHandler->setUpdateRateMs(static_cast<int>(dialog.getUpdateRate()));
+
+    // Apply to the running connection without stopping the writer or detaching the shared memory
+    if(udpSocket != nullptr)
+      reconfigureConnection();
   }
 }
 
@@ -279,6 +309,10 @@ void MainWindow::closeEvent(QCloseEvent *event)
   qDebug() << Q_FUNC_INFO;
 
   writeSettings();
+
+#ifdef LFGC_TRACE
+  writeTrace();
+#endif
 }
 
 void MainWindow::startStopConnection()
@@ -299,47 +333,407 @@ void MainWindow::startStopConnection()
         QObject::connect(udpSocket, SIGNAL(readyRead()), this, SLOT(readPendingDatagrams()));
         qDebug() << Q_FUNC_INFO << "Attached to the UDP port";
 
+        frameAssembler.reset();
+
         thread = new SharedMemoryWriter();
-        thread->start();
+        thread->setPublishIntervalMs(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_PUBLISH_RATE, 0).toInt());
+
+        // Like "adaptive" or "adaptive:<high>:<normal>:<cruise>:<heartbeat>:<hold>" in milliseconds
+        publishSchedulerSpec = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_ADAPTIVE_PUBLISH_RATE, "none").toString();
+        thread->setPublishScheduler(lfgc::PublishScheduler::fromString(publishSchedulerSpec));
+        thread->setInputFilters(inputFiltersFromSettings());
+        thread->setTrafficPredictionLimit(
+            settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_TRAFFIC_PREDICTION_LIMIT, 20.).toFloat());
+        thread->setDecoderThreads(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_DECODER_THREADS, 0).toInt());
+        thread->setSnapshotRegion(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_SNAPSHOT_REGION, true).toBool());
+        thread->setInProcessHandler(connectHandler);
+
+        // Only needed for other processes reading the Little Xpconnect shared memory
+        thread->setSharedMemoryOutput(
+            settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_SHARED_MEMORY_OUTPUT, true).toBool());
+
+        // Output sinks run in their own threads - queues are "latest", "bounded:<size>" or "block:<size>"
+        int trackHistorySize = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_TRACK_HISTORY_SIZE, 20000).toInt();
+        if (trackHistorySize > 0) {
+            QString queue = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_TRACK_HISTORY_QUEUE, "bounded:1024").toString();
+            thread->addOutputSink(new lfgc::TrackHistory(trackHistorySize),
+                                  lfgc::OutputSinkQueue::fromString(queue, lfgc::OutputSinkQueue()));
+        }
 
-        if (fetchAiAircraft) {
+        // Record decoded frames into a new file per connection if a directory is given
+        QString recorderDir = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_RECORDER_DIRECTORY, QString()).toString();
+        if (!recorderDir.isEmpty()) {
+            QString recorderFile = QDir(recorderDir).filePath(
+                QString("littlefgconnect-%1.lfgr").arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss")));
+            QString queue = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_RECORDER_QUEUE, "bounded:4096").toString();
+            thread->addOutputSink(new lfgc::FlightRecorder(recorderFile),
+                                  lfgc::OutputSinkQueue::fromString(queue, lfgc::OutputSinkQueue()));
+            qInfo(atools::fs::ns::gui).noquote().nospace() << tr("Recording to %1.").arg(recorderFile);
+        }
 
-            onlineTcpSocket = new QTcpSocket(this);
-            connect(onlineTcpSocket, SIGNAL(readyRead()),this, SLOT(tcpSocketReadyRead()));
-            connect(onlineTcpSocket, SIGNAL(connected()),this, SLOT(tcpSocketConnected()));
-            connect(onlineTcpSocket, SIGNAL(disconnected()),this, SLOT(tcpSocketDisconnected()));
+        startStatusServer();
 
-            initOnlineTcpConnection();
+        thread->start();
+
+        updateMetadataSocket();
+        startPropertySubscriber();
+        startRelay();
+        if (fetchAiAircraft) {
+            startOnlinePresenceFetcher();
         }
+        appliedOnlineSourceSettings = onlineSourceSettings();
+        appliedRelaySettings = relaySettings();
+        appliedPropertySubscriberSettings = propertySubscriberSettings();
 
         qInfo(atools::fs::ns::gui).noquote().nospace() << "Started FlightGear connection slot. Waiting for FlightGear data.";
       }
     } else {
       if (udpSocket->state() == udpSocket->BoundState) {
 
+        stopPropertySubscriber();
+
         qDebug() << Q_FUNC_INFO << "Closing connection thread";
         thread->terminateThread();
+
+        // Sinks are stopped by the writer
+        for (const lfgc::OutputSinkStatistics& stats : thread->getOutputStatistics()) {
+            qInfo(atools::fs::ns::gui).noquote().nospace()
+                << tr("%1: %2 frames written at %3 per second, %4 dropped, queue %5 filled up to %6 frames.").
+                arg(stats.name).arg(stats.written).arg(stats.getThroughput(), 0, 'f', 1).
+                arg(stats.dropped).arg(stats.queue).arg(stats.maxQueued);
+        }
         delete thread;
         thread = nullptr;
 
+        // Sink is gone with the writer
+        stopStatusServer();
+
+#ifdef LFGC_TRACE
+        writeTrace();
+#endif
+
+        stopRelay();
+
+        const lfgc::FrameAssemblerStatistics& frameStats = frameAssembler.getStatistics();
+        if (frameStats.completed > 0) {
+            qInfo(atools::fs::ns::gui).noquote().nospace()
+                << tr("Framed input: %1 frames, %2 timed out, %3 evicted, %4 stale, %5 duplicate and %6 invalid fragments, "
+                      "%7 sender restarts.").
+                arg(frameStats.completed).arg(frameStats.timedOut).arg(frameStats.evicted).
+                arg(frameStats.stale).arg(frameStats.duplicates).arg(frameStats.invalid).arg(frameStats.restarts);
+        }
+
         qDebug() << Q_FUNC_INFO << "Closing UDP connection";
         udpSocket->close();
         delete udpSocket;
         udpSocket = nullptr;
 
-        if (fetchAiAircraft) {
-            qDebug() << Q_FUNC_INFO << "Closing Online Presence TCP Connection";
-            onlineTcpSocket->abort();
-            onlineTcpSocket->close();
-            delete onlineTcpSocket;
-            onlineTcpSocket = nullptr;
+        if (metadataUdpSocket != nullptr) {
+            metadataUdpSocket->close();
+            delete metadataUdpSocket;
+            metadataUdpSocket = nullptr;
         }
 
+        stopOnlinePresenceFetcher();
+
         qInfo(atools::fs::ns::gui).noquote().nospace() << "Closed FlightGear connection slot.";
       }
     }
 }
 
+void MainWindow::reconfigureConnection()
+{
+    Settings& settings = Settings::instance();
+
+    // Rebind first and keep the old socket if the new port cannot be bound
+    quint16 port = static_cast<quint16>(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_DEFAULT_PORT, 7755).toInt());
+    if (port != udpSocket->localPort()) {
+        QUdpSocket *newSocket = new QUdpSocket(this);
+        if (!newSocket->bind(port)) {
+            qWarning(atools::fs::ns::gui).noquote().nospace()
+                << tr("Cannot open UDP port %1. Still using port %2.").arg(port).arg(udpSocket->localPort());
+            delete newSocket;
+        } else {
+            connect(newSocket, &QUdpSocket::readyRead, this, &MainWindow::readPendingDatagrams);
+
+            // Publish what already arrived on the old port before switching
+            readPendingDatagrams();
+            udpSocket->close();
+            delete udpSocket;
+            udpSocket = newSocket;
+            qInfo(atools::fs::ns::gui).noquote().nospace() << tr("Switched to UDP port %1.").arg(port);
+        }
+    }
+    updateMetadataSocket();
+
+    // Rates and filters are picked up by the running writer
+    thread->setPublishIntervalMs(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_PUBLISH_RATE, 0).toInt());
+
+    // A new scheduler starts over in the default phase - keep the running one if nothing changed
+    QString schedulerSpec = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_ADAPTIVE_PUBLISH_RATE, "none").toString();
+    if (schedulerSpec != publishSchedulerSpec) {
+        publishSchedulerSpec = schedulerSpec;
+        thread->setPublishScheduler(lfgc::PublishScheduler::fromString(publishSchedulerSpec));
+    }
+    thread->setInputFilters(inputFiltersFromSettings());
+    thread->setTrafficPredictionLimit(
+        settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_TRAFFIC_PREDICTION_LIMIT, 20.).toFloat());
+
+    // Restart only components with changed settings to keep connections and collected state
+    this->fetchAi = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_FETCH_AI_AIRCRAFT, true).toBool();
+    if (onlineSourceSettings() != appliedOnlineSourceSettings) {
+        // The writer keeps the last traffic until the new sources deliver
+        stopOnlinePresenceFetcher();
+        if (this->fetchAi) {
+            startOnlinePresenceFetcher();
+        }
+        appliedOnlineSourceSettings = onlineSourceSettings();
+    }
+
+    if (relaySettings() != appliedRelaySettings) {
+        // Nothing is lost here since datagrams are only relayed from this thread
+        stopRelay();
+        startRelay();
+        appliedRelaySettings = relaySettings();
+    }
+
+    if (propertySubscriberSettings() != appliedPropertySubscriberSettings) {
+        stopPropertySubscriber();
+        startPropertySubscriber();
+        appliedPropertySubscriberSettings = propertySubscriberSettings();
+    }
+
+    qInfo(atools::fs::ns::gui).noquote().nospace() << tr("Applied changed options to the running connection.");
+}
+
+void MainWindow::updateMetadataSocket()
+{
+    // Optional second channel for low rate metadata - primary port gets the compact high rate layout then
+    int metadataPort = Settings::instance().getAndStoreValue(lfgc::SETTINGS_OPTIONS_METADATA_PORT, 0).toInt();
+    if (metadataUdpSocket != nullptr && metadataUdpSocket->localPort() == metadataPort) {
+        return;
+    }
+
+    QUdpSocket *newSocket = nullptr;
+    if (metadataPort > 0) {
+        newSocket = new QUdpSocket(this);
+        if (!newSocket->bind(static_cast<quint16>(metadataPort))) {
+            qWarning() << Q_FUNC_INFO << "Cannot open metadata UDP port" << metadataPort;
+            delete newSocket;
+            return;
+        }
+        connect(newSocket, &QUdpSocket::readyRead, this, &MainWindow::readPendingMetadataDatagrams);
+    }
+
+    if (metadataUdpSocket != nullptr) {
+        // Keep the metadata already received
+        readPendingMetadataDatagrams();
+        metadataUdpSocket->close();
+        delete metadataUdpSocket;
+    }
+    metadataUdpSocket = newSocket;
+
+    thread->setDualRateInput(metadataUdpSocket != nullptr);
+    if (metadataUdpSocket != nullptr) {
+        qInfo(atools::fs::ns::gui).noquote().nospace()
+            << tr("Using dual rate input. Metadata on port %1.").arg(metadataPort);
+    }
+}
+
+void MainWindow::startPropertySubscriber()
+{
+    // Websocket property listener like "ws://localhost:8080/PropertyListener" - FlightGear has to be
+    // started with "--httpd=8080" and must not send generic protocol datagrams at the same time
+    Settings& settings = Settings::instance();
+    QString listenerUrl = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_PROPERTY_LISTENER_URL, QString()).toString();
+    if (!listenerUrl.isEmpty()) {
+        int reconnectMs = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_RECONNECT_RATE, 10).toInt() * 1000;
+        propertySubscriber = new lfgc::PropertySubscriber(QUrl(listenerUrl), reconnectMs, this);
+        connect(propertySubscriber, &lfgc::PropertySubscriber::propertiesChanged,
+                this, [this](const QVector<lfgc::PropertyChange>& changes) {
+            if (thread != nullptr) {
+                thread->writeProperties(changes, this->fetchAi, lfgc::monotonicNowNs());
+            }
+        });
+        propertySubscriber->start();
+        qInfo(atools::fs::ns::gui).noquote().nospace() << tr("Subscribing to properties at %1.").arg(listenerUrl);
+    }
+}
+
+void MainWindow::stopPropertySubscriber()
+{
+    if (propertySubscriber != nullptr) {
+        qDebug() << Q_FUNC_INFO << "Closing property listener connection";
+        propertySubscriber->stop();
+        qInfo(atools::fs::ns::gui).noquote().nospace()
+            << tr("Property listener: %1 messages, %2 ignored.").
+            arg(propertySubscriber->getNumMessages()).arg(propertySubscriber->getNumIgnored());
+        delete propertySubscriber;
+        propertySubscriber = nullptr;
+    }
+}
+
+void MainWindow::startRelay()
+{
+    QStringList relayTargets = Settings::instance().getAndStoreValue(lfgc::SETTINGS_OPTIONS_RELAY_TARGETS,
+                                                                     QStringList()).toStringList();
+    if (!relayTargets.isEmpty()) {
+        relay = new lfgc::DatagramRelay(relayTargets);
+        if (relay->hasTargets()) {
+            relay->start();
+            qInfo(atools::fs::ns::gui).noquote().nospace() << tr("Relaying datagrams to %1.").arg(relayTargets.join(", "));
+        } else {
+            delete relay;
+            relay = nullptr;
+        }
+    }
+}
+
+void MainWindow::stopRelay()
+{
+    if (relay != nullptr) {
+        qDebug() << Q_FUNC_INFO << "Closing relay thread";
+        relay->terminateThread();
+        for (const lfgc::RelayTargetStatistics& stats : relay->getStatistics()) {
+            qInfo(atools::fs::ns::gui).noquote().nospace()
+                << tr("Relay to %1: %2 datagrams sent, %3 dropped.").arg(stats.target).arg(stats.sent).arg(stats.dropped);
+        }
+        delete relay;
+        relay = nullptr;
+    }
+}
+
+void MainWindow::startStatusServer()
+{
+    Settings& settings = Settings::instance();
+    int port = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_STATUS_SERVER_PORT, 0).toInt();
+    if (port > 0) {
+        // Only local clients by default - use "0.0.0.0" or "::" to allow remote dashboards
+        QHostAddress address(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_STATUS_SERVER_ADDRESS, "127.0.0.1").toString());
+        statusServer = new lfgc::StatusServer(address, static_cast<quint16>(port));
+        if (statusServer->start()) {
+            // Only the newest frame is served
+            thread->addOutputSink(new lfgc::StatusSink(statusServer),
+                                  lfgc::OutputSinkQueue::fromString("latest", lfgc::OutputSinkQueue()));
+            qInfo(atools::fs::ns::gui).noquote().nospace()
+                << tr("Status server listening on http://%1:%2/.").arg(address.toString()).arg(port);
+        } else {
+            qWarning(atools::fs::ns::gui).noquote().nospace() << tr("Cannot start status server on port %1.").arg(port);
+            delete statusServer;
+            statusServer = nullptr;
+        }
+    }
+}
+
+void MainWindow::stopStatusServer()
+{
+    if (statusServer != nullptr) {
+        statusServer->stop();
+        qInfo(atools::fs::ns::gui).noquote().nospace()
+            << tr("Status server: %1 requests answered.").arg(statusServer->getNumRequests());
+        delete statusServer;
+        statusServer = nullptr;
+    }
+}
+
+void MainWindow::startOnlinePresenceFetcher()
+{
+    Settings& settings = Settings::instance();
+
+    // Multiplayer packets forwarded by a relay or the simulator update at the multiplayer rate
+    int listenPort = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_MULTIPLAYER_LISTEN_PORT, 0).toInt();
+    if (listenPort > 0) {
+        multiplayerListener = new lfgc::MultiplayerListener(static_cast<quint16>(listenPort), 10000, 100, this);
+        connect(multiplayerListener, &lfgc::MultiplayerListener::onlineTrafficUpdated,
+                this, [this](const lfgc::TrafficStore& traffic) {
+            if (thread != nullptr) {
+                thread->writeOnlinePresenceData(traffic);
+            }
+        });
+        if (multiplayerListener->start()) {
+            qInfo(atools::fs::ns::gui).noquote().nospace()
+                << tr("Receiving multiplayer packets on port %1.").arg(listenPort);
+            return;
+        }
+
+        qWarning(atools::fs::ns::gui).noquote().nospace()
+            << tr("Cannot open multiplayer port %1. Fetching pilot lists from the servers.").arg(listenPort);
+        delete multiplayerListener;
+        multiplayerListener = nullptr;
+    }
+
+    // Comma separated list of "host" or "host:port" - all are fetched concurrently
+    QStringList servers = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_HOST,
+                                                    "mpserver03.flightgear.org").toString().
+                          split(',', Qt::SkipEmptyParts);
+    int serverPort = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_PORT, 5001).toInt();
+    int serverTimeout = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_TIMEOUT, 5000).toInt();
+
+    onlinePresenceFetcher = new lfgc::OnlinePresenceFetcher(servers, serverPort, serverTimeout, 5000, this);
+    connect(onlinePresenceFetcher, &lfgc::OnlinePresenceFetcher::onlineTrafficUpdated,
+            this, [this](const lfgc::TrafficStore& traffic) {
+        if (thread != nullptr) {
+            thread->writeOnlinePresenceData(traffic);
+        }
+    });
+    onlinePresenceFetcher->start();
+}
+
+void MainWindow::stopOnlinePresenceFetcher()
+{
+    if (multiplayerListener != nullptr) {
+        qDebug() << Q_FUNC_INFO << "Closing multiplayer listener";
+        multiplayerListener->stop();
+        qInfo(atools::fs::ns::gui).noquote().nospace()
+            << tr("Multiplayer listener: %1 packets, %2 ignored.").
+            arg(multiplayerListener->getNumPackets()).arg(multiplayerListener->getNumIgnored());
+        delete multiplayerListener;
+        multiplayerListener = nullptr;
+    }
+
+    if (onlinePresenceFetcher != nullptr) {
+        qDebug() << Q_FUNC_INFO << "Closing Online Presence TCP Connections";
+        onlinePresenceFetcher->stop();
+        delete onlinePresenceFetcher;
+        onlinePresenceFetcher = nullptr;
+    }
+}
+
+#ifdef LFGC_TRACE
+void MainWindow::writeTrace()
+{
+    QString traceFile = Settings::instance().getAndStoreValue(
+        lfgc::SETTINGS_OPTIONS_TRACE_FILE, QDir::temp().filePath("littlefgconnect-trace.json")).toString();
+    if (lfgc::Trace::writeChromeTrace(traceFile)) {
+        qInfo(atools::fs::ns::gui).noquote().nospace() << tr("Trace written to %1.").arg(traceFile);
+    }
+}
+#endif
+
+lfgc::InputFilters MainWindow::inputFiltersFromSettings() const
+{
+  using lfgc::ValueFilter;
+  Settings& settings = Settings::instance();
+
+  // Strings like "none", "ema:0.3" or "median:5" - see ValueFilter
+  lfgc::InputFilters filters;
+  filters.verticalSpeed =
+    ValueFilter::fromString(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_FILTER_VERTICAL_SPEED, "none").toString());
+  filters.groundSpeed =
+    ValueFilter::fromString(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_FILTER_GROUND_SPEED, "none").toString());
+  filters.indicatedSpeed =
+    ValueFilter::fromString(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_FILTER_INDICATED_SPEED, "none").toString());
+  filters.trueAirspeed =
+    ValueFilter::fromString(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_FILTER_TRUE_AIRSPEED, "none").toString());
+  filters.indicatedAltitude =
+    ValueFilter::fromString(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_FILTER_INDICATED_ALTITUDE, "none").toString());
+
+  // "none" or "hysteresis:1:5" - see OnGroundFilter
+  filters.onGround =
+    lfgc::OnGroundFilter::fromString(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_FILTER_ON_GROUND, "none").toString());
+  return filters;
+}
+
 void MainWindow::readPendingDatagrams()
 {
     QByteArray rxData;
@@ -348,6 +742,7 @@ void MainWindow::readPendingDatagrams()
 
     while (udpSocket->hasPendingDatagrams())
     {
+        LFGC_TRACE_ZONE("read datagram");
         qDebug() << Q_FUNC_INFO << "Read pending datagrams";
 
         // Resize and zero byte buffer so we can make way for the new data.
@@ -355,55 +750,41 @@ void MainWindow::readPendingDatagrams()
 
         // Read data from the UDP buffer.
         udpSocket->readDatagram(rxData.data(), rxData.size(), &sender, &senderPort);
+        qint64 receiveTimeNs = lfgc::monotonicNowNs();
 
         qDebug() << Q_FUNC_INFO << "Received: " << rxData.size();
 
-        // convert to ascii
-        QString dataAsString = QString(rxData);
+        // Forward unchanged to other consumers before parsing - only queues the datagram
+        if (relay != nullptr) {
+            relay->relayDatagram(rxData);
+        }
 
-        // Copy data from datarefs and pass it over to the thread for writing into the shared memory
-        thread->fetchAndWriteData(dataAsString, this->fetchAi);
+        if (lfgc::FrameAssembler::isFramed(rxData)) {
+            // Pass only complete frames to the thread
+            QByteArray frame;
+            if (frameAssembler.addDatagram(rxData, receiveTimeNs / 1000000, frame)) {
+                thread->fetchAndWriteData(frame, this->fetchAi, receiveTimeNs);
+            }
+        } else {
+            // Pass the raw bytes over to the thread for parsing and writing into the shared memory
+            thread->fetchAndWriteData(rxData, this->fetchAi, receiveTimeNs);
+        }
     }
 }
 
-void MainWindow::tcpSocketReadyRead()
-{
-    qDebug() << "reading...";
-    onlineStatus += onlineTcpSocket->readAll();
-}
-
-void MainWindow::tcpSocketConnected()
+void MainWindow::readPendingMetadataDatagrams()
 {
-    qDebug() << "connected...";
-    onlineStatus = QString("");
-}
-
-void MainWindow::initOnlineTcpConnection()
-{
-    Settings& settings = Settings::instance();
-    QString multiplayerServerHost = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_HOST, "").toString();
-    int multiplayerServerPort = settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_MULTIPLAYER_SERVER_PORT, 5001).toInt();
+    QByteArray rxData;
 
-    onlineTcpSocket->connectToHost(multiplayerServerHost, multiplayerServerPort);
-    // we need to wait...
-    if(!onlineTcpSocket->waitForConnected(5000))
+    while (metadataUdpSocket->hasPendingDatagrams())
     {
-        qDebug() << "Error: " << onlineTcpSocket->errorString();
-    }
-}
-
-void MainWindow::tcpSocketDisconnected()
-{
-    qDebug() << "Disconnected...";
-    qDebug() << "Online status: " << onlineStatus;
+        rxData.resize(static_cast<int>(metadataUdpSocket->pendingDatagramSize()));
+        metadataUdpSocket->readDatagram(rxData.data(), rxData.size());
 
-    thread->writeOnlinePresenceData(onlineStatus);
+        qDebug() << Q_FUNC_INFO << "Received: " << rxData.size();
 
-    // re-run connection after 5 seconds
-    QTimer* timer = new QTimer(this);
-    timer->setSingleShot(true);
-    connect(timer, &QTimer::timeout, this, &MainWindow::initOnlineTcpConnection);
-    timer->start(5000);
+        thread->writeMetadata(rxData, this->fetchAi);
+    }
 }
 
 void MainWindow::mainWindowShown()
@@ -421,15 +802,19 @@ void MainWindow::mainWindowShown()
     SimConnectReply::getReplyVersion());
 
   // Build the handler classes which are an abstraction to SimConnect and the Little Xpconnect shared memory
-  xpConnectHandler = new atools::fs::sc::XpConnectHandler();
+  // Takes the frames of the writer in this process directly and uses the shared memory otherwise
+  connectHandler = new lfgc::InProcessHandler();
 
   ui->menuTools->insertAction(ui->actionOptions, ui->toolBar->toggleViewAction());
 
   // Build the thread which will read the data from the interfaces
   dataReader = new atools::fs::sc::DataReaderThread(this, verbose);
-  dataReader->setHandler(xpConnectHandler);
+  dataReader->setHandler(connectHandler);
   dataReader->setReconnectRateSec(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_RECONNECT_RATE, 10).toInt());
-  dataReader->setUpdateRate(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_UPDATE_RATE, 500).toUInt());
+
+  // The handler waits for the configured rate which can then be changed while the thread runs
+  dataReader->setUpdateRate(lfgc::InProcessHandler::READER_TICK_MS);
+  connectHandler->setUpdateRateMs(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_UPDATE_RATE, 500).toInt());
 
   atools::fs::sc::Options options = atools::fs::sc::NO_OPTION;
   if(settings.getAndStoreValue(lfgc::SETTINGS_OPTIONS_FETCH_AI_AIRCRAFT, true).toBool())
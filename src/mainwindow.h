@@ -20,10 +20,18 @@
 #define LITTLEFGCONNECT_MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QTcpSocket>
 #include <QUdpSocket>
 
+#include "datagramrelay.h"
+#include "flightrecorder.h"
+#include "trackhistory.h"
+#include "frameassembler.h"
+#include "inprocesshandler.h"
+#include "multiplayerlistener.h"
+#include "onlinepresencefetcher.h"
+#include "propertysubscriber.h"
 #include "sharedmemorywriter.h"
+#include "statusserver.h"
 
 namespace Ui {
 class MainWindow;
@@ -37,7 +45,6 @@ namespace fs {
 namespace sc {
 class DataReaderThread;
 class SimConnectHandler;
-class XpConnectHandler;
 class ConnectHandler;
 }
 namespace ns {
@@ -69,9 +76,7 @@ signals:
 
 private slots:
   void readPendingDatagrams();
-  void tcpSocketConnected();
-  void tcpSocketDisconnected();
-  void tcpSocketReadyRead();
+  void readPendingMetadataDatagrams();
 
 private:
   /* Loggin handler will send log messages of category gui to this method which will emit
@@ -96,22 +101,70 @@ private:
   void showOfflineHelp();
 
   void startStopConnection();
-  void initOnlineTcpConnection();
+
+  /* Apply changed options to a running connection. Sockets are rebound only if the new port can be bound,
+   * traffic sources and relay are switched and rates are changed without stopping the writer thread. */
+  void reconfigureConnection();
+
+  /* Bind, rebind or close the metadata socket according to the settings */
+  void updateMetadataSocket();
+
+#ifdef LFGC_TRACE
+  /* Write the events of all trace zones to the configured Chrome trace file */
+  void writeTrace();
+#endif
+
+  void startPropertySubscriber();
+  void stopPropertySubscriber();
+  void startRelay();
+  void stopRelay();
+
+  /* Start the server and add its sink to the writer before the writer thread is started */
+  void startStatusServer();
+  void stopStatusServer();
+  void startOnlinePresenceFetcher();
+  void stopOnlinePresenceFetcher();
+
+  /* Settings the optional components of the running connection were started with */
+  QVariantList appliedOnlineSourceSettings, appliedRelaySettings, appliedPropertySubscriberSettings;
+
+  /* Read smoothing filter configuration */
+  lfgc::InputFilters inputFiltersFromSettings() const;
+
+  /* Adaptive publish rate setting the running writer was configured with */
+  QString publishSchedulerSpec;
 
   Ui::MainWindow *ui = nullptr;
 
   // Runs in background and fetches data from simulator - signals are sent to NavServerWorker threads
   atools::fs::sc::DataReaderThread *dataReader = nullptr;
-  atools::fs::sc::XpConnectHandler *xpConnectHandler = nullptr;
+  lfgc::InProcessHandler *connectHandler = nullptr;
 
   // FlightGear communication
   QUdpSocket* udpSocket = nullptr;
+
+  // Reassembles datagrams of the framed protocol variant
+  lfgc::FrameAssembler frameAssembler;
+
+  // Optional change driven input using the FlightGear property listener instead of the generic protocol
+  lfgc::PropertySubscriber *propertySubscriber = nullptr;
+
+  // Optional low rate channel for dual rate input
+  QUdpSocket* metadataUdpSocket = nullptr;
   SharedMemoryWriter *thread = nullptr;
 
+  // Forwards datagrams to other local consumers
+  lfgc::DatagramRelay *relay = nullptr;
+
+  // Local HTTP endpoint for monitoring - fed by an output sink of the writer
+  lfgc::StatusServer *statusServer = nullptr;
+
   // FlightGear online server communication
   bool onlineFetchEnabled = false;
-  QString onlineStatus = QString();
-  QTcpSocket* onlineTcpSocket = nullptr;
+  lfgc::OnlinePresenceFetcher *onlinePresenceFetcher = nullptr;
+
+  // Receives multiplayer protocol packets instead of fetching the server dumps if a port is set
+  lfgc::MultiplayerListener *multiplayerListener = nullptr;
 
   atools::gui::HelpHandler *helpHandler = nullptr;
   bool firstStart = true; // Used to emit the first windowShown signal
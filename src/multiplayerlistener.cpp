@@ -0,0 +1,161 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "multiplayerlistener.h"
+
+#include "multiplayerprotocol.h"
+#include "tracezone.h"
+
+#include <QDebug>
+#include <QUdpSocket>
+
+#include <algorithm>
+#include <cstring>
+
+namespace lfgc {
+
+MultiplayerListener::MultiplayerListener(quint16 portParam, int timeoutMsParam, int publishIntervalMsParam,
+                                         QObject *parent)
+  : QObject(parent), port(portParam), timeoutMs(timeoutMsParam)
+{
+  publishTimer.setInterval(publishIntervalMsParam);
+  connect(&publishTimer, &QTimer::timeout, this, &MultiplayerListener::publish);
+}
+
+MultiplayerListener::~MultiplayerListener()
+{
+  stop();
+}
+
+bool MultiplayerListener::start()
+{
+  stop();
+
+  socket = new QUdpSocket(this);
+  if(!socket->bind(port))
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot open multiplayer UDP port" << port << socket->errorString();
+    delete socket;
+    socket = nullptr;
+    return false;
+  }
+
+  connect(socket, &QUdpSocket::readyRead, this, &MultiplayerListener::readPendingDatagrams);
+  clock.start();
+  publishTimer.start();
+  return true;
+}
+
+void MultiplayerListener::stop()
+{
+  publishTimer.stop();
+  if(socket != nullptr)
+  {
+    socket->close();
+    delete socket;
+    socket = nullptr;
+  }
+
+  traffic.clear();
+  rowByCallsign.clear();
+  lastSeenMs.clear();
+  changed = false;
+}
+
+void MultiplayerListener::readPendingDatagrams()
+{
+  LFGC_TRACE_ZONE("parse multiplayer");
+  qint64 nowMs = clock.elapsed();
+  MultiplayerPosition position;
+
+  while(socket->hasPendingDatagrams())
+  {
+    // Keeps the capacity of the buffer
+    datagram.resize(static_cast<int>(std::max(socket->pendingDatagramSize(), qint64(0))));
+    socket->readDatagram(datagram.data(), datagram.size());
+    numPackets++;
+
+    if(!decodeMultiplayerPosition(datagram, position))
+    {
+      numIgnored++;
+      continue;
+    }
+
+    const QString& callsign = stringPool.intern(position.callsign);
+    int row = rowByCallsign.value(callsign, -1);
+    if(row == -1)
+    {
+      row = traffic.append();
+      rowByCallsign.insert(callsign, row);
+      lastSeenMs.resize(traffic.size());
+      traffic.setCallsign(row, callsign);
+      traffic.setFromIdent(row, QString());
+      traffic.setToIdent(row, QString());
+    }
+
+    // File name without path and extension like the server dump
+    const char *modelBegin = position.model.constData(), *modelEnd = modelBegin + position.model.size();
+    const char *slash = modelEnd;
+    while(slash > modelBegin && slash[-1] != '/')
+      slash--;
+    if(modelEnd - slash > 4 && std::memcmp(modelEnd - 4, ".xml", 4) == 0)
+      modelEnd -= 4;
+    traffic.setModel(row, stringPool.intern(slash, static_cast<int>(modelEnd - slash)));
+
+    traffic.setPosition(row, static_cast<float>(position.lonX), static_cast<float>(position.latY),
+                        static_cast<float>(position.altitudeFt));
+    traffic.setHeadingTrueDeg(row, position.headingTrueDeg);
+    traffic.setGroundSpeedKts(row, position.groundSpeedKts);
+    traffic.setVerticalSpeedFeetPerMin(row, position.verticalSpeedFeetPerMin);
+    lastSeenMs[row] = nowMs;
+    changed = true;
+  }
+}
+
+void MultiplayerListener::publish()
+{
+  // Remove pilots which left or stopped sending
+  qint64 oldestMs = clock.elapsed() - timeoutMs;
+  for(int row = traffic.size() - 1; row >= 0; row--)
+  {
+    if(lastSeenMs.at(row) < oldestMs)
+    {
+      rowByCallsign.remove(traffic.getCallsign(row));
+
+      // Last row is moved into the free place
+      int last = traffic.size() - 1;
+      traffic.removeFast(row);
+      if(row != last)
+      {
+        lastSeenMs[row] = lastSeenMs.at(last);
+        rowByCallsign.insert(traffic.getCallsign(row), row);
+      }
+      lastSeenMs.resize(traffic.size());
+      changed = true;
+    }
+  }
+
+  if(changed)
+  {
+    changed = false;
+    emit onlineTrafficUpdated(traffic);
+  }
+}
+
+} // namespace lfgc
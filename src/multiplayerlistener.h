@@ -0,0 +1,98 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLEFGCONNECT_MULTIPLAYERLISTENER_H
+#define LITTLEFGCONNECT_MULTIPLAYERLISTENER_H
+
+#include "stringpool.h"
+#include "trafficstore.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+
+class QUdpSocket;
+
+namespace lfgc {
+
+/*
+ * Receives FlightGear multiplayer protocol UDP packets and keeps the latest position of each callsign.
+ *
+ * Packets can be forwarded by a multiplayer relay or by a local FlightGear with "--multiplay=out,...".
+ * Only position messages are decoded. See multiplayerprotocol.h.
+ * Pilots without a packet for the timeout are removed.
+ *
+ * The traffic is emitted at most once per publish interval and only if changed.
+ * Lives in the main thread context.
+ */
+class MultiplayerListener :
+  public QObject
+{
+  Q_OBJECT
+
+public:
+  MultiplayerListener(quint16 portParam, int timeoutMsParam, int publishIntervalMsParam, QObject *parent = nullptr);
+  virtual ~MultiplayerListener() override;
+
+  /* Bind the port. Returns false if the port cannot be bound. */
+  bool start();
+  void stop();
+
+  quint64 getNumPackets() const
+  {
+    return numPackets;
+  }
+
+  quint64 getNumIgnored() const
+  {
+    return numIgnored;
+  }
+
+signals:
+  /* All pilots heard within the timeout */
+  void onlineTrafficUpdated(const lfgc::TrafficStore& traffic);
+
+private:
+  void readPendingDatagrams();
+  void publish();
+
+  quint16 port;
+  int timeoutMs;
+  QUdpSocket *socket = nullptr;
+  QTimer publishTimer;
+
+  /* Reused receive buffer */
+  QByteArray datagram;
+
+  TrafficStore traffic;
+  StringPool stringPool;
+  QHash<QString, int> rowByCallsign;
+
+  /* Time of the last packet for each row of traffic in milliseconds since start */
+  QVector<qint64> lastSeenMs;
+  QElapsedTimer clock;
+
+  bool changed = false;
+  quint64 numPackets = 0, numIgnored = 0;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_MULTIPLAYERLISTENER_H
@@ -0,0 +1,324 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "multiplayerprotocol.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace lfgc {
+
+/* Message header - all values are XDR encoded, that is big endian with 4 byte alignment */
+static const quint32 MP_MAGIC = 0x46474653; // "FGFS"
+static const quint32 MP_PROTOCOL_VERSION = 0x00010001;
+static const quint32 MP_POSITION_MESSAGE_ID = 7;
+static const int MP_HEADER_SIZE = 32;
+static const int MP_CALLSIGN_OFFSET = 24, MP_CALLSIGN_SIZE = 8;
+
+/* Position message after the header */
+static const int MP_MODEL_OFFSET = MP_HEADER_SIZE, MP_MODEL_SIZE = 96;
+static const int MP_TIME_OFFSET = MP_MODEL_OFFSET + MP_MODEL_SIZE;
+static const int MP_POSITION_OFFSET = MP_TIME_OFFSET + 16; // after time and lag
+static const int MP_ORIENTATION_OFFSET = MP_POSITION_OFFSET + 24;
+static const int MP_LINEAR_VELOCITY_OFFSET = MP_ORIENTATION_OFFSET + 12;
+
+/* Header, position message and padding */
+static const int MP_POSITION_MESSAGE_SIZE = MP_HEADER_SIZE + 200;
+
+static const double PI = 3.14159265358979323846;
+static const double DEG_TO_RAD = PI / 180., RAD_TO_DEG = 180. / PI;
+static const double METER_TO_FEET = 3.28083989501, MPS_TO_KTS = 1.94384449244;
+
+/* WGS84 ellipsoid */
+static const double WGS84_A = 6378137.;
+static const double WGS84_F = 1. / 298.257223563;
+static const double WGS84_E2 = WGS84_F * (2. - WGS84_F);
+
+// XDR encoding ======================================================
+static quint32 readUInt(const char *data)
+{
+  return qFromBigEndian<quint32>(data);
+}
+
+static float readFloat(const char *data)
+{
+  quint32 bits = readUInt(data);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static double readDouble(const char *data)
+{
+  quint64 bits = qFromBigEndian<quint64>(data);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static void writeUInt(char *data, quint32 value)
+{
+  qToBigEndian(value, data);
+}
+
+static void writeFloat(char *data, float value)
+{
+  quint32 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  writeUInt(data, bits);
+}
+
+static void writeDouble(char *data, double value)
+{
+  quint64 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  qToBigEndian(bits, data);
+}
+
+// Orientation ======================================================
+/* Same conventions as SGQuat in SimGear which is used by the sender */
+struct Quat
+{
+  double w, x, y, z;
+};
+
+static Quat multiply(const Quat& a, const Quat& b)
+{
+  return {a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+          a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+          a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+          a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w};
+}
+
+static Quat conjugate(const Quat& q)
+{
+  return {q.w, -q.x, -q.y, -q.z};
+}
+
+/* Rotation from earth centered to the horizontal local frame at the position */
+static Quat fromLonLat(double lonRad, double latRad)
+{
+  double zd2 = 0.5 * lonRad, yd2 = -0.25 * PI - 0.5 * latRad;
+  double sz = std::sin(zd2), sy = std::sin(yd2), cz = std::cos(zd2), cy = std::cos(yd2);
+  return {cz * cy, -sz * sy, cz * sy, sz * cy};
+}
+
+static Quat fromAngleAxis(double x, double y, double z)
+{
+  double angle = std::sqrt(x * x + y * y + z * z);
+  if(angle < 1.e-12)
+    return {1., 0., 0., 0.};
+
+  double s = std::sin(0.5 * angle) / angle;
+  return {std::cos(0.5 * angle), x * s, y * s, z * s};
+}
+
+static void toAngleAxis(Quat q, double& x, double& y, double& z)
+{
+  if(q.w < 0.)
+    q = {-q.w, -q.x, -q.y, -q.z};
+
+  double s = std::sqrt(std::max(1. - q.w * q.w, 0.));
+  if(s < 1.e-12)
+  {
+    x = y = z = 0.;
+    return;
+  }
+
+  double angle = 2. * std::acos(std::min(q.w, 1.));
+  x = q.x / s * angle;
+  y = q.y / s * angle;
+  z = q.z / s * angle;
+}
+
+static Quat fromEuler(double headingRad, double pitchRad, double rollRad)
+{
+  double sz = std::sin(0.5 * headingRad), cz = std::cos(0.5 * headingRad);
+  double sy = std::sin(0.5 * pitchRad), cy = std::cos(0.5 * pitchRad);
+  double sx = std::sin(0.5 * rollRad), cx = std::cos(0.5 * rollRad);
+  return {cz * cy * cx + sz * sy * sx,
+          cz * cy * sx - sz * sy * cx,
+          cz * sy * cx + sz * cy * sx,
+          sz * cy * cx - cz * sy * sx};
+}
+
+static void toEuler(const Quat& q, double& headingRad, double& pitchRad, double& rollRad)
+{
+  double ww = q.w * q.w, xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+
+  rollRad = std::atan2(2. * (q.y * q.z + q.w * q.x), ww - xx - yy + zz);
+
+  double sinPitch = 2. * (q.x * q.z - q.w * q.y);
+  pitchRad = sinPitch <= -1. ? 0.5 * PI : (sinPitch >= 1. ? -0.5 * PI : -std::asin(sinPitch));
+
+  headingRad = std::atan2(2. * (q.x * q.y + q.w * q.z), ww + xx - yy - zz);
+  if(headingRad < 0.)
+    headingRad += 2. * PI;
+}
+
+/* Rotate body frame vector into north, east, down or back if transposed */
+static void rotateBody(double headingRad, double pitchRad, double rollRad, const double in[3], double out[3],
+                       bool transposed)
+{
+  double sh = std::sin(headingRad), ch = std::cos(headingRad);
+  double sp = std::sin(pitchRad), cp = std::cos(pitchRad);
+  double sr = std::sin(rollRad), cr = std::cos(rollRad);
+  double m[3][3] = {
+    {cp * ch, sr * sp * ch - cr * sh, cr * sp * ch + sr * sh},
+    {cp * sh, sr * sp * sh + cr * ch, cr * sp * sh - sr * ch},
+    {-sp, sr * cp, cr * cp}
+  };
+
+  for(int i = 0; i < 3; i++)
+  {
+    out[i] = 0.;
+    for(int j = 0; j < 3; j++)
+      out[i] += (transposed ? m[j][i] : m[i][j]) * in[j];
+  }
+}
+
+// Geodesy ======================================================
+static void geodeticToCartesian(double lonRad, double latRad, double altMeter, double cart[3])
+{
+  double sinLat = std::sin(latRad);
+  double n = WGS84_A / std::sqrt(1. - WGS84_E2 * sinLat * sinLat);
+  cart[0] = (n + altMeter) * std::cos(latRad) * std::cos(lonRad);
+  cart[1] = (n + altMeter) * std::cos(latRad) * std::sin(lonRad);
+  cart[2] = (n * (1. - WGS84_E2) + altMeter) * sinLat;
+}
+
+static void cartesianToGeodetic(const double cart[3], double& lonRad, double& latRad, double& altMeter)
+{
+  double p = std::hypot(cart[0], cart[1]);
+  lonRad = std::atan2(cart[1], cart[0]);
+  latRad = std::atan2(cart[2], p * (1. - WGS84_E2));
+  altMeter = 0.;
+
+  // Converges to below a millimeter in a few iterations
+  for(int i = 0; i < 5; i++)
+  {
+    double sinLat = std::sin(latRad);
+    double n = WGS84_A / std::sqrt(1. - WGS84_E2 * sinLat * sinLat);
+    altMeter = std::abs(std::cos(latRad)) > 1.e-6 ? p / std::cos(latRad) - n : std::abs(cart[2]) - n * (1. - WGS84_E2);
+    latRad = std::atan2(cart[2], p * (1. - WGS84_E2 * n / (n + altMeter)));
+  }
+}
+
+// ======================================================
+bool decodeMultiplayerPosition(const QByteArray& datagram, MultiplayerPosition& position)
+{
+  const char *data = datagram.constData();
+  if(datagram.size() < MP_POSITION_MESSAGE_SIZE || readUInt(data) != MP_MAGIC ||
+     readUInt(data + 4) != MP_PROTOCOL_VERSION || readUInt(data + 8) != MP_POSITION_MESSAGE_ID ||
+     readUInt(data + 12) > static_cast<quint32>(datagram.size()))
+    return false;
+
+  const char *callsign = data + MP_CALLSIGN_OFFSET;
+  position.callsign = QByteArray::fromRawData(callsign, static_cast<int>(
+                                                std::find(callsign, callsign + MP_CALLSIGN_SIZE, '\0') - callsign));
+  const char *model = data + MP_MODEL_OFFSET;
+  position.model = QByteArray::fromRawData(model, static_cast<int>(
+                                             std::find(model, model + MP_MODEL_SIZE, '\0') - model));
+  if(position.callsign.isEmpty())
+    return false;
+
+  position.time = readDouble(data + MP_TIME_OFFSET);
+
+  double cart[3];
+  for(int i = 0; i < 3; i++)
+    cart[i] = readDouble(data + MP_POSITION_OFFSET + i * 8);
+  if(!std::isfinite(cart[0]) || !std::isfinite(cart[1]) || !std::isfinite(cart[2]) ||
+     std::sqrt(cart[0] * cart[0] + cart[1] * cart[1] + cart[2] * cart[2]) < WGS84_A / 2.)
+    return false;
+
+  double lonRad, latRad, altMeter;
+  cartesianToGeodetic(cart, lonRad, latRad, altMeter);
+  position.lonX = lonRad * RAD_TO_DEG;
+  position.latY = latRad * RAD_TO_DEG;
+  position.altitudeFt = altMeter * METER_TO_FEET;
+
+  // Orientation is an angle axis rotation in the earth centered frame
+  Quat earthOrientation = fromAngleAxis(readFloat(data + MP_ORIENTATION_OFFSET),
+                                        readFloat(data + MP_ORIENTATION_OFFSET + 4),
+                                        readFloat(data + MP_ORIENTATION_OFFSET + 8));
+  double headingRad, pitchRad, rollRad;
+  toEuler(multiply(conjugate(fromLonLat(lonRad, latRad)), earthOrientation), headingRad, pitchRad, rollRad);
+  position.headingTrueDeg = static_cast<float>(headingRad * RAD_TO_DEG);
+  position.pitchDeg = static_cast<float>(pitchRad * RAD_TO_DEG);
+  position.rollDeg = static_cast<float>(rollRad * RAD_TO_DEG);
+
+  // Velocities are in the body frame
+  double body[3], ned[3];
+  for(int i = 0; i < 3; i++)
+    body[i] = readFloat(data + MP_LINEAR_VELOCITY_OFFSET + i * 4);
+  rotateBody(headingRad, pitchRad, rollRad, body, ned, false);
+  position.groundSpeedKts = static_cast<float>(std::hypot(ned[0], ned[1]) * MPS_TO_KTS);
+  position.verticalSpeedFeetPerMin = static_cast<float>(-ned[2] * METER_TO_FEET * 60.);
+
+  return true;
+}
+
+QByteArray encodeMultiplayerPosition(const MultiplayerPosition& position)
+{
+  QByteArray datagram(MP_POSITION_MESSAGE_SIZE, '\0');
+  char *data = datagram.data();
+
+  writeUInt(data, MP_MAGIC);
+  writeUInt(data + 4, MP_PROTOCOL_VERSION);
+  writeUInt(data + 8, MP_POSITION_MESSAGE_ID);
+  writeUInt(data + 12, MP_POSITION_MESSAGE_SIZE);
+  std::memcpy(data + MP_CALLSIGN_OFFSET, position.callsign.constData(),
+              static_cast<size_t>(std::min(position.callsign.size(), MP_CALLSIGN_SIZE)));
+  std::memcpy(data + MP_MODEL_OFFSET, position.model.constData(),
+              static_cast<size_t>(std::min(position.model.size(), MP_MODEL_SIZE - 1)));
+
+  writeDouble(data + MP_TIME_OFFSET, position.time);
+
+  double lonRad = position.lonX * DEG_TO_RAD, latRad = position.latY * DEG_TO_RAD;
+  double cart[3];
+  geodeticToCartesian(lonRad, latRad, position.altitudeFt / METER_TO_FEET, cart);
+  for(int i = 0; i < 3; i++)
+    writeDouble(data + MP_POSITION_OFFSET + i * 8, cart[i]);
+
+  double headingRad = position.headingTrueDeg * DEG_TO_RAD, pitchRad = position.pitchDeg * DEG_TO_RAD,
+         rollRad = position.rollDeg * DEG_TO_RAD;
+  double x, y, z;
+  toAngleAxis(multiply(fromLonLat(lonRad, latRad), fromEuler(headingRad, pitchRad, rollRad)), x, y, z);
+  writeFloat(data + MP_ORIENTATION_OFFSET, static_cast<float>(x));
+  writeFloat(data + MP_ORIENTATION_OFFSET + 4, static_cast<float>(y));
+  writeFloat(data + MP_ORIENTATION_OFFSET + 8, static_cast<float>(z));
+
+  // Moving along the heading
+  double ned[3] = {
+    position.groundSpeedKts / MPS_TO_KTS * std::cos(headingRad),
+    position.groundSpeedKts / MPS_TO_KTS * std::sin(headingRad),
+    -position.verticalSpeedFeetPerMin / METER_TO_FEET / 60.
+  };
+  double body[3];
+  rotateBody(headingRad, pitchRad, rollRad, ned, body, true);
+  for(int i = 0; i < 3; i++)
+    writeFloat(data + MP_LINEAR_VELOCITY_OFFSET + i * 4, static_cast<float>(body[i]));
+
+  return datagram;
+}
+
+} // namespace lfgc
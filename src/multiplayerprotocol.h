@@ -0,0 +1,60 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLEFGCONNECT_MULTIPLAYERPROTOCOL_H
+#define LITTLEFGCONNECT_MULTIPLAYERPROTOCOL_H
+
+#include <QByteArray>
+
+/*
+ * Position messages of the FlightGear multiplayer protocol.
+ *
+ * A message has a 32 byte header with magic "FGFS", version, message id, length and callsign followed by the
+ * model path, the time, the earth centered cartesian position, the orientation as an angle axis rotation in
+ * the earth centered frame and velocities and accelerations in the body frame. All values are XDR encoded.
+ * Properties following the position are not used here.
+ */
+namespace lfgc {
+
+/* Decoded multiplayer position message */
+struct MultiplayerPosition
+{
+  /* Views on the datagram after decoding. Callsign without padding and model path like
+   * "Aircraft/c172p/Models/c172p.xml". */
+  QByteArray callsign, model;
+
+  /* Simulation time of the sender in seconds */
+  double time = 0.;
+
+  double lonX = 0., latY = 0., altitudeFt = 0.;
+  float headingTrueDeg = 0.f, pitchDeg = 0.f, rollDeg = 0.f;
+
+  /* Derived from the body velocities */
+  float groundSpeedKts = 0.f, verticalSpeedFeetPerMin = 0.f;
+};
+
+/* Decode a position message. Returns false for other messages and invalid packets. */
+bool decodeMultiplayerPosition(const QByteArray& datagram, MultiplayerPosition& position);
+
+/* Build a position message with the values of position. Used by test senders. */
+QByteArray encodeMultiplayerPosition(const MultiplayerPosition& position);
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_MULTIPLAYERPROTOCOL_H
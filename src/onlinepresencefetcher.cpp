@@ -0,0 +1,204 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "onlinepresencefetcher.h"
+
+#include <QDebug>
+#include <QTcpSocket>
+
+#include <algorithm>
+
+namespace lfgc {
+
+/* Results of servers which failed in this cycle are still used if not older than this
+ * number of cycles */
+static const int MAX_AGE_CYCLES = 3;
+
+OnlinePresenceFetcher::OnlinePresenceFetcher(const QStringList& serverList, int defaultPort, int timeoutMsParam,
+                                             int intervalMsParam, QObject *parent)
+  : QObject(parent), timeoutMs(timeoutMsParam), intervalMs(intervalMsParam)
+{
+  qDebug() << Q_FUNC_INFO << serverList;
+
+  for(const QString& serverStr : serverList)
+  {
+    QString str = serverStr.trimmed();
+    if(str.isEmpty())
+      continue;
+
+    Server *server = new Server;
+    if(str.contains(':'))
+    {
+      server->host = str.section(':', 0, -2);
+      server->port = static_cast<quint16>(str.section(':', -1).toUInt());
+    }
+    else
+    {
+      server->host = str;
+      server->port = static_cast<quint16>(defaultPort);
+    }
+
+    server->socket = new QTcpSocket(this);
+    server->timeoutTimer = new QTimer(this);
+    server->timeoutTimer->setSingleShot(true);
+
+    connect(server->socket, &QTcpSocket::connected, this, [server]() {
+      qDebug() << "connected..." << server->host;
+      server->parser.reset();
+    });
+    connect(server->socket, &QTcpSocket::readyRead, this, [server]() {
+      // Parse lines as they arrive
+      server->parser.readFrom(server->socket);
+    });
+    connect(server->socket, &QTcpSocket::disconnected, this, [this, server]() {
+      serverFinished(server, true);
+    });
+    connect(server->socket, &QAbstractSocket::errorOccurred, this,
+            [this, server](QAbstractSocket::SocketError error) {
+      // Server closes the connection after sending the dump - this is handled by disconnected
+      if(error != QAbstractSocket::RemoteHostClosedError)
+      {
+        qDebug() << "Error: " << server->host << server->socket->errorString();
+        serverFinished(server, false);
+      }
+    });
+    connect(server->timeoutTimer, &QTimer::timeout, this, [this, server]() {
+      qDebug() << "Timeout: " << server->host;
+      serverFinished(server, false);
+    });
+
+    servers.append(server);
+  }
+
+  cycleTimer.setSingleShot(true);
+  connect(&cycleTimer, &QTimer::timeout, this, &OnlinePresenceFetcher::startCycle);
+}
+
+OnlinePresenceFetcher::~OnlinePresenceFetcher()
+{
+  stop();
+  qDeleteAll(servers);
+}
+
+void OnlinePresenceFetcher::start()
+{
+  running = true;
+  startCycle();
+}
+
+void OnlinePresenceFetcher::stop()
+{
+  running = false;
+  cycleTimer.stop();
+  for(Server *server : servers)
+  {
+    server->done = true;
+    server->timeoutTimer->stop();
+    server->socket->abort();
+  }
+}
+
+void OnlinePresenceFetcher::startCycle()
+{
+  if(!running)
+    return;
+
+  // Connect to all servers at once - nothing blocks here
+  for(Server *server : servers)
+  {
+    server->done = false;
+    server->parser.reset();
+    server->socket->abort();
+    server->timeoutTimer->start(timeoutMs);
+    server->socket->connectToHost(server->host, server->port);
+  }
+
+  if(servers.isEmpty())
+    cycleTimer.start(intervalMs);
+}
+
+void OnlinePresenceFetcher::serverFinished(Server *server, bool success)
+{
+  if(server->done)
+    return;
+
+  server->done = true;
+  server->timeoutTimer->stop();
+
+  if(success)
+  {
+    server->parser.finish();
+    server->lastTraffic = server->parser.getTraffic();
+    server->lastUpdate = QDateTime::currentDateTimeUtc();
+    qDebug() << Q_FUNC_INFO << server->host << server->lastTraffic.size() << "pilots";
+  }
+  else
+    // Disconnected signal would report success otherwise
+    server->socket->abort();
+
+  if(running && std::all_of(servers.constBegin(), servers.constEnd(), [](const Server *s) {
+    return s->done;
+  }))
+  {
+    mergeAndPublish();
+
+    // re-run connection after the interval
+    cycleTimer.start(intervalMs);
+  }
+}
+
+void OnlinePresenceFetcher::mergeAndPublish()
+{
+  QDateTime oldest = QDateTime::currentDateTimeUtc().addMSecs(-MAX_AGE_CYCLES * (intervalMs + timeoutMs));
+
+  // Merge oldest first so that fresher samples overwrite older ones for the same callsign
+  QVector<const Server *> sorted;
+  for(const Server *server : servers)
+  {
+    if(server->lastUpdate.isValid() && server->lastUpdate > oldest)
+      sorted.append(server);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const Server *s1, const Server *s2) {
+    return s1->lastUpdate < s2->lastUpdate;
+  });
+
+  merged.clear();
+  callsignIndex.clear();
+  int duplicates = 0;
+  for(const Server *server : sorted)
+  {
+    const TrafficStore& traffic = server->lastTraffic;
+    for(int i = 0; i < traffic.size(); i++)
+    {
+      auto it = callsignIndex.find(traffic.getCallsign(i));
+      if(it != callsignIndex.end())
+      {
+        merged.copyRow(it.value(), traffic, i);
+        duplicates++;
+      }
+      else
+        callsignIndex.insert(traffic.getCallsign(i), merged.appendRow(traffic, i));
+    }
+  }
+
+  qDebug() << Q_FUNC_INFO << "servers" << sorted.size() << "pilots" << merged.size() << "duplicates" << duplicates;
+
+  emit onlineTrafficUpdated(merged);
+}
+
+} // namespace lfgc
@@ -0,0 +1,96 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_ONLINEPRESENCEFETCHER_H
+#define LITTLEFGCONNECT_ONLINEPRESENCEFETCHER_H
+
+#include "onlinestatusparser.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+
+class QTcpSocket;
+
+namespace lfgc {
+
+/*
+ * Fetches the pilot lists from one or more FlightGear multiplayer servers concurrently.
+ *
+ * All servers are queried at the same time using non-blocking sockets, each with its own timeout.
+ * When all servers have answered or timed out the results are merged into one traffic set which is
+ * deduplicated by callsign. The sample from the most recently completed dump wins for duplicates.
+ * The merged set is emitted once per cycle and the next cycle starts after the update interval.
+ *
+ * Lives in the main thread context.
+ */
+class OnlinePresenceFetcher :
+  public QObject
+{
+  Q_OBJECT
+
+public:
+  /* Servers are given as "host" or "host:port". defaultPort is used if no port is given. */
+  OnlinePresenceFetcher(const QStringList& servers, int defaultPort, int timeoutMsParam, int intervalMsParam,
+                        QObject *parent = nullptr);
+  virtual ~OnlinePresenceFetcher() override;
+
+  /* Start first cycle */
+  void start();
+
+  /* Abort all connections and stop fetching */
+  void stop();
+
+signals:
+  /* Merged and deduplicated pilots of all servers. Emitted once per cycle. */
+  void onlineTrafficUpdated(const lfgc::TrafficStore& traffic);
+
+private:
+  struct Server
+  {
+    QString host;
+    quint16 port = 0;
+    QTcpSocket *socket = nullptr;
+    QTimer *timeoutTimer = nullptr;
+    OnlineStatusParser parser;
+
+    /* Result of the last successful fetch */
+    TrafficStore lastTraffic;
+    QDateTime lastUpdate;
+
+    bool done = true;
+  };
+
+  void startCycle();
+  void serverFinished(Server *server, bool success);
+  void mergeAndPublish();
+
+  QVector<Server *> servers;
+  int timeoutMs, intervalMs;
+  QTimer cycleTimer;
+  bool running = false;
+
+  /* Reused for merging to avoid allocations */
+  TrafficStore merged;
+  QHash<QString, int> callsignIndex;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_ONLINEPRESENCEFETCHER_H
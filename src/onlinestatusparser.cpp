@@ -0,0 +1,156 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "onlinestatusparser.h"
+
+#include "fieldreader.h"
+#include "tracezone.h"
+
+#include <QDebug>
+#include <QIODevice>
+
+#include <algorithm>
+#include <cstring>
+
+namespace lfgc {
+
+/* Initial size of the read buffer which grows if a line is longer */
+static const int BUFFER_SIZE = 16384;
+
+/* Model file extension */
+static const char MODEL_EXTENSION[] = ".xml";
+static const int MODEL_EXTENSION_LENGTH = 4;
+
+/* Minimum number of fields in a pilot line */
+static const int MIN_FIELDS = 11;
+
+OnlineStatusParser::OnlineStatusParser()
+{
+  buffer.reserve(BUFFER_SIZE);
+}
+
+void OnlineStatusParser::reset()
+{
+  buffer.resize(0);
+  traffic.clear();
+  numLines = numErrors = 0;
+}
+
+void OnlineStatusParser::readFrom(QIODevice *device)
+{
+  qint64 available = device->bytesAvailable();
+  if(available <= 0)
+    return;
+
+  // Read directly into the end of the buffer
+  int oldSize = buffer.size();
+  buffer.resize(oldSize + static_cast<int>(available));
+  qint64 numRead = device->read(buffer.data() + oldSize, available);
+  buffer.resize(oldSize + static_cast<int>(std::max(numRead, qint64(0))));
+
+  parseLines();
+}
+
+void OnlineStatusParser::feed(const char *bytes, int length)
+{
+  buffer.append(bytes, length);
+  parseLines();
+}
+
+void OnlineStatusParser::finish()
+{
+  // Last line without line feed
+  if(!buffer.isEmpty())
+    parseLine(buffer.constData(), buffer.constData() + buffer.size());
+  buffer.resize(0);
+
+  qDebug() << Q_FUNC_INFO << "Lines" << numLines << "pilots" << traffic.size() << "errors" << numErrors;
+}
+
+void OnlineStatusParser::parseLines()
+{
+  LFGC_TRACE_ZONE("parse online");
+  const char *begin = buffer.constData(), *end = begin + buffer.size(), *lineBegin = begin;
+
+  const char *lineEnd;
+  while((lineEnd = static_cast<const char *>(std::memchr(lineBegin, '\n', static_cast<size_t>(end - lineBegin)))) !=
+        nullptr)
+  {
+    parseLine(lineBegin, lineEnd);
+    lineBegin = lineEnd + 1;
+  }
+
+  // Keep the incomplete line - moves memory but keeps the capacity
+  buffer.remove(0, static_cast<int>(lineBegin - begin));
+}
+
+void OnlineStatusParser::parseLine(const char *begin, const char *end)
+{
+  // First line is a header
+  if(numLines++ == 0)
+    return;
+
+  while(end > begin && (end[-1] == '\r' || end[-1] == ' '))
+    end--;
+
+  if(begin == end || *begin == '#')
+    return;
+
+  if(std::count(begin, end, ' ') + 1 < MIN_FIELDS)
+  {
+    numErrors++;
+    return;
+  }
+
+  FieldReader userData(begin, end, ' ');
+
+  // 0 callsign
+  userData.next();
+  const char *at = static_cast<const char *>(std::memchr(userData.fieldBegin(), '@',
+                                                         static_cast<size_t>(userData.fieldLength())));
+  QString callsign = stringPool.intern(userData.fieldBegin(),
+                                       static_cast<int>((at != nullptr ? at : userData.fieldEnd()) -
+                                                        userData.fieldBegin()));
+  // 1-3 - cartesian coordinates
+  userData.skip(3);
+  // 4 - lat
+  float latitudeDeg = userData.readFloat();
+  // 5 - lon
+  float longitudeDeg = userData.readFloat();
+  // 6 - altitude
+  float altitudeFt = userData.readFloat();
+  // 7-9 - orientation
+  userData.skip(3);
+  // 10 - model - file name without path and extension
+  userData.next();
+  const char *modelBegin = userData.fieldBegin(), *modelEnd = userData.fieldEnd();
+  const char *slash = modelEnd;
+  while(slash > modelBegin && slash[-1] != '/')
+    slash--;
+  const char *xml = std::search(slash, modelEnd, MODEL_EXTENSION, MODEL_EXTENSION + MODEL_EXTENSION_LENGTH);
+  QString model = stringPool.intern(slash, static_cast<int>(xml - slash));
+
+  int row = traffic.append();
+  traffic.setCallsign(row, callsign);
+  traffic.setFromIdent(row, QString());
+  traffic.setToIdent(row, QString());
+  traffic.setModel(row, model);
+  traffic.setPosition(row, longitudeDeg, latitudeDeg, altitudeFt);
+}
+
+} // namespace lfgc
@@ -0,0 +1,85 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_ONLINESTATUSPARSER_H
+#define LITTLEFGCONNECT_ONLINESTATUSPARSER_H
+
+#include "stringpool.h"
+#include "trafficstore.h"
+
+#include <QByteArray>
+
+class QIODevice;
+
+namespace lfgc {
+
+/*
+ * Streaming parser for the pilot list dump of the FlightGear multiplayer server.
+ *
+ * Bytes are read from the socket as they arrive into a reusable buffer. Each complete line is
+ * parsed into the traffic store immediately so the result is ready when the server closes the connection.
+ *
+ * Line format:
+ * "RER@mpserver01: 1034171.664623 -6222033.096334 1007853.793531 9.138567 -80.563069 32170.780096
+ * -1.734371 0.059653 0.326972 Aircraft/757-200/Models/757-200.xml"
+ */
+class OnlineStatusParser
+{
+public:
+  OnlineStatusParser();
+
+  /* Prepare for a new dump. Keeps allocated memory. */
+  void reset();
+
+  /* Read all available bytes from device and parse all complete lines */
+  void readFrom(QIODevice *device);
+
+  /* Add bytes and parse all complete lines */
+  void feed(const char *bytes, int length);
+
+  /* Parse remaining incomplete line. Call when connection was closed. */
+  void finish();
+
+  /* Pilots of the last or currently parsed dump */
+  const TrafficStore& getTraffic() const
+  {
+    return traffic;
+  }
+
+  /* Number of lines which could not be parsed */
+  int getNumErrors() const
+  {
+    return numErrors;
+  }
+
+private:
+  /* Parse all complete lines in buffer and remove them */
+  void parseLines();
+  void parseLine(const char *begin, const char *end);
+
+  /* Unparsed bytes - usually an incomplete line */
+  QByteArray buffer;
+
+  TrafficStore traffic;
+  StringPool stringPool;
+  int numLines = 0, numErrors = 0;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_ONLINESTATUSPARSER_H
@@ -59,6 +59,17 @@ QString OptionsDialog::getMultiplayerServerHost() const
     return ui->textLineMultiplayerServerHost->text();
 }
 
+QStringList OptionsDialog::getRelayTargets() const
+{
+  QStringList targets;
+  for(const QString& target : ui->textLineRelayTargets->text().split(',', Qt::SkipEmptyParts))
+  {
+    if(!target.trimmed().isEmpty())
+      targets.append(target.trimmed());
+  }
+  return targets;
+}
+
 void OptionsDialog::setFetchAiAircraft(bool value)
 {
   ui->checkBoxFetchAiAircraft->setChecked(value);
@@ -84,3 +95,7 @@ void OptionsDialog::setMultiplayerServerPort(int port)
     ui->spinBoxMultiplayerServerPort->setValue(port);
 }
 
+void OptionsDialog::setRelayTargets(const QStringList& targets)
+{
+  ui->textLineRelayTargets->setText(targets.join(", "));
+}
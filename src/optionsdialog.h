@@ -39,12 +39,14 @@ public:
   bool isFetchAiAircraft() const;
   QString getMultiplayerServerHost() const;
   int getMultiplayerServerPort() const;
+  QStringList getRelayTargets() const;
 
   void setPort(int port);
   void setUpdateRate(unsigned int ms);
   void setFetchAiAircraft(bool value);
   void setMultiplayerServerHost(QString host);
   void setMultiplayerServerPort(int port);
+  void setRelayTargets(const QStringList& targets);
 
 private:
   Ui::OptionsDialog *ui;
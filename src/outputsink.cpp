@@ -0,0 +1,351 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "outputsink.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+namespace lfgc {
+
+/* Frames waiting for distribution to the sinks */
+static const int MAX_PIPELINE_QUEUE_SIZE = 1024;
+
+OutputSinkQueue OutputSinkQueue::fromString(const QString& spec, const OutputSinkQueue& defaultQueue)
+{
+  OutputSinkQueue queue;
+  QStringList parts = spec.trimmed().toLower().split(':');
+  const QString& name = parts.constFirst();
+
+  if(name.isEmpty())
+    return defaultQueue;
+
+  bool ok = true;
+  if(parts.size() == 1 && name == "latest")
+  {
+    queue.policy = LATEST_ONLY;
+    queue.capacity = 1;
+  }
+  else if(parts.size() == 2 && (name == "bounded" || name == "block"))
+  {
+    queue.policy = name == "block" ? BLOCK : BOUNDED;
+    queue.capacity = parts.at(1).toInt(&ok);
+    ok &= queue.capacity > 0;
+  }
+  else
+    ok = false;
+
+  if(!ok)
+  {
+    qWarning() << Q_FUNC_INFO << "Invalid sink queue" << spec;
+    return defaultQueue;
+  }
+  return queue;
+}
+
+QString OutputSinkQueue::toString() const
+{
+  switch(policy)
+  {
+    case LATEST_ONLY:
+      return "latest";
+
+    case BOUNDED:
+      return QString("bounded:%1").arg(capacity);
+
+    case BLOCK:
+      return QString("block:%1").arg(capacity);
+  }
+  return QString();
+}
+
+OutputSink::~OutputSink()
+{
+}
+
+// ======================================================================================
+/* Runs one sink with its own queue */
+class OutputSinkWorker :
+  public QThread
+{
+public:
+  OutputSinkWorker(OutputSink *sinkParam, const OutputSinkQueue& queueConfigParam);
+  virtual ~OutputSinkWorker() override;
+
+  /* Add frame according to the queue policy. Called in the pipeline thread context. */
+  void enqueue(const OutputFramePtr& frame);
+
+  /* Write all queued frames, close the sink and wait for terminated */
+  void terminateThread();
+
+  OutputSinkStatistics getStatistics() const;
+
+private:
+  virtual void run() override;
+
+  OutputSink *sink;
+  OutputSinkQueue queueConfig;
+
+  bool terminate = false, failed = false, finished = false;
+  QVector<OutputFramePtr> queue;
+  OutputSinkStatistics statistics;
+  QElapsedTimer elapsed;
+
+  mutable QMutex queueMutex;
+  QWaitCondition notEmpty, notFull;
+};
+
+OutputSinkWorker::OutputSinkWorker(OutputSink *sinkParam, const OutputSinkQueue& queueConfigParam)
+  : sink(sinkParam), queueConfig(queueConfigParam)
+{
+  statistics.name = sink->getSinkName();
+  statistics.queue = queueConfig.toString();
+  queue.reserve(queueConfig.capacity);
+}
+
+OutputSinkWorker::~OutputSinkWorker()
+{
+  delete sink;
+}
+
+void OutputSinkWorker::enqueue(const OutputFramePtr& frame)
+{
+  {
+    QMutexLocker locker(&queueMutex);
+    if(failed)
+    {
+      statistics.dropped++;
+      return;
+    }
+
+    switch(queueConfig.policy)
+    {
+      case OutputSinkQueue::LATEST_ONLY:
+        statistics.dropped += static_cast<quint64>(queue.size());
+        queue.clear();
+        queue.append(frame);
+        break;
+
+      case OutputSinkQueue::BOUNDED:
+        if(queue.size() < queueConfig.capacity)
+          queue.append(frame);
+        else
+          statistics.dropped++;
+        break;
+
+      case OutputSinkQueue::BLOCK:
+        while(queue.size() >= queueConfig.capacity && !failed)
+          notFull.wait(&queueMutex);
+
+        if(failed)
+          statistics.dropped++;
+        else
+          queue.append(frame);
+        break;
+    }
+    statistics.maxQueued = std::max(statistics.maxQueued, queue.size());
+  }
+  notEmpty.wakeAll();
+}
+
+void OutputSinkWorker::terminateThread()
+{
+  {
+    QMutexLocker locker(&queueMutex);
+    terminate = true;
+  }
+  notEmpty.wakeAll();
+  wait();
+}
+
+OutputSinkStatistics OutputSinkWorker::getStatistics() const
+{
+  QMutexLocker locker(&queueMutex);
+  OutputSinkStatistics stats = statistics;
+  if(!finished && elapsed.isValid())
+    stats.elapsedNs = elapsed.nsecsElapsed();
+  return stats;
+}
+
+void OutputSinkWorker::run()
+{
+  qDebug() << "LittleFgconnect" << Q_FUNC_INFO << statistics.name;
+
+  if(!sink->openSink())
+  {
+    qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot open sink" << statistics.name;
+
+    // Drop everything from now on and release a waiting pipeline
+    QMutexLocker locker(&queueMutex);
+    failed = finished = true;
+    statistics.dropped += static_cast<quint64>(queue.size());
+    queue.clear();
+    notFull.wakeAll();
+    return;
+  }
+
+  QVector<OutputFramePtr> batch;
+  batch.reserve(queueConfig.capacity);
+  elapsed.start();
+  int idleTimeoutMs = sink->getIdleTimeoutMs();
+
+  queueMutex.lock();
+  while(true)
+  {
+    bool timedOut = false;
+    if(queue.isEmpty() && !terminate)
+    {
+      if(idleTimeoutMs > 0)
+        timedOut = !notEmpty.wait(&queueMutex, static_cast<unsigned long>(idleTimeoutMs));
+      else
+        notEmpty.wait(&queueMutex);
+    }
+
+    if(queue.isEmpty())
+    {
+      if(terminate)
+        break;
+
+      if(timedOut)
+      {
+        queueMutex.unlock();
+        sink->idle();
+        queueMutex.lock();
+      }
+      continue;
+    }
+
+    batch.swap(queue);
+    notFull.wakeAll();
+    queueMutex.unlock();
+
+    QElapsedTimer busyTimer;
+    busyTimer.start();
+    for(const OutputFramePtr& frame : batch)
+      sink->writeFrame(*frame);
+    qint64 busyNs = busyTimer.nsecsElapsed();
+    int numWritten = batch.size();
+    batch.clear();
+
+    queueMutex.lock();
+    statistics.written += static_cast<quint64>(numWritten);
+    statistics.busyNs += busyNs;
+  }
+  queueMutex.unlock();
+
+  sink->closeSink();
+
+  QMutexLocker locker(&queueMutex);
+  statistics.elapsedNs = elapsed.nsecsElapsed();
+  finished = true;
+}
+
+// ======================================================================================
+OutputPipeline::OutputPipeline()
+{
+  queue.reserve(MAX_PIPELINE_QUEUE_SIZE);
+}
+
+OutputPipeline::~OutputPipeline()
+{
+  qDeleteAll(workers);
+}
+
+void OutputPipeline::addSink(OutputSink *sink, const OutputSinkQueue& queue)
+{
+  qDebug() << Q_FUNC_INFO << sink->getSinkName() << queue.toString();
+  sinksNeedTraffic |= sink->needsTraffic();
+  workers.append(new OutputSinkWorker(sink, queue));
+}
+
+void OutputPipeline::publish(const OutputFramePtr& frame)
+{
+  {
+    QMutexLocker locker(&queueMutex);
+    if(queue.size() < MAX_PIPELINE_QUEUE_SIZE)
+      queue.append(frame);
+    else
+      numDropped++;
+  }
+  waitCondition.wakeAll();
+}
+
+void OutputPipeline::terminateThread()
+{
+  {
+    QMutexLocker locker(&queueMutex);
+    terminate = true;
+  }
+  waitCondition.wakeAll();
+  wait();
+}
+
+QVector<OutputSinkStatistics> OutputPipeline::getStatistics() const
+{
+  QVector<OutputSinkStatistics> statistics;
+  for(const OutputSinkWorker *worker : workers)
+    statistics.append(worker->getStatistics());
+  return statistics;
+}
+
+quint64 OutputPipeline::getNumDropped() const
+{
+  QMutexLocker locker(&queueMutex);
+  return numDropped;
+}
+
+void OutputPipeline::run()
+{
+  qDebug() << "LittleFgconnect" << Q_FUNC_INFO << workers.size() << "sinks";
+
+  for(OutputSinkWorker *worker : workers)
+    worker->start();
+
+  QVector<OutputFramePtr> batch;
+  batch.reserve(MAX_PIPELINE_QUEUE_SIZE);
+
+  queueMutex.lock();
+  while(true)
+  {
+    if(queue.isEmpty() && !terminate)
+      waitCondition.wait(&queueMutex);
+
+    bool done = terminate;
+    batch.swap(queue);
+    queueMutex.unlock();
+
+    for(const OutputFramePtr& frame : batch)
+    {
+      for(OutputSinkWorker *worker : workers)
+        worker->enqueue(frame);
+    }
+    batch.clear();
+
+    if(done)
+      break;
+    queueMutex.lock();
+  }
+
+  // Sinks write all frames still queued before closing
+  for(OutputSinkWorker *worker : workers)
+    worker->terminateThread();
+}
+
+} // namespace lfgc
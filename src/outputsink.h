@@ -0,0 +1,201 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_OUTPUTSINK_H
+#define LITTLEFGCONNECT_OUTPUTSINK_H
+
+#include "fs/sc/simconnectdata.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+namespace lfgc {
+
+/* One published frame. Shared read only by all sinks. */
+struct OutputFrame
+{
+  /* Counts all published frames starting with 1 */
+  quint64 sequence = 0;
+
+  /* Milliseconds since epoch UTC when published */
+  qint64 timestampMs = 0;
+
+  /* lfgc::monotonicNowNs() when the datagram was received */
+  qint64 receiveTimeNs = 0;
+
+  /* False if only the traffic was updated since the last frame */
+  bool userChanged = true;
+
+  atools::fs::sc::SimConnectData data;
+};
+
+typedef QSharedPointer<const OutputFrame> OutputFramePtr;
+
+/* What to do if a sink cannot keep up */
+struct OutputSinkQueue
+{
+  enum Policy
+  {
+    /* Keep only the newest frame and drop all older ones not written yet */
+    LATEST_ONLY,
+
+    /* Queue up to capacity frames and drop new frames if full */
+    BOUNDED,
+
+    /* Queue up to capacity frames and wait for the sink if full. Never drops. */
+    BLOCK
+  };
+
+  Policy policy = BOUNDED;
+  int capacity = 1024;
+
+  /* Parse "latest", "bounded:<capacity>" or "block:<capacity>". Returns defaultQueue and prints a warning
+   * for invalid strings. */
+  static OutputSinkQueue fromString(const QString& spec, const OutputSinkQueue& defaultQueue);
+
+  QString toString() const;
+};
+
+/* Counters of one sink */
+struct OutputSinkStatistics
+{
+  QString name, queue;
+  quint64 written = 0, dropped = 0;
+
+  /* Maximum number of frames waiting for the sink */
+  int maxQueued = 0;
+
+  /* Time spent in writeFrame and time since start */
+  qint64 busyNs = 0, elapsedNs = 0;
+
+  /* Written frames per second */
+  double getThroughput() const
+  {
+    return elapsedNs > 0 ? static_cast<double>(written) * 1.e9 / static_cast<double>(elapsedNs) : 0.;
+  }
+};
+
+/*
+ * Receiver of published frames. Each sink is run in its own thread by the OutputPipeline.
+ * All methods are called in the sink thread context.
+ */
+class OutputSink
+{
+public:
+  virtual ~OutputSink();
+
+  /* Name used for logging and statistics */
+  virtual QString getSinkName() const = 0;
+
+  /* Called once before the first frame. Returning false disables the sink. */
+  virtual bool openSink()
+  {
+    return true;
+  }
+
+  /* True if the sink reads the AI and online aircraft of the frames. Frames get only the user aircraft
+   * and metadata if no sink and no other consumer needs the traffic. */
+  virtual bool needsTraffic() const
+  {
+    return false;
+  }
+
+  virtual void writeFrame(const OutputFrame& frame) = 0;
+
+  /* idle() is called after no frame arrived for this number of milliseconds. 0 disables idle calls. */
+  virtual int getIdleTimeoutMs() const
+  {
+    return 0;
+  }
+
+  /* Called if no frame arrived for the idle timeout */
+  virtual void idle()
+  {
+  }
+
+  /* Called once after the last frame */
+  virtual void closeSink()
+  {
+  }
+};
+
+class OutputSinkWorker;
+
+/*
+ * Distributes published frames to any number of sinks.
+ *
+ * publish() only appends the frame to a bounded queue and never waits. The pipeline thread passes
+ * each frame to the queues of all sinks according to their policy. Every sink is written from its own
+ * thread so a slow sink cannot delay the caller or other sinks. Only a sink with the BLOCK policy
+ * can stall the distribution to other sinks. The caller is still never blocked and frames beyond
+ * the pipeline queue are dropped and counted.
+ */
+class OutputPipeline :
+  public QThread
+{
+public:
+  OutputPipeline();
+  virtual ~OutputPipeline() override;
+
+  /* Register a sink before start(). Takes ownership. */
+  void addSink(OutputSink *sink, const OutputSinkQueue& queue);
+
+  bool isEmpty() const
+  {
+    return workers.isEmpty();
+  }
+
+  /* True if any of the sinks reads the traffic */
+  bool needsTraffic() const
+  {
+    return sinksNeedTraffic;
+  }
+
+  /* Queue frame for all sinks. Never blocks except for the short queue lock. */
+  void publish(const OutputFramePtr& frame);
+
+  /* Pass all queued frames to the sinks, wait until they are written and stop all threads */
+  void terminateThread();
+
+  /* Get a copy of the counters for all sinks */
+  QVector<OutputSinkStatistics> getStatistics() const;
+
+  /* Frames dropped because the pipeline queue was full */
+  quint64 getNumDropped() const;
+
+private:
+  virtual void run() override;
+
+  QVector<OutputSinkWorker *> workers;
+  bool sinksNeedTraffic = false;
+
+  bool terminate = false;
+  QVector<OutputFramePtr> queue;
+  quint64 numDropped = 0;
+
+  mutable QMutex queueMutex;
+  QWaitCondition waitCondition;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_OUTPUTSINK_H
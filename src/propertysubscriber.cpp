@@ -0,0 +1,228 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "propertysubscriber.h"
+
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QWebSocket>
+
+namespace lfgc {
+
+struct PropertyDefinition
+{
+  const char *path;
+
+  /* Converts the FlightGear unit to the unit of the generic protocol */
+  double scale;
+};
+
+/* Indexed by PropertyId */
+static const PropertyDefinition PROPERTIES[] =
+{
+  {"/sim/time/gmt", 1.},
+  {"/sim/time/local-offset", 1.},
+  {"/position/altitude-agl-ft", 1.},
+  {"/position/ground-elev-ft", 1.},
+  {"/environment/wind-speed-kt", 1.},
+  {"/environment/wind-from-heading-deg", 1.},
+  {"/environment/temperature-degc", 1.},
+  {"/environment/pressure-sea-level-inhg", 1.},
+  {"/yasim/gross-weight-lbs", 1.},
+  {"/fdm/jsbsim/inertia/weight-lbs", 1.},
+  {"/consumables/fuel/total-fuel-gal_us", 1.},
+  {"/consumables/fuel/total-fuel-lbs", 1.},
+  {"/engines/engine[0]/fuel-flow-gph", 1.},
+  {"/fdm/jsbsim/propulsion/engine[0]/fuel-flow-rate-pps", 1.},
+  {"/engines/engine[0]/fuel-flow-gph", 1.},
+  {"/engines/engine[1]/fuel-flow-gph", 1.},
+  {"/engines/engine[2]/fuel-flow-gph", 1.},
+  {"/engines/engine[3]/fuel-flow-gph", 1.},
+  {"/environment/magnetic-variation-deg", 1.},
+  {"/environment/visibility-m", 1.},
+  {"/orientation/track-magnetic-deg", 1.},
+  {"/orientation/track-deg", 1.},
+  {"/sim/description", 1.},
+  {"/sim/aero", 1.},
+  {"/sim/multiplay/callsign", 1.},
+  {"/position/latitude-deg", 1.},
+  {"/position/longitude-deg", 1.},
+  {"/orientation/heading-deg", 1.},
+  {"/orientation/heading-magnetic-deg", 1.},
+  {"/velocities/groundspeed-kt", 1.},
+  {"/instrumentation/altimeter/indicated-altitude-ft", 1.},
+  {"/velocities/airspeed-kt", 1.},
+  {"/instrumentation/airspeed-indicator/true-speed-kt", 1.},
+  {"/velocities/mach", 1.},
+  {"/velocities/vertical-speed-fps", 60.},
+  {"/sim/flight-model", 1.},
+  {"/sim/freeze/clock", 1.},
+  {"/sim/replay/replay-state", 1.},
+  {"/sim/multiplay/online", 1.},
+  {"/sim/multiplay/txhost", 1.}
+};
+
+static_assert(sizeof(PROPERTIES) / sizeof(PROPERTIES[0]) == PROP_NUM_PROPERTIES, "Property table incomplete");
+
+PropertySubscriber::PropertySubscriber(const QUrl& urlParam, int reconnectMsParam, QObject *parent)
+  : QObject(parent), url(urlParam), reconnectMs(reconnectMsParam)
+{
+  qDebug() << Q_FUNC_INFO << url;
+
+  for(int i = 0; i < PROP_NUM_PROPERTIES; i++)
+    pathIndex.insert(normalizePath(QString::fromLatin1(PROPERTIES[i].path)), static_cast<PropertyId>(i));
+
+  socket = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+  connect(socket, &QWebSocket::connected, this, &PropertySubscriber::connected);
+  connect(socket, &QWebSocket::disconnected, this, &PropertySubscriber::disconnected);
+  connect(socket, &QWebSocket::textMessageReceived, this, &PropertySubscriber::textMessageReceived);
+
+  reconnectTimer.setSingleShot(true);
+  connect(&reconnectTimer, &QTimer::timeout, this, [this]() {
+    if(running)
+      socket->open(url);
+  });
+
+  // Zero interval - fires after all messages already received are processed
+  flushTimer.setSingleShot(true);
+  flushTimer.setInterval(0);
+  connect(&flushTimer, &QTimer::timeout, this, &PropertySubscriber::flushChanges);
+}
+
+PropertySubscriber::~PropertySubscriber()
+{
+  stop();
+}
+
+void PropertySubscriber::start()
+{
+  running = true;
+  socket->open(url);
+}
+
+void PropertySubscriber::stop()
+{
+  running = false;
+  reconnectTimer.stop();
+  flushTimer.stop();
+  pendingChanges.clear();
+  socket->abort();
+}
+
+const char *PropertySubscriber::propertyPath(PropertyId id)
+{
+  return PROPERTIES[id].path;
+}
+
+QString PropertySubscriber::normalizePath(const QString& path)
+{
+  return QString(path).remove(QLatin1String("[0]"));
+}
+
+void PropertySubscriber::connected()
+{
+  qDebug() << Q_FUNC_INFO << url;
+
+  // Subscribe each path once and request the current value since listeners report only changes
+  QSet<QString> subscribed;
+  for(int i = 0; i < PROP_NUM_PROPERTIES; i++)
+  {
+    QString path = QString::fromLatin1(PROPERTIES[i].path);
+    if(subscribed.contains(path))
+      continue;
+    subscribed.insert(path);
+
+    QJsonObject command;
+    command.insert("command", "addListener");
+    command.insert("node", path);
+    socket->sendTextMessage(QString::fromUtf8(QJsonDocument(command).toJson(QJsonDocument::Compact)));
+
+    command.insert("command", "get");
+    socket->sendTextMessage(QString::fromUtf8(QJsonDocument(command).toJson(QJsonDocument::Compact)));
+  }
+}
+
+void PropertySubscriber::disconnected()
+{
+  qDebug() << Q_FUNC_INFO << url << socket->errorString();
+
+  if(running)
+    reconnectTimer.start(reconnectMs);
+}
+
+void PropertySubscriber::textMessageReceived(const QString& message)
+{
+  numMessages++;
+
+  // {"path":"/position/latitude-deg","name":"latitude-deg","value":50.03,"type":"double",...}
+  QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
+  if(!doc.isObject())
+  {
+    numIgnored++;
+    return;
+  }
+
+  QJsonObject object = doc.object();
+  QString path = normalizePath(object.value("path").toString());
+  auto it = pathIndex.find(path);
+  if(it == pathIndex.end())
+  {
+    numIgnored++;
+    return;
+  }
+
+  // Values are typed but older versions send all as strings
+  QJsonValue value = object.value("value");
+  double number = 0.;
+  QString text;
+  if(value.isBool())
+  {
+    number = value.toBool() ? 1. : 0.;
+    text = value.toBool() ? "true" : "false";
+  }
+  else if(value.isDouble())
+  {
+    number = value.toDouble();
+    text = QString::number(number);
+  }
+  else
+  {
+    text = value.toString();
+    number = text == "true" ? 1. : text.toDouble();
+  }
+
+  for(; it != pathIndex.end() && it.key() == path; ++it)
+    pendingChanges.append({it.value(), number * PROPERTIES[it.value()].scale, text});
+
+  if(!flushTimer.isActive())
+    flushTimer.start();
+}
+
+void PropertySubscriber::flushChanges()
+{
+  if(!pendingChanges.isEmpty())
+  {
+    emit propertiesChanged(pendingChanges);
+    pendingChanges.clear();
+  }
+}
+
+} // namespace lfgc
@@ -0,0 +1,156 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_PROPERTYSUBSCRIBER_H
+#define LITTLEFGCONNECT_PROPERTYSUBSCRIBER_H
+
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+class QWebSocket;
+
+namespace lfgc {
+
+/* Property values used to build the user aircraft. See PropertySubscriber for the paths.
+ * Order matches the fields of the combined generic protocol layout without the AI objects. */
+enum PropertyId
+{
+  PROP_TIME_GMT,
+  PROP_TIME_LOCAL_OFFSET,
+  PROP_ALTITUDE_AGL,
+  PROP_GROUND_ELEVATION,
+  PROP_WIND_SPEED,
+  PROP_WIND_DIRECTION,
+  PROP_TEMPERATURE,
+  PROP_SEA_LEVEL_PRESSURE,
+  PROP_WEIGHT_YASIM,
+  PROP_WEIGHT_JSBSIM,
+  PROP_FUEL_QUANTITY,
+  PROP_FUEL_WEIGHT,
+  PROP_FUEL_FLOW_GPH,
+  PROP_FUEL_FLOW_PPS,
+  PROP_FUEL_FLOW_GPH0,
+  PROP_FUEL_FLOW_GPH1,
+  PROP_FUEL_FLOW_GPH2,
+  PROP_FUEL_FLOW_GPH3,
+  PROP_MAG_VAR,
+  PROP_VISIBILITY,
+  PROP_TRACK_MAG,
+  PROP_TRACK_TRUE,
+  PROP_TITLE,
+  PROP_MODEL,
+  PROP_CALLSIGN,
+  PROP_LATITUDE,
+  PROP_LONGITUDE,
+  PROP_HEADING_TRUE,
+  PROP_HEADING_MAG,
+  PROP_GROUND_SPEED,
+  PROP_INDICATED_ALTITUDE,
+  PROP_INDICATED_SPEED,
+  PROP_TRUE_AIRSPEED,
+  PROP_MACH,
+  PROP_VERTICAL_SPEED,
+  PROP_FLIGHT_MODEL,
+  PROP_FREEZE,
+  PROP_REPLAY,
+  PROP_MULTIPLAYER_ONLINE,
+  PROP_MULTIPLAYER_SERVER,
+  PROP_NUM_PROPERTIES
+};
+
+/* One changed property. number is already scaled to the unit used by the generic protocol. */
+struct PropertyChange
+{
+  PropertyId id;
+  double number;
+  QString text;
+};
+
+/*
+ * Alternative input backend which uses the FlightGear property listener websocket
+ * ("ws://<host>:<port>/PropertyListener", enabled with "--httpd=<port>") instead of the generic protocol.
+ *
+ * Subscribes to all properties needed for the user aircraft. FlightGear then pushes only changed values.
+ * All changes arriving in one event loop pass are collected and emitted together so that one FlightGear
+ * update results in one frame. Rarely changing values like titles or weights are sent only once.
+ *
+ * Reconnects after the given interval if the connection is lost.
+ *
+ * Lives in the main thread context.
+ */
+class PropertySubscriber :
+  public QObject
+{
+  Q_OBJECT
+
+public:
+  PropertySubscriber(const QUrl& urlParam, int reconnectMsParam, QObject *parent = nullptr);
+  virtual ~PropertySubscriber() override;
+
+  /* Connect and subscribe */
+  void start();
+
+  /* Close connection and stop reconnecting */
+  void stop();
+
+  /* FlightGear property path for id */
+  static const char *propertyPath(PropertyId id);
+
+  quint64 getNumMessages() const
+  {
+    return numMessages;
+  }
+
+  quint64 getNumIgnored() const
+  {
+    return numIgnored;
+  }
+
+signals:
+  /* Properties changed since the last emit. Emitted once per batch. */
+  void propertiesChanged(const QVector<lfgc::PropertyChange>& changes);
+
+private:
+  void connected();
+  void disconnected();
+  void textMessageReceived(const QString& message);
+  void flushChanges();
+
+  /* Remove "[0]" indexes which FlightGear may or may not add to paths */
+  static QString normalizePath(const QString& path);
+
+  QUrl url;
+  int reconnectMs;
+  bool running = false;
+
+  QWebSocket *socket = nullptr;
+  QTimer reconnectTimer, flushTimer;
+
+  /* Normalized path to property. A path can feed more than one property. */
+  QMultiHash<QString, PropertyId> pathIndex;
+
+  QVector<PropertyChange> pendingChanges;
+  quint64 numMessages = 0, numIgnored = 0;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_PROPERTYSUBSCRIBER_H
@@ -0,0 +1,178 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "publishscheduler.h"
+
+#include "fs/sc/simconnectuseraircraft.h"
+
+#include <QDebug>
+#include <QStringList>
+
+#include <cmath>
+
+namespace lfgc {
+
+/* Default intervals in milliseconds for HIGH, NORMAL, CRUISE and HEARTBEAT */
+static const int DEFAULT_INTERVALS_MS[PublishScheduler::NUM_PHASES] = {50, 200, 1000, 5000};
+
+/* Faster on ground is a takeoff or landing roll, slower is stationary */
+static const float ROLL_SPEED_KTS = 40.f, STATIONARY_SPEED_KTS = 2.f;
+
+/* Takeoff, approach and landing */
+static const float LOW_ALTITUDE_FT = 1500.f;
+
+/* Turns are published at the high rate, cruise needs wings level */
+static const float TURN_RATE_DEG_PER_SEC = 3.f, CRUISE_TURN_RATE_DEG_PER_SEC = 1.f;
+static const float CRUISE_VERTICAL_SPEED_FPM = 300.f;
+
+/* Track is too noisy for a turn rate at lower speeds */
+static const float MIN_TURN_SPEED_KTS = 30.f;
+
+/* Weight of the latest turn rate sample */
+static const float TURN_RATE_ALPHA = 0.3f;
+
+PublishScheduler::PublishScheduler()
+{
+  for(int i = 0; i < NUM_PHASES; i++)
+    intervalMs[i] = DEFAULT_INTERVALS_MS[i];
+}
+
+PublishScheduler PublishScheduler::fromString(const QString& spec)
+{
+  PublishScheduler scheduler;
+  QStringList parts = spec.trimmed().toLower().split(':');
+  const QString& name = parts.constFirst();
+
+  if(name.isEmpty() || name == "none")
+    return scheduler;
+
+  bool ok = name == "adaptive" && (parts.size() == 1 || parts.size() == NUM_PHASES + 2);
+  for(int i = 1; ok && i < parts.size(); i++)
+  {
+    int value = parts.at(i).toInt(&ok);
+    ok &= value > 0;
+    if(i <= NUM_PHASES)
+      scheduler.intervalMs[i - 1] = value;
+    else
+      scheduler.holdMs = value;
+  }
+
+  if(!ok)
+  {
+    qWarning() << Q_FUNC_INFO << "Invalid publish scheduler" << spec;
+    return PublishScheduler();
+  }
+
+  scheduler.enabled = true;
+  return scheduler;
+}
+
+QString PublishScheduler::phaseName(Phase phase)
+{
+  switch(phase)
+  {
+    case HIGH:
+      return "high";
+
+    case NORMAL:
+      return "normal";
+
+    case CRUISE:
+      return "cruise";
+
+    case HEARTBEAT:
+    case NUM_PHASES:
+      break;
+  }
+  return "heartbeat";
+}
+
+void PublishScheduler::reset()
+{
+  phase = candidate = NORMAL;
+  candidateSinceNs = lastTrackNs = 0;
+  lastTrackDeg = turnRateDegPerSec = 0.f;
+}
+
+PublishScheduler::Phase PublishScheduler::classify(const atools::fs::sc::SimConnectUserAircraft& aircraft,
+                                                   qint64 nowNs)
+{
+  float groundSpeedKts = aircraft.getGroundSpeedKts();
+
+  // Turn rate from track changes between two updates
+  float trackDeg = aircraft.getTrackDegTrue();
+  if(groundSpeedKts < MIN_TURN_SPEED_KTS)
+  {
+    turnRateDegPerSec = 0.f;
+    lastTrackNs = 0;
+  }
+  else if(lastTrackNs > 0 && nowNs > lastTrackNs)
+  {
+    float delta = std::remainder(trackDeg - lastTrackDeg, 360.f);
+    float rate = std::abs(delta) / ((nowNs - lastTrackNs) / 1.e9f);
+    turnRateDegPerSec = TURN_RATE_ALPHA * rate + (1.f - TURN_RATE_ALPHA) * turnRateDegPerSec;
+  }
+  if(groundSpeedKts >= MIN_TURN_SPEED_KTS)
+  {
+    lastTrackDeg = trackDeg;
+    lastTrackNs = nowNs;
+  }
+
+  if(aircraft.isSimPaused())
+    return HEARTBEAT;
+
+  if(aircraft.isOnGround())
+  {
+    if(groundSpeedKts < STATIONARY_SPEED_KTS)
+      return HEARTBEAT;
+    return groundSpeedKts >= ROLL_SPEED_KTS ? HIGH : NORMAL;
+  }
+
+  if(aircraft.getAltitudeAboveGroundFt() < LOW_ALTITUDE_FT || turnRateDegPerSec > TURN_RATE_DEG_PER_SEC)
+    return HIGH;
+
+  if(std::abs(aircraft.getVerticalSpeedFeetPerMin()) < CRUISE_VERTICAL_SPEED_FPM &&
+     turnRateDegPerSec < CRUISE_TURN_RATE_DEG_PER_SEC)
+    return CRUISE;
+
+  return NORMAL;
+}
+
+int PublishScheduler::update(const atools::fs::sc::SimConnectUserAircraft& aircraft, qint64 nowNs)
+{
+  Phase next = classify(aircraft, nowNs);
+
+  if(next != candidate)
+  {
+    candidate = next;
+    candidateSinceNs = nowNs;
+  }
+
+  // Faster immediately but slower only after the hold time to avoid toggling
+  if(candidate != phase &&
+     (intervalMs[candidate] < intervalMs[phase] || nowNs - candidateSinceNs >= holdMs * 1000000LL))
+  {
+    qDebug() << Q_FUNC_INFO << "Phase" << phaseName(phase) << "to" << phaseName(candidate);
+    phase = candidate;
+  }
+
+  return intervalMs[phase];
+}
+
+} // namespace lfgc
@@ -0,0 +1,111 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLEFGCONNECT_PUBLISHSCHEDULER_H
+#define LITTLEFGCONNECT_PUBLISHSCHEDULER_H
+
+#include <QString>
+
+namespace atools {
+namespace fs {
+namespace sc {
+class SimConnectUserAircraft;
+}
+}
+}
+
+namespace lfgc {
+
+/*
+ * Chooses the publish interval from the flight phase of the user aircraft.
+ *
+ * HIGH:      takeoff and landing roll, low altitude flight and turns
+ * NORMAL:    taxi, climb, descent and everything not covered by the other phases
+ * CRUISE:    level flight without turns
+ * HEARTBEAT: stationary on ground or paused
+ *
+ * Changes to a phase with a shorter interval are applied immediately. Changes to a longer interval
+ * only if the new phase was stable for the hold time.
+ *
+ * Configured by a string:
+ * "none" or empty: disabled
+ * "adaptive": default intervals
+ * "adaptive:<high>:<normal>:<cruise>:<heartbeat>:<hold>": intervals and hold time in milliseconds
+ *
+ * Not thread safe.
+ */
+class PublishScheduler
+{
+public:
+  enum Phase
+  {
+    HIGH,
+    NORMAL,
+    CRUISE,
+    HEARTBEAT,
+    NUM_PHASES
+  };
+
+  /* Creates a disabled scheduler */
+  PublishScheduler();
+
+  /* Parse description. Returns a disabled scheduler and prints a warning for invalid strings. */
+  static PublishScheduler fromString(const QString& spec);
+
+  /* Classify the latest user aircraft at monotonic time nowNs and return the publish interval in milliseconds */
+  int update(const atools::fs::sc::SimConnectUserAircraft& aircraft, qint64 nowNs);
+
+  /* Forget the phase and the turn rate history */
+  void reset();
+
+  bool isEnabled() const
+  {
+    return enabled;
+  }
+
+  Phase getPhase() const
+  {
+    return phase;
+  }
+
+  int getIntervalMs() const
+  {
+    return intervalMs[phase];
+  }
+
+  static QString phaseName(Phase phase);
+
+private:
+  Phase classify(const atools::fs::sc::SimConnectUserAircraft& aircraft, qint64 nowNs);
+
+  bool enabled = false;
+  int intervalMs[NUM_PHASES];
+  int holdMs = 3000;
+
+  Phase phase = NORMAL, candidate = NORMAL;
+  qint64 candidateSinceNs = 0;
+
+  /* Smoothed turn rate from the track changes */
+  float lastTrackDeg = 0.f, turnRateDegPerSec = 0.f;
+  qint64 lastTrackNs = 0;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_PUBLISHSCHEDULER_H
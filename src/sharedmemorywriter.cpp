@@ -18,10 +18,16 @@
 #include "sharedmemorywriter.h"
 
 #include "fgconnect.h"
+#include "inprocesshandler.h"
+#include "propertysubscriber.h"
+#include "tracezone.h"
 #include "fs/sc/xpconnecthandler.h"
+#include "fs/sc/simconnectuseraircraft.h"
 
 #include <QBuffer>
+#include <QElapsedTimer>
 #include <QDataStream>
+#include <QDateTime>
 
 SharedMemoryWriter::SharedMemoryWriter()
 {
@@ -35,32 +41,104 @@ SharedMemoryWriter::~SharedMemoryWriter()
   delete fgConnect;
 }
 
-void SharedMemoryWriter::fetchAndWriteData(QString simData, bool fetchAi)
+void SharedMemoryWriter::fetchAndWriteData(const QByteArray& simData, bool fetchAi, qint64 receiveTimeNs)
 {
+  LFGC_TRACE_BEGIN(lockZone, "wait dataMutex");
+  QMutexLocker locker(&dataMutex);
+  LFGC_TRACE_END(lockZone);
+
+  LFGC_TRACE_ZONE("tokenize");
+  bool ok = dualRateInput ?
+            fgConnect->fillKinematics(simData, data, fetchAi) :
+            fgConnect->fillSimConnectData(simData, data, fetchAi);
+  dataUpdated(ok, receiveTimeNs);
+}
+
+void SharedMemoryWriter::writeProperties(const QVector<lfgc::PropertyChange>& changes, bool fetchAi,
+                                         qint64 receiveTimeNs)
+{
+  QMutexLocker locker(&dataMutex);
+  dataUpdated(fgConnect->applyProperties(changes, data, fetchAi), receiveTimeNs);
+}
+
+void SharedMemoryWriter::dataUpdated(bool ok, qint64 receiveTimeNs)
+{
+  if(!ok) {
+    data = atools::fs::sc::EMPTY_SIMCONNECT_DATA;
+  }
+  dataChanged = true;
+  userDataChanged = true;
+  lastReceiveTimeNs = receiveTimeNs;
+
+  if(publishScheduler.isEnabled())
   {
-    QMutexLocker locker(&dataMutex);
-    if(!fgConnect->fillSimConnectData(simData, onlineStatus, data, fetchAi)) {
-      data = atools::fs::sc::EMPTY_SIMCONNECT_DATA;
-    }
+    int intervalMs = publishScheduler.update(data.getUserAircraftConst(), receiveTimeNs);
+
+    // Cut a long heartbeat wait short if the phase needs a faster rate
+    if(intervalMs < adaptiveIntervalMs.fetchAndStoreRelaxed(intervalMs))
+      waitCondition.wakeAll();
   }
+  // Thread wakes up by itself if a publish interval is set
+  else if(publishIntervalMs.load() == 0)
+    waitCondition.wakeAll();
+}
+
+void SharedMemoryWriter::setPublishIntervalMs(int value)
+{
+  publishIntervalMs.store(value);
 
+  // Leave a pending wait which might be unlimited or too long for the new interval
+  QMutexLocker locker(&dataMutex);
   waitCondition.wakeAll();
 }
 
-void SharedMemoryWriter::writeOnlinePresenceData(QString onlineStatus)
+void SharedMemoryWriter::setPublishScheduler(const lfgc::PublishScheduler& scheduler)
 {
-    this->onlineStatus = onlineStatus;
+  QMutexLocker locker(&dataMutex);
+  publishScheduler = scheduler;
+  adaptiveIntervalMs.store(publishScheduler.isEnabled() ? publishScheduler.getIntervalMs() : 0);
+  waitCondition.wakeAll();
+}
+
+void SharedMemoryWriter::setInputFilters(const lfgc::InputFilters& filters)
+{
+  QMutexLocker locker(&dataMutex);
+  fgConnect->setInputFilters(filters);
+}
+
+void SharedMemoryWriter::setTrafficPredictionLimit(float seconds)
+{
+  QMutexLocker locker(&dataMutex);
+  fgConnect->setPredictionLimitSeconds(seconds);
+}
+
+void SharedMemoryWriter::writeMetadata(const QByteArray& metaData, bool fetchAi)
+{
+  // Nothing is published here - the next high rate datagram picks the values up
+  QMutexLocker locker(&dataMutex);
+  fgConnect->updateMetadata(metaData, fetchAi);
+}
+
+void SharedMemoryWriter::writeOnlinePresenceData(const lfgc::TrafficStore& onlineTraffic)
+{
+  qint64 receiveTimeNs = lfgc::monotonicNowNs();
+  QMutexLocker locker(&dataMutex);
+  fgConnect->setOnlineTraffic(onlineTraffic, receiveTimeNs);
 }
 
 void SharedMemoryWriter::terminateThread()
 {
-  terminate = true;
-  waitCondition.wakeAll();
+  {
+    QMutexLocker locker(&dataMutex);
+    terminate = true;
+    waitCondition.wakeAll();
+  }
   wait();
 }
 
 void SharedMemoryWriter::writeData(const QByteArray& simDataBytes, bool terminated)
 {
+  LFGC_TRACE_ZONE("write shared memory");
   QByteArray allBytes;
   QDataStream stream(&allBytes, QIODevice::WriteOnly);
   stream << static_cast<quint32>(static_cast<quint32>(simDataBytes.size()) + sizeof(quint32) * 2);
@@ -72,8 +150,11 @@ void SharedMemoryWriter::writeData(const QByteArray& simDataBytes, bool terminat
                << "Data too large" << allBytes.size() << ">" << atools::fs::sc::SHARED_MEMORY_SIZE;
   else
   {
+    LFGC_TRACE_BEGIN(lockZone, "wait shared memory lock");
     if(sharedMemory.lock())
     {
+      LFGC_TRACE_END(lockZone);
+      LFGC_TRACE_ZONE("memcpy");
       memcpy(sharedMemory.data(), allBytes.constData(), static_cast<size_t>(allBytes.size()));
       // qDebug() << "Lock ok size" << allBytes.size();
       sharedMemory.unlock();
@@ -84,53 +165,204 @@ void SharedMemoryWriter::writeData(const QByteArray& simDataBytes, bool terminat
   }
 }
 
+void SharedMemoryWriter::decodeTraffic()
+{
+  LFGC_TRACE_ZONE("decode traffic");
+  {
+    LFGC_TRACE_BEGIN(lockZone, "wait dataMutex");
+    QMutexLocker locker(&dataMutex);
+    LFGC_TRACE_END(lockZone);
+    if(!fgConnect->takeAiObjects(aiObjects))
+      return;
+  }
+
+  // Main thread can fill new user aircraft data meanwhile
+  trafficDecoder->decode(aiObjects, decodedTraffic);
+
+  LFGC_TRACE_BEGIN(lockZone, "wait dataMutex");
+  QMutexLocker locker(&dataMutex);
+  LFGC_TRACE_END(lockZone);
+  fgConnect->setAiTraffic(decodedTraffic);
+
+  // Without a publish interval the traffic goes out with the next received datagram. Forcing a frame
+  // here would publish twice per datagram.
+  if(effectiveIntervalMs() > 0)
+    dataChanged = true;
+}
+
 void SharedMemoryWriter::run()
 {
   qDebug() << "LittleFgconnect" << Q_FUNC_INFO;
 
-  sharedMemory.setKey(atools::fs::sc::SHARED_MEMORY_KEY);
-  if(!sharedMemory.create(atools::fs::sc::SHARED_MEMORY_SIZE, QSharedMemory::ReadWrite))
+  if(sharedMemoryOutput)
   {
-    qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot create" << sharedMemory.errorString();
+    sharedMemory.setKey(atools::fs::sc::SHARED_MEMORY_KEY);
+    if(!sharedMemory.create(atools::fs::sc::SHARED_MEMORY_SIZE, QSharedMemory::ReadWrite))
+    {
+      qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot create" << sharedMemory.errorString();
 
-    if(!sharedMemory.attach(QSharedMemory::ReadWrite))
-      qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot attach" << sharedMemory.errorString();
+      if(!sharedMemory.attach(QSharedMemory::ReadWrite))
+        qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot attach" << sharedMemory.errorString();
+      else
+        qInfo() << "LittleFgConnect" << Q_FUNC_INFO << "Attached to" << sharedMemory.key()
+                << "native" << sharedMemory.nativeKey();
+    }
     else
-      qInfo() << "LittleFgConnect" << Q_FUNC_INFO << "Attached to" << sharedMemory.key()
+      qInfo() << "LittleFgConnect" << Q_FUNC_INFO << "Created" << sharedMemory.key()
               << "native" << sharedMemory.nativeKey();
   }
   else
-    qInfo() << "LittleFgConnect" << Q_FUNC_INFO << "Created" << sharedMemory.key()
-            << "native" << sharedMemory.nativeKey();
+    qInfo() << "LittleFgConnect" << Q_FUNC_INFO << "Shared memory output disabled";
 
-  waitMutex.lock();
+  // Frames are built for sinks and for the reader thread of this process
+  bool buildFrames = !outputPipeline.isEmpty() || inProcessHandler != nullptr;
+
+  // The reader of this process passes the traffic on to its clients
+  bool frameTraffic = inProcessHandler != nullptr || outputPipeline.needsTraffic();
+
+  if(snapshotRegion)
+  {
+    snapshotWriter = new lfgc::SnapshotWriter;
+    if(!snapshotWriter->create())
+    {
+      delete snapshotWriter;
+      snapshotWriter = nullptr;
+    }
+  }
+
+  trafficDecoder = new lfgc::TrafficDecoder(decoderThreads);
+
+  if(!outputPipeline.isEmpty())
+    outputPipeline.start();
+
+  QElapsedTimer publishTimer;
+  publishTimer.start();
+
+  // Scheduler interval last passed to the reader thread of this process
+  int readerIntervalMs = 0;
 
   while(true)
   {
-    waitCondition.wait(&waitMutex);
+    {
+      // Check and wait under the same lock which is also held when waking up
+      QMutexLocker locker(&dataMutex);
+      int intervalMs = effectiveIntervalMs();
+      if(intervalMs > 0)
+      {
+        // Decoupled output rate - wake up by timeout and publish the latest data if anything arrived
+        qint64 remaining = intervalMs - publishTimer.elapsed();
+        if(remaining > 0 && !terminate)
+          waitCondition.wait(&dataMutex, static_cast<unsigned long>(remaining));
+
+        if(!terminate)
+        {
+          // Interval might have been shortened while waiting
+          if(publishTimer.elapsed() < effectiveIntervalMs())
+            continue;
+          publishTimer.restart();
+
+          if(!dataChanged)
+            continue;
+        }
+      }
+      // Do not wait if data arrived while this thread was busy
+      else if(!dataChanged && !terminate)
+        waitCondition.wait(&dataMutex);
+    }
 
     QByteArray simDataBytes;
     QBuffer buffer(&simDataBytes);
     buffer.open(QIODevice::WriteOnly);
 
+    lfgc::OutputFramePtr outputFrame;
     {
+      LFGC_TRACE_BEGIN(lockZone, "wait dataMutex");
       QMutexLocker locker(&dataMutex);
-      data.write(&buffer);
+      LFGC_TRACE_END(lockZone);
+
+      LFGC_TRACE_ZONE("serialize");
+      bool userChanged = userDataChanged;
+      dataChanged = userDataChanged = false;
+
+      // Build the traffic objects from the store only once per written frame
+      fgConnect->materializeTraffic(data, lfgc::monotonicNowNs());
+      if(sharedMemoryOutput)
+        data.write(&buffer);
+
+      if(snapshotWriter != nullptr)
+        snapshotWriter->write(data, fgConnect->getTrafficStatus(), lastReceiveTimeNs);
+
+      if(buildFrames)
+      {
+        // Shares the data - materializeTraffic() continues with a spare traffic vector while this one is held
+        lfgc::OutputFrame *frame = new lfgc::OutputFrame;
+        frame->sequence = ++frameSequence;
+        frame->timestampMs = QDateTime::currentMSecsSinceEpoch();
+        frame->receiveTimeNs = lastReceiveTimeNs;
+        frame->userChanged = userChanged;
+        frame->data = data;
+        if(!frameTraffic)
+          xpc::XpConnect::dropTraffic(frame->data);
+        outputFrame.reset(frame);
+      }
     }
 
     buffer.close();
 
     if(terminate)
     {
-      writeData(simDataBytes, terminate);
+      if(sharedMemoryOutput)
+        writeData(simDataBytes, terminate);
       break;
     }
-    else
+    else if(sharedMemoryOutput)
       writeData(simDataBytes, false);
+
+    // Reader thread of this process takes the frame without deserializing
+    if(inProcessHandler != nullptr)
+    {
+      inProcessHandler->publish(outputFrame);
+
+      // Reader follows the flight phase too
+      int intervalMs = adaptiveIntervalMs.load();
+      if(intervalMs != readerIntervalMs)
+      {
+        readerIntervalMs = intervalMs;
+        inProcessHandler->setAdaptiveIntervalMs(intervalMs);
+      }
+    }
+
+    // Other sinks only after the shared memory is written - only queued here
+    if(outputFrame && !outputPipeline.isEmpty())
+      outputPipeline.publish(outputFrame);
+
+    // User aircraft is already published - decoded traffic goes into the next frame without forcing one
+    decodeTraffic();
   }
-  waitMutex.unlock();
   qDebug() << "LittleFgConnect" << Q_FUNC_INFO << "terminate" << terminate;
 
+  // Reader falls back to the shared memory which is detached below
+  if(inProcessHandler != nullptr)
+  {
+    inProcessHandler->publish(lfgc::OutputFramePtr());
+    inProcessHandler->setAdaptiveIntervalMs(0);
+  }
+
+  // Sinks write all frames still queued
+  if(outputPipeline.isRunning())
+    outputPipeline.terminateThread();
+
+  delete trafficDecoder;
+  trafficDecoder = nullptr;
+
+  if(snapshotWriter != nullptr)
+    snapshotWriter->writeTerminated();
+  delete snapshotWriter;
+  snapshotWriter = nullptr;
+
+  if(!sharedMemoryOutput)
+    return;
+
   if(!sharedMemory.detach())
     qWarning() << "Cannot detach" << sharedMemory.errorString() << "from" << sharedMemory.key()
                << "native" << sharedMemory.nativeKey();
@@ -20,12 +20,21 @@
 
 #include "fs/sc/simconnectdata.h"
 #include "fgconnect.h"
+#include "outputsink.h"
+#include "publishscheduler.h"
+#include "snapshotregion.h"
+#include "trafficdecoder.h"
 
+#include <QAtomicInt>
 #include <QMutex>
 #include <QSharedMemory>
 #include <QThread>
 #include <QWaitCondition>
 
+namespace lfgc {
+class InProcessHandler;
+}
+
 /*
  * Use a background thread to write the data to the shared memory to avoid simulator stutters due to
  * locking
@@ -38,10 +47,81 @@ public:
   virtual ~SharedMemoryWriter();
 
   /* Fetch data from the datarefs (main thread context) and pass it over to the
-   * shared memory writer (writing in this thread's context) */
-  void fetchAndWriteData(QString simData, bool fetchAi);
+   * shared memory writer (writing in this thread's context).
+   * receiveTimeNs is the lfgc::monotonicNowNs() time when the datagram was received. */
+  void fetchAndWriteData(const QByteArray& simData, bool fetchAi, qint64 receiveTimeNs);
+
+  /* Dual rate input. Pass the low rate metadata datagram to the parser. Will be merged with
+   * the next high rate datagrams passed to fetchAndWriteData. */
+  void writeMetadata(const QByteArray& metaData, bool fetchAi);
+
+  /* Property listener input. Pass a batch of changed properties which are merged with all values received
+   * before. Used instead of fetchAndWriteData. */
+  void writeProperties(const QVector<lfgc::PropertyChange>& changes, bool fetchAi, qint64 receiveTimeNs);
+
+  /* Pass the pilots of a completely parsed multiplayer server dump */
+  void writeOnlinePresenceData(const lfgc::TrafficStore& onlineTraffic);
+
+  /* Expect compact high rate datagrams in fetchAndWriteData and metadata in writeMetadata if true.
+   * Otherwise the combined layout is expected in fetchAndWriteData. */
+  void setDualRateInput(bool value)
+  {
+    dualRateInput = value;
+  }
+
+  /* Publish at most once per interval using the latest values instead of on every received datagram.
+   * 0 publishes every datagram. Can be changed while running. */
+  void setPublishIntervalMs(int value);
+
+  /* Choose the publish interval from the flight phase of the user aircraft. Overrides the fixed
+   * publish interval if enabled. The interval is passed on with the frames to the in process handler
+   * and overrides the update rate of the reader thread. Thread safe. */
+  void setPublishScheduler(const lfgc::PublishScheduler& scheduler);
+
+  /* Pass each frame to the connect handler of the reader thread in this process. Call before start(). */
+  void setInProcessHandler(lfgc::InProcessHandler *handler)
+  {
+    inProcessHandler = handler;
+  }
 
-  void writeOnlinePresenceData(QString onlineStatus);
+  /* Serialize into the atools shared memory for other processes. Call before start(). */
+  void setSharedMemoryOutput(bool value)
+  {
+    sharedMemoryOutput = value;
+  }
+
+  /* Also write the fixed layout snapshot region. Call before start(). */
+  void setSnapshotRegion(bool value)
+  {
+    snapshotRegion = value;
+  }
+
+  /* Add a sink which gets all published frames in its own thread after the shared memory was written.
+   * Takes ownership. Call before start(). */
+  void addOutputSink(lfgc::OutputSink *sink, const lfgc::OutputSinkQueue& queue)
+  {
+    outputPipeline.addSink(sink, queue);
+  }
+
+  /* Counters of all output sinks. Call after terminateThread() for final values. */
+  QVector<lfgc::OutputSinkStatistics> getOutputStatistics() const
+  {
+    return outputPipeline.getStatistics();
+  }
+
+  /* Maximum number of threads used to decode large AI object sets. 0 uses the number of cores.
+   * Call before start(). */
+  void setDecoderThreads(int value)
+  {
+    decoderThreads = value;
+  }
+
+  /* Smoothing filters for the user aircraft. Thread safe. */
+  void setInputFilters(const lfgc::InputFilters& filters);
+
+  /* Extrapolate multiplayer traffic between server dumps for at most this number of seconds.
+   * 0 publishes the received positions. Thread safe. */
+  void setTrafficPredictionLimit(float seconds);
 
   /* Send termination signal and wait for terminated */
   void terminateThread();
@@ -50,23 +130,69 @@ private:
   virtual void run() override;
   void writeData(const QByteArray& simDataBytes, bool terminated);
 
-  bool terminate = false;
+  /* Mark data as changed after an update and wake the thread. Called with dataMutex locked. */
+  void dataUpdated(bool ok, qint64 receiveTimeNs);
+
+  bool terminate = false, dualRateInput = false;
+
+  /* Publish interval in milliseconds or 0. Read once per loop in the thread. */
+  QAtomicInt publishIntervalMs = 0;
+
+  /* Interval of the publish scheduler or 0 if disabled. Overrides publishIntervalMs. */
+  QAtomicInt adaptiveIntervalMs = 0;
+
+  int effectiveIntervalMs() const
+  {
+    int adaptive = adaptiveIntervalMs.load();
+    return adaptive > 0 ? adaptive : publishIntervalMs.load();
+  }
+
+  /* Guarded by dataMutex */
+  lfgc::PublishScheduler publishScheduler;
+
+  /* Distributes published frames to the sinks in other threads */
+  lfgc::OutputPipeline outputPipeline;
+  quint64 frameSequence = 0;
+
+  bool snapshotRegion = false, sharedMemoryOutput = true;
+  lfgc::InProcessHandler *inProcessHandler = nullptr;
+
+  /* Created and used in thread context */
+  lfgc::SnapshotWriter *snapshotWriter = nullptr;
+
+  /* Decode pending AI objects outside of the data lock after the user aircraft was published */
+  void decodeTraffic();
+
+  int decoderThreads = 0;
+
+  /* Created and used in thread context */
+  lfgc::TrafficDecoder *trafficDecoder = nullptr;
+
+  /* Buffers reused for decoding */
+  QByteArray aiObjects;
+  lfgc::TrafficStore decodedTraffic;
+
+  /* New data arrived since last publish. Guarded by dataMutex. */
+  bool dataChanged = false;
+
+  /* User aircraft was updated since last publish and not only the traffic. Guarded by dataMutex. */
+  bool userDataChanged = false;
+
+  /* Receive time of the last datagram. Guarded by dataMutex. */
+  qint64 lastReceiveTimeNs = 0;
   atools::fs::sc::SimConnectData data;
 
   /* Synchronize SimConnectData access */
   QMutex dataMutex;
 
-  /* Wakes thread up once new data has arrived */
-  QMutex waitMutex;
+  /* Wakes thread up once new data has arrived. Waited on and signalled with dataMutex locked so that
+   * no wake up is lost between checking for new data and waiting. */
   QWaitCondition waitCondition;
 
   xpc::XpConnect *fgConnect = nullptr;
 
   /* Shared memory for local communication */
   QSharedMemory sharedMemory;
-
-  /* Online status list from multiplayer server */
-  QString onlineStatus;
 };
 
 #endif // SHAREDMEMORYWRITERTHREAD_H
@@ -0,0 +1,127 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_SNAPSHOTLAYOUT_H
+#define LITTLEFGCONNECT_SNAPSHOTLAYOUT_H
+
+/*
+ * Fixed layout of the snapshot shared memory region. Does not depend on Qt and can be copied
+ * into other projects which want to read the region.
+ *
+ * Region layout:
+ *   SnapshotHeader
+ *   SnapshotUserAircraft at userOffset
+ *   trafficCapacity entries of trafficStride bytes at trafficOffset. Each starts with SnapshotTraffic.
+ *
+ * Readers use the offsets and stride from the header so fields can be appended in later versions
+ * without breaking them. The version is only increased for incompatible changes.
+ *
+ * Consistency is ensured by a sequence lock:
+ * The writer increments sequence to an odd number, writes all data and increments it to an even number.
+ * A reader reads sequence, retries if odd, copies the data and reads sequence again. The copy is valid
+ * if both numbers are the same. Readers never block the writer.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace lfgc {
+
+/* Name used for QSharedMemory::setKey() - see QSharedMemory::nativeKey() for the OS name */
+const char SNAPSHOT_SHARED_MEMORY_KEY[] = "LittleFgConnectSnapshot";
+
+const uint32_t SNAPSHOT_MAGIC = 0x534e4746; // "FGNS"
+const uint32_t SNAPSHOT_VERSION = 1;
+
+/* Maximum number of traffic entries */
+const uint32_t SNAPSHOT_TRAFFIC_CAPACITY = 512;
+
+/* Values in SnapshotUserAircraft::flags and SnapshotTraffic::flags */
+enum SnapshotFlags : uint32_t
+{
+  SNAPSHOT_ON_GROUND = 0x0001,
+  SNAPSHOT_PAUSED = 0x0002,
+  SNAPSHOT_REPLAY = 0x0004,
+
+  /* Traffic only. Position is extrapolated from older positions. */
+  SNAPSHOT_PREDICTED = 0x0008
+};
+
+struct SnapshotHeader
+{
+  uint32_t magic, version;
+
+  /* Odd while the writer is changing the data */
+  std::atomic<uint32_t> sequence;
+
+  /* Set to 1 when the writer shuts down */
+  uint32_t terminated;
+
+  uint32_t userOffset, trafficOffset, trafficStride, trafficCapacity;
+
+  /* Number of valid traffic entries */
+  uint32_t numTraffic;
+
+  /* 1 if the user aircraft values are valid */
+  uint32_t userValid;
+
+  /* Incremented for each published frame. Readers can detect missed frames by gaps. */
+  uint64_t frameSequence;
+
+  /* monotonicNowNs() when the last datagram contributing to this frame was received and when this frame was
+   * published. 0 if unknown. */
+  int64_t receiveTimeNs, publishTimeNs;
+};
+
+struct SnapshotUserAircraft
+{
+  double lonX, latY;
+  float altitudeAboveGroundFt, indicatedAltitudeFt, groundAltitudeFt;
+  float indicatedSpeedKts, trueAirspeedKts, groundSpeedKts, machSpeed, verticalSpeedFeetPerMin;
+  float headingTrueDeg, headingMagDeg, trackTrueDeg, trackMagDeg, magVarDeg;
+  float windSpeedKts, windDirectionDegT, ambientTemperatureCelsius, seaLevelPressureMbar;
+  float fuelTotalWeightLbs, fuelFlowPPH, airplaneTotalWeightLbs;
+  uint32_t flags;
+};
+
+struct SnapshotTraffic
+{
+  double lonX, latY;
+  float altitudeFt, headingTrueDeg, groundSpeedKts, verticalSpeedFeetPerMin;
+  uint32_t objectId, flags;
+
+  /* Seconds since the position was received. Appended - zero if written by older versions. */
+  float ageSeconds;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Atomic has to be plain 32 bit");
+static_assert(sizeof(SnapshotHeader) == 64, "Header layout changed");
+
+/* Monotonic system wide clock used for the timestamps in SnapshotHeader. Comparable across processes
+ * on the same machine since steady_clock uses the system monotonic clock on all supported platforms. */
+inline int64_t monotonicNowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_SNAPSHOTLAYOUT_H
@@ -0,0 +1,317 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "snapshotregion.h"
+
+#include "trafficstore.h"
+#include "fs/sc/simconnectdata.h"
+#include "fs/sc/simconnectuseraircraft.h"
+
+#include <QDebug>
+#include <QThread>
+
+#include <algorithm>
+#include <cstring>
+
+namespace lfgc {
+
+/* Number of attempts to get a consistent copy before giving up */
+static const int MAX_READ_RETRIES = 100;
+
+static const int SNAPSHOT_SIZE = static_cast<int>(sizeof(SnapshotHeader) + sizeof(SnapshotUserAircraft) +
+                                                  sizeof(SnapshotTraffic) * SNAPSHOT_TRAFFIC_CAPACITY);
+
+static quint32 snapshotFlags(const atools::fs::sc::SimConnectAircraft& aircraft)
+{
+  quint32 flags = 0;
+  if(aircraft.isOnGround())
+    flags |= SNAPSHOT_ON_GROUND;
+  if(aircraft.isSimPaused())
+    flags |= SNAPSHOT_PAUSED;
+  if(aircraft.isSimReplay())
+    flags |= SNAPSHOT_REPLAY;
+  return flags;
+}
+
+SnapshotWriter::SnapshotWriter()
+{
+  sharedMemory.setKey(QLatin1String(SNAPSHOT_SHARED_MEMORY_KEY));
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+  detach();
+}
+
+bool SnapshotWriter::create()
+{
+  if(!sharedMemory.create(SNAPSHOT_SIZE, QSharedMemory::ReadWrite))
+  {
+    qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot create" << sharedMemory.errorString();
+
+    if(!sharedMemory.attach(QSharedMemory::ReadWrite))
+    {
+      qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot attach" << sharedMemory.errorString();
+      return false;
+    }
+    else if(sharedMemory.size() < SNAPSHOT_SIZE)
+    {
+      qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Region too small" << sharedMemory.size();
+      sharedMemory.detach();
+      return false;
+    }
+  }
+
+  qInfo() << "LittleFgConnect" << Q_FUNC_INFO << "Snapshot" << sharedMemory.key()
+          << "native" << sharedMemory.nativeKey();
+
+  // Readers check magic and version last - write an odd sequence first to keep them out
+  SnapshotHeader *hdr = header();
+  hdr->sequence.store(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  hdr->magic = SNAPSHOT_MAGIC;
+  hdr->version = SNAPSHOT_VERSION;
+  hdr->terminated = 0;
+  hdr->userOffset = sizeof(SnapshotHeader);
+  hdr->trafficOffset = sizeof(SnapshotHeader) + sizeof(SnapshotUserAircraft);
+  hdr->trafficStride = sizeof(SnapshotTraffic);
+  hdr->trafficCapacity = SNAPSHOT_TRAFFIC_CAPACITY;
+  hdr->numTraffic = 0;
+  hdr->userValid = 0;
+  hdr->frameSequence = 0;
+  hdr->receiveTimeNs = hdr->publishTimeNs = 0;
+  frameSequence = 0;
+
+  hdr->sequence.store(2, std::memory_order_release);
+  return true;
+}
+
+void SnapshotWriter::detach()
+{
+  if(sharedMemory.isAttached() && !sharedMemory.detach())
+    qWarning() << "Cannot detach" << sharedMemory.errorString() << "from" << sharedMemory.key();
+}
+
+SnapshotHeader *SnapshotWriter::header()
+{
+  return static_cast<SnapshotHeader *>(sharedMemory.data());
+}
+
+void SnapshotWriter::beginWrite()
+{
+  SnapshotHeader *hdr = header();
+  hdr->sequence.store(hdr->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void SnapshotWriter::endWrite()
+{
+  SnapshotHeader *hdr = header();
+  hdr->sequence.store(hdr->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void SnapshotWriter::write(const atools::fs::sc::SimConnectData& data,
+                           const QVector<lfgc::TrafficStatus>& trafficStatus, qint64 receiveTimeNs)
+{
+  if(!sharedMemory.isAttached())
+    return;
+
+  const atools::fs::sc::SimConnectUserAircraft& ac = data.getUserAircraftConst();
+  const QVector<atools::fs::sc::SimConnectAircraft>& aiAircraft = data.getAiAircraftConst();
+
+  char *base = static_cast<char *>(sharedMemory.data());
+  SnapshotHeader *hdr = header();
+
+  beginWrite();
+
+  SnapshotUserAircraft *user = reinterpret_cast<SnapshotUserAircraft *>(base + hdr->userOffset);
+  hdr->userValid = ac.getPosition().isValid();
+  user->lonX = static_cast<double>(ac.getPosition().getLonX());
+  user->latY = static_cast<double>(ac.getPosition().getLatY());
+  user->altitudeAboveGroundFt = ac.getAltitudeAboveGroundFt();
+  user->indicatedAltitudeFt = ac.getIndicatedAltitudeFt();
+  user->groundAltitudeFt = ac.getGroundAltitudeFt();
+  user->indicatedSpeedKts = ac.getIndicatedSpeedKts();
+  user->trueAirspeedKts = ac.getTrueAirspeedKts();
+  user->groundSpeedKts = ac.getGroundSpeedKts();
+  user->machSpeed = ac.getMachSpeed();
+  user->verticalSpeedFeetPerMin = ac.getVerticalSpeedFeetPerMin();
+  user->headingTrueDeg = ac.getHeadingDegTrue();
+  user->headingMagDeg = ac.getHeadingDegMag();
+  user->trackTrueDeg = ac.getTrackDegTrue();
+  user->trackMagDeg = ac.getTrackDegMag();
+  user->magVarDeg = ac.getMagVarDeg();
+  user->windSpeedKts = ac.getWindSpeedKts();
+  user->windDirectionDegT = ac.getWindDirectionDegT();
+  user->ambientTemperatureCelsius = ac.getAmbientTemperatureCelsius();
+  user->seaLevelPressureMbar = ac.getSeaLevelPressureMbar();
+  user->fuelTotalWeightLbs = ac.getFuelTotalWeightLbs();
+  user->fuelFlowPPH = ac.getFuelFlowPPH();
+  user->airplaneTotalWeightLbs = ac.getAirplaneTotalWeightLbs();
+  user->flags = snapshotFlags(ac);
+
+  quint32 numTraffic = std::min(static_cast<quint32>(aiAircraft.size()), hdr->trafficCapacity);
+  char *trafficBase = base + hdr->trafficOffset;
+  for(quint32 i = 0; i < numTraffic; i++)
+  {
+    const atools::fs::sc::SimConnectAircraft& aircraft = aiAircraft.at(static_cast<int>(i));
+    SnapshotTraffic *traffic = reinterpret_cast<SnapshotTraffic *>(trafficBase + hdr->trafficStride * i);
+    traffic->lonX = static_cast<double>(aircraft.getPosition().getLonX());
+    traffic->latY = static_cast<double>(aircraft.getPosition().getLatY());
+    traffic->altitudeFt = aircraft.getPosition().getAltitude();
+    traffic->headingTrueDeg = aircraft.getHeadingDegTrue();
+    traffic->groundSpeedKts = aircraft.getGroundSpeedKts();
+    traffic->verticalSpeedFeetPerMin = aircraft.getVerticalSpeedFeetPerMin();
+    traffic->objectId = aircraft.getObjectId();
+    traffic->flags = snapshotFlags(aircraft);
+    traffic->ageSeconds = 0.f;
+    traffic->reserved = 0;
+
+    if(i < static_cast<quint32>(trafficStatus.size()))
+    {
+      const TrafficStatus& status = trafficStatus.at(static_cast<int>(i));
+      traffic->ageSeconds = status.ageSeconds;
+      if(status.predicted)
+        traffic->flags |= SNAPSHOT_PREDICTED;
+    }
+  }
+  hdr->numTraffic = numTraffic;
+
+  hdr->frameSequence = ++frameSequence;
+  hdr->receiveTimeNs = receiveTimeNs;
+  hdr->publishTimeNs = monotonicNowNs();
+
+  endWrite();
+}
+
+void SnapshotWriter::writeTerminated()
+{
+  if(!sharedMemory.isAttached())
+    return;
+
+  beginWrite();
+  header()->terminated = 1;
+  header()->userValid = 0;
+  header()->numTraffic = 0;
+  endWrite();
+}
+
+// ======================================================================================
+SnapshotReader::SnapshotReader()
+{
+  sharedMemory.setKey(QLatin1String(SNAPSHOT_SHARED_MEMORY_KEY));
+}
+
+SnapshotReader::~SnapshotReader()
+{
+  detach();
+}
+
+bool SnapshotReader::attach()
+{
+  if(sharedMemory.isAttached())
+    return true;
+
+  if(!sharedMemory.attach(QSharedMemory::ReadOnly))
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot attach" << sharedMemory.errorString();
+    return false;
+  }
+  return true;
+}
+
+void SnapshotReader::detach()
+{
+  if(sharedMemory.isAttached())
+    sharedMemory.detach();
+}
+
+bool SnapshotReader::read(SnapshotUserAircraft& user, QVector<SnapshotTraffic>& traffic, bool& userValid)
+{
+  if(!sharedMemory.isAttached())
+    return false;
+
+  // Header values come from another process - check everything against the mapped size
+  quint64 regionSize = static_cast<quint64>(sharedMemory.size());
+  if(regionSize < sizeof(SnapshotHeader))
+    return false;
+
+  const char *base = static_cast<const char *>(sharedMemory.constData());
+  const SnapshotHeader *hdr = static_cast<const SnapshotHeader *>(sharedMemory.constData());
+
+  for(int retry = 0; retry < MAX_READ_RETRIES; retry++)
+  {
+    quint32 seq1 = hdr->sequence.load(std::memory_order_acquire);
+    if(seq1 & 1)
+    {
+      // Writer active
+      QThread::yieldCurrentThread();
+      continue;
+    }
+
+    if(hdr->magic != SNAPSHOT_MAGIC || hdr->version != SNAPSHOT_VERSION)
+      return false;
+
+    quint32 numTraffic = std::min(hdr->numTraffic, hdr->trafficCapacity);
+    quint32 stride = hdr->trafficStride, userOffset = hdr->userOffset, trafficOffset = hdr->trafficOffset;
+    if(static_cast<quint64>(userOffset) + sizeof(SnapshotUserAircraft) > regionSize ||
+       (numTraffic > 0 && stride == 0) ||
+       static_cast<quint64>(trafficOffset) + static_cast<quint64>(stride) * numTraffic > regionSize)
+    {
+      qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Invalid layout" << userOffset << trafficOffset
+                 << stride << numTraffic << "for size" << regionSize;
+      return false;
+    }
+
+    std::memcpy(&user, base + userOffset, sizeof(SnapshotUserAircraft));
+    userValid = hdr->userValid != 0;
+
+    // Atomic member cannot be copied - take the plain fields
+    lastHeader.magic = hdr->magic;
+    lastHeader.version = hdr->version;
+    lastHeader.sequence.store(seq1, std::memory_order_relaxed);
+    lastHeader.terminated = hdr->terminated;
+    lastHeader.userOffset = userOffset;
+    lastHeader.trafficOffset = trafficOffset;
+    lastHeader.trafficStride = stride;
+    lastHeader.trafficCapacity = hdr->trafficCapacity;
+    lastHeader.numTraffic = numTraffic;
+    lastHeader.userValid = hdr->userValid;
+    lastHeader.frameSequence = hdr->frameSequence;
+    lastHeader.receiveTimeNs = hdr->receiveTimeNs;
+    lastHeader.publishTimeNs = hdr->publishTimeNs;
+
+    // Entries of older writers can be shorter - missing fields stay zero
+    size_t entrySize = std::min(static_cast<size_t>(stride), sizeof(SnapshotTraffic));
+    traffic.resize(static_cast<int>(numTraffic));
+    for(quint32 i = 0; i < numTraffic; i++)
+    {
+      SnapshotTraffic& entry = traffic[static_cast<int>(i)];
+      std::memset(&entry, 0, sizeof(SnapshotTraffic));
+      std::memcpy(&entry, base + trafficOffset + static_cast<size_t>(stride) * i, entrySize);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(hdr->sequence.load(std::memory_order_relaxed) == seq1)
+      return true;
+  }
+  return false;
+}
+
+} // namespace lfgc
@@ -0,0 +1,104 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_SNAPSHOTREGION_H
+#define LITTLEFGCONNECT_SNAPSHOTREGION_H
+
+#include "snapshotlayout.h"
+
+#include <QSharedMemory>
+#include <QVector>
+
+namespace atools {
+namespace fs {
+namespace sc {
+class SimConnectData;
+}
+}
+}
+
+namespace lfgc {
+
+struct TrafficStatus;
+
+/*
+ * Writes the user aircraft and traffic into the fixed layout snapshot region described in
+ * snapshotlayout.h. Used by the shared memory writer thread in addition to the atools region.
+ */
+class SnapshotWriter
+{
+public:
+  SnapshotWriter();
+  ~SnapshotWriter();
+
+  /* Create or attach to the shared memory region and initialize the header */
+  bool create();
+  void detach();
+
+  /* Copy numeric values of user aircraft and traffic. Does not block readers.
+   * trafficStatus has one entry for each traffic object in data. Missing entries are written as fresh.
+   * receiveTimeNs is the monotonicNowNs() time of the latest datagram in data. */
+  void write(const atools::fs::sc::SimConnectData& data, const QVector<lfgc::TrafficStatus>& trafficStatus,
+             qint64 receiveTimeNs);
+
+  /* Mark region as terminated */
+  void writeTerminated();
+
+private:
+  SnapshotHeader *header();
+
+  /* Increment sequence to an odd number before changing data */
+  void beginWrite();
+
+  /* Increment sequence to an even number after changing data */
+  void endWrite();
+
+  QSharedMemory sharedMemory;
+  quint64 frameSequence = 0;
+};
+
+/*
+ * Reads a consistent copy of the snapshot region. Convenience for Qt based consumers.
+ */
+class SnapshotReader
+{
+public:
+  SnapshotReader();
+  ~SnapshotReader();
+
+  bool attach();
+  void detach();
+
+  /* Copy user aircraft and traffic. Retries while the writer is active.
+   * Returns false if not attached, the layout is not compatible or no consistent copy could be taken. */
+  bool read(SnapshotUserAircraft& user, QVector<SnapshotTraffic>& traffic, bool& userValid);
+
+  /* Header of the last successful read */
+  const SnapshotHeader& getHeader() const
+  {
+    return lastHeader;
+  }
+
+private:
+  QSharedMemory sharedMemory;
+  SnapshotHeader lastHeader;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_SNAPSHOTREGION_H
@@ -0,0 +1,492 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "statusserver.h"
+
+#include "snapshotlayout.h"
+#include "fs/sc/simconnectuseraircraft.h"
+
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace lfgc {
+
+/* Limits for clients which misbehave */
+static const int MAX_CONNECTIONS = 256;
+static const int MAX_REQUEST_SIZE = 8192;
+static const int MAX_WAIT_MS = 60000;
+
+/* Connections which did not send a complete request header in this time are closed */
+static const int REQUEST_TIMEOUT_MS = 10000;
+
+/* Health reports "stale" if no frame was published for this time */
+static const qint64 STALE_NS = 10000000000LL;
+
+static QByteArray errorJson(const QString& message)
+{
+  return QJsonDocument(QJsonObject({{"error", message}})).toJson(QJsonDocument::Compact);
+}
+
+/* Use null instead of the invalid value marker of atools */
+static QJsonValue number(float value)
+{
+  if(value >= atools::fs::sc::SC_INVALID_FLOAT)
+    return QJsonValue();
+  return static_cast<double>(value);
+}
+
+StatusServer::StatusServer(const QHostAddress& addressParam, quint16 portParam)
+  : address(addressParam), port(portParam)
+{
+}
+
+StatusServer::~StatusServer()
+{
+  stop();
+}
+
+bool StatusServer::start()
+{
+  stop();
+
+  startNs = monotonicNowNs();
+  ownerThread = QThread::currentThread();
+  serverThread = new QThread();
+  serverThread->setObjectName("StatusServer");
+  moveToThread(serverThread);
+  serverThread->start();
+
+  QMetaObject::invokeMethod(this, [this] {
+    listen();
+  }, Qt::BlockingQueuedConnection);
+
+  if(!listening)
+    stop();
+  return listening;
+}
+
+void StatusServer::stop()
+{
+  if(serverThread != nullptr)
+  {
+    // Moves this object back to the owner thread
+    QMetaObject::invokeMethod(this, [this] {
+      close();
+    }, Qt::BlockingQueuedConnection);
+
+    serverThread->quit();
+    serverThread->wait();
+    delete serverThread;
+    serverThread = nullptr;
+  }
+}
+
+void StatusServer::listen()
+{
+  server = new QTcpServer(this);
+  connect(server, &QTcpServer::newConnection, this, &StatusServer::newConnection);
+  listening = server->listen(address, port);
+  if(!listening)
+    qWarning() << Q_FUNC_INFO << "Cannot listen on" << address << port << server->errorString();
+}
+
+void StatusServer::close()
+{
+  for(auto it = requests.begin(); it != requests.end(); ++it)
+  {
+    it.key()->disconnect(this);
+    it.key()->abort();
+    delete it.key();
+  }
+  requests.clear();
+  numWaiting.store(0);
+
+  delete server;
+  server = nullptr;
+  listening = false;
+
+  moveToThread(ownerThread);
+}
+
+void StatusServer::publish(quint64 sequenceParam, const QByteArray& frameJson, const QByteArray& metricsJson)
+{
+  {
+    QMutexLocker locker(&cacheMutex);
+    sequence = sequenceParam;
+    frame = frameJson;
+    metrics = metricsJson;
+    etag = '"' + QByteArray::number(sequenceParam) + '"';
+    lastPublishNs = monotonicNowNs();
+  }
+
+  // Avoid an event per frame if nobody waits
+  if(numWaiting.load() > 0)
+    QMetaObject::invokeMethod(this, [this] {
+      frameUpdated();
+    }, Qt::QueuedConnection);
+}
+
+void StatusServer::newConnection()
+{
+  while(server->hasPendingConnections())
+  {
+    QTcpSocket *socket = server->nextPendingConnection();
+    if(requests.size() >= MAX_CONNECTIONS)
+    {
+      socket->abort();
+      socket->deleteLater();
+      continue;
+    }
+
+    requests.insert(socket, Request());
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket] {
+      readRequest(socket);
+    });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket] {
+      removeRequest(socket);
+    });
+
+    // Do not let half open connections occupy the connection limit
+    QTimer::singleShot(REQUEST_TIMEOUT_MS, socket, [this, socket] {
+      auto it = requests.constFind(socket);
+      if(it != requests.constEnd() && !it->answered && !it->waiting)
+        socket->abort();
+    });
+  }
+}
+
+void StatusServer::removeRequest(QTcpSocket *socket)
+{
+  auto it = requests.find(socket);
+  if(it != requests.end())
+  {
+    if(it->waiting)
+      numWaiting.deref();
+    requests.erase(it);
+  }
+  socket->deleteLater();
+}
+
+void StatusServer::readRequest(QTcpSocket *socket)
+{
+  auto it = requests.find(socket);
+  if(it == requests.end())
+    return;
+
+  Request& request = *it;
+  if(request.answered || request.waiting)
+  {
+    // Nothing more expected from this client
+    socket->readAll();
+    return;
+  }
+
+  request.buffer.append(socket->readAll());
+  int headerEnd = request.buffer.indexOf("\r\n\r\n");
+  if(headerEnd == -1)
+  {
+    if(request.buffer.size() > MAX_REQUEST_SIZE)
+      sendResponse(socket, "431 Request Header Fields Too Large", errorJson("Request too large"));
+    return;
+  }
+
+  // "GET /frame?wait=10000 HTTP/1.1" followed by headers
+  QList<QByteArray> lines = request.buffer.left(headerEnd).split('\n');
+  QList<QByteArray> requestLine = lines.constFirst().trimmed().split(' ');
+  if(requestLine.size() < 2 || requestLine.at(0) != "GET")
+  {
+    sendResponse(socket, "405 Method Not Allowed", errorJson("Only GET is supported"));
+    return;
+  }
+
+  QByteArray target = requestLine.at(1);
+  QByteArray path = target.left(target.indexOf('?'));
+  QByteArray query = target.indexOf('?') == -1 ? QByteArray() : target.mid(target.indexOf('?') + 1);
+
+  QByteArray ifNoneMatch;
+  for(int i = 1; i < lines.size(); i++)
+  {
+    const QByteArray& line = lines.at(i);
+    int colon = line.indexOf(':');
+    if(colon > 0 && line.left(colon).trimmed().toLower() == "if-none-match")
+      ifNoneMatch = line.mid(colon + 1).trimmed();
+  }
+
+  int waitMs = 0;
+  for(const QByteArray& param : query.split('&'))
+  {
+    if(param.startsWith("wait="))
+      waitMs = std::min(std::max(param.mid(5).toInt(), 0), MAX_WAIT_MS);
+  }
+
+  if(path == "/health")
+    sendResponse(socket, "200 OK", healthJson());
+  else if(path == "/frame" || path == "/metrics")
+  {
+    bool isMetrics = path == "/metrics";
+
+    // Count as waiting before reading the ETag - publish() posts no update if nobody waits
+    if(waitMs > 0)
+      numWaiting.ref();
+
+    QByteArray currentEtag;
+    {
+      QMutexLocker locker(&cacheMutex);
+      currentEtag = etag;
+    }
+
+    if(waitMs > 0 && ifNoneMatch == currentEtag)
+    {
+      // Long-poll - client has the current frame or no frame was published yet
+      request.waiting = true;
+      request.metrics = isMetrics;
+      request.etag = ifNoneMatch;
+      request.timer = new QTimer(socket);
+      request.timer->setSingleShot(true);
+      connect(request.timer, &QTimer::timeout, this, [this, socket] {
+        answerWaiting(socket);
+      });
+      request.timer->start(waitMs);
+    }
+    else
+    {
+      if(waitMs > 0)
+        numWaiting.deref();
+      sendCached(socket, isMetrics, ifNoneMatch);
+    }
+  }
+  else
+    sendResponse(socket, "404 Not Found", errorJson("Use /health, /metrics or /frame"));
+}
+
+void StatusServer::frameUpdated()
+{
+  QByteArray currentEtag;
+  {
+    QMutexLocker locker(&cacheMutex);
+    currentEtag = etag;
+  }
+
+  QVector<QTcpSocket *> ready;
+  for(auto it = requests.constBegin(); it != requests.constEnd(); ++it)
+  {
+    if(it->waiting && it->etag != currentEtag)
+      ready.append(it.key());
+  }
+
+  for(QTcpSocket *socket : ready)
+    answerWaiting(socket);
+}
+
+void StatusServer::answerWaiting(QTcpSocket *socket)
+{
+  // Timer can fire after the client disconnected
+  auto it = requests.find(socket);
+  if(it == requests.end() || !it->waiting)
+    return;
+
+  it->waiting = false;
+  numWaiting.deref();
+  it->timer->stop();
+
+  // Not modified if timed out
+  bool isMetrics = it->metrics;
+  QByteArray lastEtag = it->etag;
+  sendCached(socket, isMetrics, lastEtag);
+}
+
+void StatusServer::sendCached(QTcpSocket *socket, bool isMetrics, const QByteArray& ifNoneMatch)
+{
+  QByteArray body, currentEtag;
+  {
+    // Only copies references to the shared data
+    QMutexLocker locker(&cacheMutex);
+    body = isMetrics ? metrics : frame;
+    currentEtag = etag;
+  }
+
+  if(body.isEmpty())
+    sendResponse(socket, "503 Service Unavailable", errorJson("No frame published yet"));
+  else if(ifNoneMatch == currentEtag)
+    sendResponse(socket, "304 Not Modified", QByteArray(), currentEtag);
+  else
+    sendResponse(socket, "200 OK", body, currentEtag);
+}
+
+void StatusServer::sendResponse(QTcpSocket *socket, const QByteArray& status, const QByteArray& body,
+                                const QByteArray& etagParam)
+{
+  QByteArray response("HTTP/1.1 ");
+  response.append(status).append("\r\n");
+  response.append("Content-Type: application/json\r\n");
+  response.append("Cache-Control: no-cache\r\n");
+  response.append("Connection: close\r\n");
+  response.append("Content-Length: ").append(QByteArray::number(body.size())).append("\r\n");
+  if(!etagParam.isEmpty())
+    response.append("ETag: ").append(etagParam).append("\r\n");
+  response.append("\r\n").append(body);
+
+  requests[socket].answered = true;
+  socket->write(response);
+  socket->disconnectFromHost();
+  numRequests.ref();
+}
+
+QByteArray StatusServer::healthJson()
+{
+  quint64 frames;
+  qint64 publishNs;
+  {
+    QMutexLocker locker(&cacheMutex);
+    frames = sequence;
+    publishNs = lastPublishNs;
+  }
+
+  qint64 nowNs = monotonicNowNs();
+  QString status = "receiving";
+  if(frames == 0)
+    status = "waiting";
+  else if(nowNs - publishNs > STALE_NS)
+    status = "stale";
+
+  QJsonObject health;
+  health.insert("status", status);
+  health.insert("frames", static_cast<double>(frames));
+  health.insert("lastFrameAgeMs", frames > 0 ? QJsonValue(static_cast<double>((nowNs - publishNs) / 1000000)) :
+                QJsonValue());
+  health.insert("uptimeSeconds", static_cast<double>((nowNs - startNs) / 1000000000));
+  health.insert("longPolls", numWaiting.load());
+  return QJsonDocument(health).toJson(QJsonDocument::Compact);
+}
+
+// =============================================================================================
+
+StatusSink::StatusSink(StatusServer *serverParam)
+  : server(serverParam)
+{
+}
+
+StatusSink::~StatusSink()
+{
+}
+
+QString StatusSink::getSinkName() const
+{
+  return QString("Status server");
+}
+
+void StatusSink::writeFrame(const OutputFrame& outputFrame)
+{
+  qint64 nowNs = monotonicNowNs();
+
+  // Gaps are frames dropped by the queue of this sink
+  if(lastSequence > 0 && outputFrame.sequence > lastSequence + 1)
+    dropped += outputFrame.sequence - lastSequence - 1;
+  lastSequence = outputFrame.sequence;
+  frames++;
+  if(outputFrame.userChanged)
+    userUpdates++;
+
+  if(outputFrame.receiveTimeNs > 0)
+  {
+    lastLatencyNs = nowNs - outputFrame.receiveTimeNs;
+    maxLatencyNs = std::max(maxLatencyNs, lastLatencyNs);
+    sumLatencyNs += lastLatencyNs;
+  }
+
+  if(rateWindowStartNs == 0)
+    rateWindowStartNs = nowNs;
+  rateWindowFrames++;
+  if(nowNs - rateWindowStartNs >= 1000000000LL)
+  {
+    framesPerSecond = rateWindowFrames * 1.e9 / (nowNs - rateWindowStartNs);
+    rateWindowStartNs = nowNs;
+    rateWindowFrames = 0;
+  }
+
+  const atools::fs::sc::SimConnectUserAircraft& ac = outputFrame.data.getUserAircraftConst();
+  const QVector<atools::fs::sc::SimConnectAircraft>& aiAircraft = outputFrame.data.getAiAircraftConst();
+
+  // Frame =====================================
+  QJsonObject user;
+  user.insert("valid", ac.getPosition().isValid());
+  user.insert("callsign", ac.getAirplaneRegistration());
+  user.insert("model", ac.getAirplaneModel());
+  user.insert("title", ac.getAirplaneTitle());
+  user.insert("lonX", number(ac.getPosition().getLonX()));
+  user.insert("latY", number(ac.getPosition().getLatY()));
+  user.insert("altitudeFt", number(ac.getPosition().getAltitude()));
+  user.insert("altitudeAboveGroundFt", number(ac.getAltitudeAboveGroundFt()));
+  user.insert("indicatedAltitudeFt", number(ac.getIndicatedAltitudeFt()));
+  user.insert("indicatedSpeedKts", number(ac.getIndicatedSpeedKts()));
+  user.insert("trueAirspeedKts", number(ac.getTrueAirspeedKts()));
+  user.insert("groundSpeedKts", number(ac.getGroundSpeedKts()));
+  user.insert("verticalSpeedFeetPerMin", number(ac.getVerticalSpeedFeetPerMin()));
+  user.insert("headingTrueDeg", number(ac.getHeadingDegTrue()));
+  user.insert("trackTrueDeg", number(ac.getTrackDegTrue()));
+  user.insert("onGround", ac.isOnGround());
+  user.insert("paused", ac.isSimPaused());
+
+  QJsonArray traffic;
+  for(const atools::fs::sc::SimConnectAircraft& aircraft : aiAircraft)
+  {
+    QJsonObject object;
+    object.insert("id", static_cast<double>(aircraft.getObjectId()));
+    object.insert("callsign", aircraft.getAirplaneFlightnumber());
+    object.insert("model", aircraft.getAirplaneModel());
+    object.insert("from", aircraft.getFromIdent());
+    object.insert("to", aircraft.getToIdent());
+    object.insert("lonX", number(aircraft.getPosition().getLonX()));
+    object.insert("latY", number(aircraft.getPosition().getLatY()));
+    object.insert("altitudeFt", number(aircraft.getPosition().getAltitude()));
+    object.insert("headingTrueDeg", number(aircraft.getHeadingDegTrue()));
+    object.insert("groundSpeedKts", number(aircraft.getGroundSpeedKts()));
+    traffic.append(object);
+  }
+
+  QJsonObject frame;
+  frame.insert("sequence", static_cast<double>(outputFrame.sequence));
+  frame.insert("timestampMs", static_cast<double>(outputFrame.timestampMs));
+  frame.insert("user", user);
+  frame.insert("traffic", traffic);
+
+  // Metrics =====================================
+  QJsonObject metrics;
+  metrics.insert("sequence", static_cast<double>(outputFrame.sequence));
+  metrics.insert("frames", static_cast<double>(frames));
+  metrics.insert("droppedFrames", static_cast<double>(dropped));
+  metrics.insert("userUpdates", static_cast<double>(userUpdates));
+  metrics.insert("framesPerSecond", framesPerSecond);
+  metrics.insert("receiveToEncodeMs", lastLatencyNs / 1.e6);
+  metrics.insert("receiveToEncodeMaxMs", maxLatencyNs / 1.e6);
+  metrics.insert("receiveToEncodeAvgMs", frames > 0 ? sumLatencyNs / 1.e6 / frames : 0.);
+  metrics.insert("traffic", aiAircraft.size());
+
+  server->publish(outputFrame.sequence, QJsonDocument(frame).toJson(QJsonDocument::Compact),
+                  QJsonDocument(metrics).toJson(QJsonDocument::Compact));
+}
+
+} // namespace lfgc
@@ -0,0 +1,159 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLEFGCONNECT_STATUSSERVER_H
+#define LITTLEFGCONNECT_STATUSSERVER_H
+
+#include "outputsink.h"
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QHostAddress>
+#include <QMutex>
+#include <QObject>
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+namespace lfgc {
+
+/*
+ * Local HTTP endpoint for monitoring. Serves JSON on GET requests:
+ *
+ * /health  state of the input, number of frames and age of the last frame
+ * /metrics frame rate, dropped frames, latency and traffic counts
+ * /frame   user aircraft and traffic of the last published frame
+ *
+ * /metrics and /frame are encoded once per published frame by the StatusSink and served from the cache
+ * with the frame sequence as ETag. A request with a matching "If-None-Match" header gets "304 Not Modified"
+ * or waits for the next frame if "?wait=<milliseconds>" is given (long-poll).
+ *
+ * Runs in its own thread with its own event loop and never blocks the writer or the main thread.
+ * Connections are closed after each response.
+ */
+class StatusServer :
+  public QObject
+{
+  Q_OBJECT
+
+public:
+  StatusServer(const QHostAddress& addressParam, quint16 portParam);
+  virtual ~StatusServer() override;
+
+  /* Start the server thread and listen. Returns false if the port cannot be bound. Called in the main thread. */
+  bool start();
+
+  /* Close all connections and stop the thread. Called in the main thread. */
+  void stop();
+
+  /* Replace the cached encodings. Thread safe. Called in the sink thread. */
+  void publish(quint64 sequence, const QByteArray& frameJson, const QByteArray& metricsJson);
+
+  /* Number of requests answered. Thread safe. */
+  int getNumRequests() const
+  {
+    return numRequests.load();
+  }
+
+private:
+  /* Pending request in server thread context */
+  struct Request
+  {
+    QByteArray buffer;
+    bool answered = false;
+
+    /* Long-poll: answer when the ETag differs from this one or after the timer */
+    bool waiting = false;
+    bool metrics = false;
+    QByteArray etag;
+    QTimer *timer = nullptr;
+  };
+
+  /* Called in server thread context */
+  void listen();
+  void close();
+  void frameUpdated();
+
+  void newConnection();
+  void readRequest(QTcpSocket *socket);
+  void answerWaiting(QTcpSocket *socket);
+  void sendCached(QTcpSocket *socket, bool metrics, const QByteArray& ifNoneMatch);
+  void sendResponse(QTcpSocket *socket, const QByteArray& status, const QByteArray& body,
+                    const QByteArray& etag = QByteArray());
+  void removeRequest(QTcpSocket *socket);
+  QByteArray healthJson();
+
+  QHostAddress address;
+  quint16 port;
+  QThread *serverThread = nullptr, *ownerThread = nullptr;
+
+  /* Used in server thread context */
+  QTcpServer *server = nullptr;
+  QHash<QTcpSocket *, Request> requests;
+  bool listening = false;
+
+  /* Cache guarded by cacheMutex */
+  QMutex cacheMutex;
+  quint64 sequence = 0;
+  QByteArray frame, metrics, etag;
+  qint64 lastPublishNs = 0, startNs = 0;
+
+  /* Number of long-polls to avoid posting events while nobody waits */
+  QAtomicInt numWaiting = 0, numRequests = 0;
+};
+
+/*
+ * Output sink encoding each published frame into the JSON documents of a StatusServer.
+ * Runs in its own thread. Use with the "latest" queue policy since only the newest frame is served.
+ */
+class StatusSink :
+  public OutputSink
+{
+public:
+  /* Server is not owned and has to outlive the sink */
+  explicit StatusSink(StatusServer *serverParam);
+  virtual ~StatusSink() override;
+
+  virtual QString getSinkName() const override;
+  virtual void writeFrame(const OutputFrame& frame) override;
+
+  /* Frame document contains the traffic */
+  virtual bool needsTraffic() const override
+  {
+    return true;
+  }
+
+private:
+  StatusServer *server;
+
+  quint64 frames = 0, dropped = 0, userUpdates = 0, lastSequence = 0;
+
+  /* Receive to encode latency */
+  qint64 lastLatencyNs = 0, maxLatencyNs = 0, sumLatencyNs = 0;
+
+  /* Frame rate over the last full second */
+  qint64 rateWindowStartNs = 0;
+  quint64 rateWindowFrames = 0;
+  double framesPerSecond = 0.;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_STATUSSERVER_H
@@ -0,0 +1,108 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "stringpool.h"
+
+#include <QDebug>
+#include <QHash>
+
+#include <cstring>
+
+namespace lfgc {
+
+/* Has to be a power of two */
+static const int INITIAL_SLOTS = 256;
+
+StringPool::StringPool(int maxEntriesParam)
+  : maxEntries(maxEntriesParam)
+{
+  entries.resize(INITIAL_SLOTS);
+}
+
+const QString& StringPool::intern(const char *bytes, int length)
+{
+  if(length <= 0)
+    return emptyString;
+
+  uint hash = qHashBits(bytes, static_cast<size_t>(length));
+  int mask = entries.size() - 1;
+
+  // Find with linear probing - load factor is kept below 0.5 so there is always a free slot
+  for(int i = static_cast<int>(hash) & mask;; i = (i + 1) & mask)
+  {
+    const Entry& entry = entries.at(i);
+    if(!entry.used)
+      break;
+
+    if(entry.hash == hash && entry.key.size() == length && std::memcmp(entry.key.constData(), bytes, length) == 0)
+      return entry.value;
+  }
+
+  // Not found - make room if needed
+  if(numEntries >= maxEntries)
+  {
+    qDebug() << Q_FUNC_INFO << "String pool full with" << numEntries << "entries. Clearing.";
+    clear();
+  }
+  else if((numEntries + 1) * 2 > entries.size())
+    rehash(entries.size() * 2);
+
+  return insert(hash, bytes, length).value;
+}
+
+void StringPool::clear()
+{
+  entries.fill(Entry());
+  numEntries = 0;
+}
+
+StringPool::Entry& StringPool::insert(uint hash, const char *bytes, int length)
+{
+  int mask = entries.size() - 1;
+  int i = static_cast<int>(hash) & mask;
+  while(entries.at(i).used)
+    i = (i + 1) & mask;
+
+  Entry& entry = entries[i];
+  entry.hash = hash;
+  entry.key = QByteArray(bytes, length);
+  entry.value = QString::fromUtf8(bytes, length);
+  entry.used = true;
+  numEntries++;
+  return entry;
+}
+
+void StringPool::rehash(int newNumSlots)
+{
+  QVector<Entry> oldEntries(newNumSlots);
+  oldEntries.swap(entries);
+
+  int mask = entries.size() - 1;
+  for(Entry& entry : oldEntries)
+  {
+    if(entry.used)
+    {
+      int i = static_cast<int>(entry.hash) & mask;
+      while(entries.at(i).used)
+        i = (i + 1) & mask;
+      entries[i] = std::move(entry);
+    }
+  }
+}
+
+} // namespace lfgc
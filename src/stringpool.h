@@ -0,0 +1,80 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_STRINGPOOL_H
+#define LITTLEFGCONNECT_STRINGPOOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+namespace lfgc {
+
+/*
+ * Intern pool for identifiers like aircraft titles, models, callsigns and airport idents.
+ *
+ * Lookup is done by hashing the raw UTF-8 bytes from the datagram. A hit returns the implicitly shared
+ * QString which was created on the first occurrence without allocating or converting again.
+ *
+ * Uses open addressing with linear probing. The pool is emptied if it exceeds the maximum number
+ * of entries to keep memory bounded with changing multiplayer traffic.
+ *
+ * Not thread safe.
+ */
+class StringPool
+{
+public:
+  explicit StringPool(int maxEntriesParam = 16384);
+
+  /* Returns the shared string for the given UTF-8 bytes. Creates a new one if not found. */
+  const QString& intern(const char *bytes, int length);
+
+  const QString& intern(const QByteArray& bytes)
+  {
+    return intern(bytes.constData(), bytes.size());
+  }
+
+  /* Remove all strings */
+  void clear();
+
+  int size() const
+  {
+    return numEntries;
+  }
+
+private:
+  struct Entry
+  {
+    uint hash = 0;
+    QByteArray key;
+    QString value;
+    bool used = false;
+  };
+
+  /* Insert without checking for existing keys or size */
+  Entry& insert(uint hash, const char *bytes, int length);
+  void rehash(int newNumSlots);
+
+  QVector<Entry> entries;
+  int numEntries = 0, maxEntries;
+  QString emptyString;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_STRINGPOOL_H
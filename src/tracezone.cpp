@@ -0,0 +1,192 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "tracezone.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace lfgc {
+
+/* Events per thread. Power of two. 24 bytes each. */
+static const quint64 TRACE_BUFFER_SIZE = 1 << 17;
+
+struct TraceEvent
+{
+  const char *name;
+  qint64 beginNs, endNs;
+};
+
+/* Written only by the owning thread */
+struct TraceBuffer
+{
+  QByteArray threadName;
+  int threadId = 0;
+
+  /* Number of events ever recorded. Published after the event was written. */
+  std::atomic<quint64> head;
+  std::vector<TraceEvent> events;
+};
+
+/* Buffers are kept after their thread finished so that the events can still be written */
+static QMutex traceBuffersMutex;
+static std::vector<std::unique_ptr<TraceBuffer> > traceBuffers;
+
+static thread_local TraceBuffer *threadTraceBuffer = nullptr;
+
+static TraceBuffer *registerThread()
+{
+  TraceBuffer *buffer = new TraceBuffer;
+  buffer->head.store(0, std::memory_order_relaxed);
+  buffer->events.resize(TRACE_BUFFER_SIZE);
+
+  QThread *thread = QThread::currentThread();
+  if(QCoreApplication::instance() != nullptr && thread == QCoreApplication::instance()->thread())
+    buffer->threadName = "main";
+  else if(thread != nullptr && !thread->objectName().isEmpty())
+    buffer->threadName = thread->objectName().toUtf8();
+  else if(thread != nullptr)
+    buffer->threadName = thread->metaObject()->className();
+
+  QMutexLocker locker(&traceBuffersMutex);
+  buffer->threadId = static_cast<int>(traceBuffers.size()) + 1;
+  traceBuffers.emplace_back(buffer);
+  return buffer;
+}
+
+void Trace::record(const char *name, qint64 beginNs, qint64 endNs)
+{
+  TraceBuffer *buffer = threadTraceBuffer;
+  if(buffer == nullptr)
+    buffer = threadTraceBuffer = registerThread();
+
+  quint64 head = buffer->head.load(std::memory_order_relaxed);
+  TraceEvent& event = buffer->events[head & (TRACE_BUFFER_SIZE - 1)];
+  event.name = name;
+  event.beginNs = beginNs;
+  event.endNs = endNs;
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+static void appendEscaped(QByteArray& json, const QByteArray& str)
+{
+  for(char c : str)
+  {
+    if(c == '"' || c == '\\')
+      json.append('\\');
+    if(static_cast<unsigned char>(c) >= 0x20)
+      json.append(c);
+  }
+}
+
+bool Trace::writeChromeTrace(const QString& filename)
+{
+  QMutexLocker locker(&traceBuffersMutex);
+
+  // Copy events first - the owning threads may continue to record
+  struct ThreadEvents
+  {
+    const TraceBuffer *buffer;
+    std::vector<TraceEvent> events;
+  };
+  std::vector<ThreadEvents> threads;
+  qint64 startNs = std::numeric_limits<qint64>::max();
+
+  for(const std::unique_ptr<TraceBuffer>& buffer : traceBuffers)
+  {
+    quint64 head = buffer->head.load(std::memory_order_acquire);
+    quint64 first = head > TRACE_BUFFER_SIZE ? head - TRACE_BUFFER_SIZE : 0;
+
+    ThreadEvents thread;
+    thread.buffer = buffer.get();
+    thread.events.reserve(static_cast<size_t>(head - first));
+    for(quint64 i = first; i < head; i++)
+      thread.events.push_back(buffer->events[i & (TRACE_BUFFER_SIZE - 1)]);
+
+    // Drop events which were overwritten while copying. The slot at headAfter may be in the middle of
+    // being written since head is only advanced after the event is complete.
+    quint64 headAfter = buffer->head.load(std::memory_order_acquire);
+    if(headAfter >= first + TRACE_BUFFER_SIZE)
+    {
+      size_t overwritten = std::min(static_cast<size_t>(headAfter - first - TRACE_BUFFER_SIZE + 1),
+                                    thread.events.size());
+      thread.events.erase(thread.events.begin(), thread.events.begin() + static_cast<std::ptrdiff_t>(overwritten));
+    }
+
+    for(const TraceEvent& event : thread.events)
+      startNs = std::min(startNs, event.beginNs);
+    threads.push_back(std::move(thread));
+  }
+
+  QFile file(filename);
+  if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot open" << filename << file.errorString();
+    return false;
+  }
+
+  QByteArray json("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  bool firstEvent = true;
+  for(const ThreadEvents& thread : threads)
+  {
+    QByteArray tid = QByteArray::number(thread.buffer->threadId);
+
+    json.append(firstEvent ? "\n" : ",\n");
+    firstEvent = false;
+    json.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":").append(tid).
+    append(",\"args\":{\"name\":\"");
+    appendEscaped(json, thread.buffer->threadName);
+    json.append(' ').append(tid).append("\"}}");
+
+    // Complete events with microsecond timestamps relative to the first event
+    for(const TraceEvent& event : thread.events)
+    {
+      json.append(",\n{\"name\":\"").append(event.name).append("\",\"ph\":\"X\",\"pid\":1,\"tid\":").append(tid).
+      append(",\"ts\":").append(QByteArray::number((event.beginNs - startNs) / 1000., 'f', 3)).
+      append(",\"dur\":").append(QByteArray::number((event.endNs - event.beginNs) / 1000., 'f', 3)).
+      append('}');
+
+      if(json.size() > 1024 * 1024)
+      {
+        file.write(json);
+        json.clear();
+      }
+    }
+  }
+  json.append("\n]}\n");
+  file.write(json);
+
+  if(file.error() != QFileDevice::NoError)
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot write" << filename << file.errorString();
+    return false;
+  }
+  return true;
+}
+
+} // namespace lfgc
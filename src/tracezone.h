@@ -0,0 +1,108 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLEFGCONNECT_TRACEZONE_H
+#define LITTLEFGCONNECT_TRACEZONE_H
+
+#include "snapshotlayout.h"
+
+#include <QString>
+
+/*
+ * Scoped trace zones for detailed timing of the processing steps.
+ *
+ * Only recorded if built with LFGC_TRACE defined (qmake with environment variable LITTLEFGCONNECT_TRACE=true).
+ * Otherwise all macros expand to nothing.
+ *
+ * LFGC_TRACE_ZONE(name) records the time until the end of the enclosing scope.
+ * LFGC_TRACE_BEGIN(zone, name) and LFGC_TRACE_END(zone) record a part of a scope like waiting for a lock.
+ * name has to be a string literal.
+ */
+#ifdef LFGC_TRACE
+
+#define LFGC_TRACE_CONCAT_(a, b) a ## b
+#define LFGC_TRACE_CONCAT(a, b) LFGC_TRACE_CONCAT_(a, b)
+
+#define LFGC_TRACE_ZONE(name) lfgc::TraceZone LFGC_TRACE_CONCAT(lfgcTraceZone, __LINE__)(name)
+#define LFGC_TRACE_BEGIN(zone, name) lfgc::TraceZone zone(name)
+#define LFGC_TRACE_END(zone) zone.end()
+
+#else
+
+#define LFGC_TRACE_ZONE(name)
+#define LFGC_TRACE_BEGIN(zone, name)
+#define LFGC_TRACE_END(zone)
+
+#endif
+
+namespace lfgc {
+
+/*
+ * Collects trace events of all threads.
+ *
+ * Each thread records into its own ring buffer which is allocated on first use. Recording does not
+ * lock and does not allocate afterwards. The oldest events of a thread are overwritten if the buffer
+ * is full. A buffer holds enough events for several minutes of 50 Hz input.
+ */
+class Trace
+{
+public:
+  /* Append a completed zone to the ring buffer of the calling thread. Times are monotonicNowNs(). */
+  static void record(const char *name, qint64 beginNs, qint64 endNs);
+
+  /* Write all events still in the buffers as Chrome trace JSON which can be loaded into
+   * chrome://tracing or https://ui.perfetto.dev. Can be called while threads are recording.
+   * Returns false if the file cannot be written. */
+  static bool writeChromeTrace(const QString& filename);
+};
+
+/* Records the time between construction and end() or destruction */
+class TraceZone
+{
+public:
+  explicit TraceZone(const char *nameParam)
+    : name(nameParam), beginNs(monotonicNowNs())
+  {
+  }
+
+  ~TraceZone()
+  {
+    end();
+  }
+
+  void end()
+  {
+    if(name != nullptr)
+    {
+      Trace::record(name, beginNs, monotonicNowNs());
+      name = nullptr;
+    }
+  }
+
+  TraceZone(const TraceZone& other) = delete;
+  TraceZone& operator=(const TraceZone& other) = delete;
+
+private:
+  const char *name;
+  qint64 beginNs;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_TRACEZONE_H
@@ -0,0 +1,300 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "trackhistory.h"
+
+#include "fs/sc/simconnectuseraircraft.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace lfgc {
+
+/* Force a commit if this number of points were dropped since the anchor to keep the check cheap */
+static const int MAX_DROPPED = 128;
+
+static const double EARTH_RADIUS_METER = 6371000.;
+static const double DEG_TO_RAD = 3.14159265358979323846 / 180.;
+
+TrackHistory::TrackHistory(int capacityParam, float toleranceMeterParam, float altToleranceFtParam,
+                           qint64 maxIntervalMsParam)
+  : capacity(capacityParam), toleranceMeter(toleranceMeterParam), altToleranceFt(altToleranceFtParam),
+  maxIntervalMs(maxIntervalMsParam)
+{
+  dropped.reserve(MAX_DROPPED);
+}
+
+TrackHistory::~TrackHistory()
+{
+  detach();
+}
+
+bool TrackHistory::create()
+{
+  int size = static_cast<int>(sizeof(TrackHistoryHeader) + sizeof(TrackPoint) * static_cast<size_t>(capacity));
+
+  sharedMemory.setKey(TRACK_SHARED_MEMORY_KEY);
+  if(!sharedMemory.create(size, QSharedMemory::ReadWrite))
+  {
+    qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot create" << sharedMemory.errorString();
+
+    // Left over from a crashed instance - can be reused if large enough
+    if(!sharedMemory.attach(QSharedMemory::ReadWrite))
+    {
+      qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot attach" << sharedMemory.errorString();
+      return false;
+    }
+    else if(sharedMemory.size() < size)
+    {
+      qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Region too small" << sharedMemory.size() << "<" << size;
+      sharedMemory.detach();
+      return false;
+    }
+  }
+
+  qInfo() << "LittleFgConnect" << Q_FUNC_INFO << "Track history" << sharedMemory.key()
+          << "native" << sharedMemory.nativeKey() << "capacity" << capacity;
+
+  nextSequence = 0;
+  hasAnchor = hasTail = false;
+  dropped.clear();
+
+  if(sharedMemory.lock())
+  {
+    TrackHistoryHeader *hdr = header();
+    hdr->magic = TRACK_HISTORY_MAGIC;
+    hdr->version = TRACK_HISTORY_VERSION;
+    hdr->capacity = static_cast<quint32>(capacity);
+    hdr->tailProvisional = 0;
+    hdr->nextSequence = 0;
+    hdr->revision = 0;
+    sharedMemory.unlock();
+  }
+  return true;
+}
+
+void TrackHistory::detach()
+{
+  if(sharedMemory.isAttached() && !sharedMemory.detach())
+    qWarning() << "Cannot detach" << sharedMemory.errorString() << "from" << sharedMemory.key();
+}
+
+QString TrackHistory::getSinkName() const
+{
+  return QString("Track history");
+}
+
+bool TrackHistory::openSink()
+{
+  return create();
+}
+
+void TrackHistory::closeSink()
+{
+  detach();
+}
+
+void TrackHistory::writeFrame(const OutputFrame& frame)
+{
+  const atools::fs::sc::SimConnectUserAircraft& userAircraft = frame.data.getUserAircraftConst();
+  if(!frame.userChanged || !userAircraft.getPosition().isValid() || userAircraft.isSimPaused() ||
+     userAircraft.isSimReplay())
+    return;
+
+  TrackPoint point;
+  point.timestampMs = frame.timestampMs;
+  point.lonX = static_cast<double>(userAircraft.getPosition().getLonX());
+  point.latY = static_cast<double>(userAircraft.getPosition().getLatY());
+  point.altitudeFt = userAircraft.getIndicatedAltitudeFt();
+  point.groundSpeedKts = userAircraft.getGroundSpeedKts();
+  point.headingTrueDeg = userAircraft.getHeadingDegTrue();
+  point.flags = userAircraft.isOnGround() ? TRACK_ON_GROUND : 0;
+  addSample(point);
+}
+
+TrackHistoryHeader *TrackHistory::header()
+{
+  return static_cast<TrackHistoryHeader *>(sharedMemory.data());
+}
+
+TrackPoint *TrackHistory::points()
+{
+  return reinterpret_cast<TrackPoint *>(static_cast<char *>(sharedMemory.data()) + sizeof(TrackHistoryHeader));
+}
+
+void TrackHistory::addSample(const TrackPoint& point)
+{
+  if(!sharedMemory.isAttached())
+    return;
+
+  if(!sharedMemory.lock())
+  {
+    qWarning() << "LittleFgConnect" << Q_FUNC_INFO << "Cannot lock" << sharedMemory.key();
+    return;
+  }
+
+  if(!hasAnchor)
+  {
+    // First point is committed immediately
+    anchor = point;
+    hasAnchor = true;
+    writePoint(nextSequence++, point, false);
+  }
+  else if(!hasTail)
+  {
+    tail = point;
+    hasTail = true;
+    writePoint(nextSequence++, point, true);
+  }
+  else if(canReplaceTail(point))
+  {
+    // Move provisional point forward - sequence stays the same
+    dropped.append(tail);
+    tail = point;
+    writePoint(nextSequence - 1, point, true);
+  }
+  else
+  {
+    // Commit the tail as new anchor and start a new segment
+    anchor = tail;
+    dropped.clear();
+    tail = point;
+    writePoint(nextSequence++, point, true);
+  }
+
+  sharedMemory.unlock();
+}
+
+bool TrackHistory::canReplaceTail(const TrackPoint& point) const
+{
+  if(dropped.size() >= MAX_DROPPED || point.timestampMs - anchor.timestampMs > maxIntervalMs ||
+     (point.flags & TRACK_ON_GROUND) != (anchor.flags & TRACK_ON_GROUND))
+    return false;
+
+  // Local equirectangular projection around the anchor in meter - precise enough for short segments
+  double cosLat = std::cos(anchor.latY * DEG_TO_RAD);
+  auto projectX = [cosLat, this](const TrackPoint& p) {
+    return (p.lonX - anchor.lonX) * DEG_TO_RAD * EARTH_RADIUS_METER * cosLat;
+  };
+  auto projectY = [this](const TrackPoint& p) {
+    return (p.latY - anchor.latY) * DEG_TO_RAD * EARTH_RADIUS_METER;
+  };
+
+  double segX = projectX(point), segY = projectY(point);
+  double segLenSq = segX * segX + segY * segY;
+
+  // Check the current tail and all points dropped before against the new line anchor to point
+  auto withinTolerance = [ =, &point](const TrackPoint& p) -> bool {
+    double x = projectX(p), y = projectY(p);
+
+    // Position along segment clamped to the end points
+    double t = segLenSq > 0. ? std::max(0., std::min(1., (x * segX + y * segY) / segLenSq)) : 0.;
+    double dx = x - t * segX, dy = y - t * segY;
+    if(dx * dx + dy * dy > static_cast<double>(toleranceMeter) * toleranceMeter)
+      return false;
+
+    double alt = anchor.altitudeFt + t * (point.altitudeFt - anchor.altitudeFt);
+    return std::abs(alt - p.altitudeFt) <= altToleranceFt;
+  };
+
+  if(!withinTolerance(tail))
+    return false;
+
+  for(const TrackPoint& p : dropped)
+  {
+    if(!withinTolerance(p))
+      return false;
+  }
+  return true;
+}
+
+void TrackHistory::writePoint(quint64 sequence, const TrackPoint& point, bool provisional)
+{
+  std::memcpy(points() + sequence % static_cast<quint64>(capacity), &point, sizeof(TrackPoint));
+
+  TrackHistoryHeader *hdr = header();
+  hdr->nextSequence = nextSequence;
+  hdr->tailProvisional = provisional;
+  hdr->revision++;
+}
+
+// ======================================================================================
+TrackHistoryReader::TrackHistoryReader()
+{
+  sharedMemory.setKey(TRACK_SHARED_MEMORY_KEY);
+}
+
+TrackHistoryReader::~TrackHistoryReader()
+{
+  detach();
+}
+
+bool TrackHistoryReader::attach()
+{
+  if(sharedMemory.isAttached())
+    return true;
+
+  if(!sharedMemory.attach(QSharedMemory::ReadOnly))
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot attach" << sharedMemory.errorString();
+    return false;
+  }
+  return true;
+}
+
+void TrackHistoryReader::detach()
+{
+  if(sharedMemory.isAttached())
+    sharedMemory.detach();
+}
+
+quint64 TrackHistoryReader::read(quint64 fromSequence, QVector<TrackPoint>& points)
+{
+  if(!sharedMemory.isAttached() || !sharedMemory.lock())
+    return fromSequence;
+
+  const TrackHistoryHeader *hdr = static_cast<const TrackHistoryHeader *>(sharedMemory.constData());
+  quint64 resumeSequence = fromSequence;
+
+  if(hdr->magic == TRACK_HISTORY_MAGIC && hdr->version == TRACK_HISTORY_VERSION && hdr->capacity > 0)
+  {
+    const TrackPoint *ring = reinterpret_cast<const TrackPoint *>(
+      static_cast<const char *>(sharedMemory.constData()) + sizeof(TrackHistoryHeader));
+
+    quint64 next = hdr->nextSequence;
+    quint64 first = next > hdr->capacity ? next - hdr->capacity : 0;
+
+    // Writer was restarted if the reader is ahead - start over
+    quint64 seq = fromSequence > next ? first : std::max(fromSequence, first);
+
+    points.reserve(points.size() + static_cast<int>(next - seq));
+    for(; seq < next; seq++)
+      points.append(ring[seq % hdr->capacity]);
+
+    resumeSequence = hdr->tailProvisional && next > 0 ? next - 1 : next;
+    revision = hdr->revision;
+  }
+
+  sharedMemory.unlock();
+  return resumeSequence;
+}
+
+} // namespace lfgc
@@ -0,0 +1,155 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_TRACKHISTORY_H
+#define LITTLEFGCONNECT_TRACKHISTORY_H
+
+#include "outputsink.h"
+
+#include <QSharedMemory>
+#include <QVector>
+
+namespace lfgc {
+
+/* Key of the shared memory region holding the track ring */
+const QLatin1String TRACK_SHARED_MEMORY_KEY("LittleFgConnectTrack");
+
+/* Changed whenever the layout of TrackHistoryHeader or TrackPoint changes */
+const quint32 TRACK_HISTORY_MAGIC = 0x4c464754; // "LFGT"
+const quint32 TRACK_HISTORY_VERSION = 1;
+
+enum TrackPointFlags : quint32
+{
+  TRACK_ON_GROUND = 0x0001
+};
+
+/* One sample of the user aircraft. Plain data which is copied as is into the shared memory. */
+struct TrackPoint
+{
+  /* Milliseconds since epoch UTC */
+  qint64 timestampMs;
+  double lonX, latY;
+  float altitudeFt, groundSpeedKts, headingTrueDeg;
+  quint32 flags;
+};
+
+/*
+ * Header at the start of the shared memory region. Followed by capacity TrackPoint structs.
+ *
+ * Point with sequence number s is stored at slot s % capacity. Valid sequences are
+ * [max(0, nextSequence - capacity), nextSequence).
+ * The last point is provisional if tailProvisional is not 0 and can be moved to a later
+ * position until the next point is committed.
+ */
+struct TrackHistoryHeader
+{
+  quint32 magic, version, capacity, tailProvisional;
+  quint64 nextSequence;
+
+  /* Incremented on every change including moves of the provisional point */
+  quint64 revision;
+};
+
+/*
+ * Fixed size ring of user aircraft positions in a separate shared memory region.
+ *
+ * Samples are simplified incrementally while adding: the newest point is kept as provisional tail
+ * and is moved forward as long as all points dropped since the last committed point stay within the
+ * given lateral and vertical tolerance of the straight line. Straight and level or parked segments
+ * collapse to two points this way. A point is committed at least every maxIntervalMs and on
+ * ground state changes.
+ *
+ * Runs as output sink in its own thread. Frames which only update the traffic are ignored.
+ */
+class TrackHistory :
+  public OutputSink
+{
+public:
+  TrackHistory(int capacityParam, float toleranceMeterParam = 20.f, float altToleranceFtParam = 50.f,
+               qint64 maxIntervalMsParam = 60000);
+  virtual ~TrackHistory() override;
+
+  /* Create or attach to the shared memory region and initialize an empty ring */
+  bool create();
+  void detach();
+
+  void addSample(const TrackPoint& point);
+
+  /* Output sink adding the user aircraft of each frame */
+  virtual QString getSinkName() const override;
+  virtual bool openSink() override;
+  virtual void writeFrame(const OutputFrame& frame) override;
+  virtual void closeSink() override;
+
+private:
+  /* True if point can replace the current tail without losing detail */
+  bool canReplaceTail(const TrackPoint& point) const;
+
+  /* Write point into slot of sequence and update header. Shared memory has to be locked. */
+  void writePoint(quint64 sequence, const TrackPoint& point, bool provisional);
+
+  TrackHistoryHeader *header();
+  TrackPoint *points();
+
+  int capacity;
+  float toleranceMeter, altToleranceFt;
+  qint64 maxIntervalMs;
+
+  /* Local copy of the ring state to avoid reading the shared memory */
+  quint64 nextSequence = 0;
+  bool hasAnchor = false, hasTail = false;
+  TrackPoint anchor, tail;
+
+  /* Points replaced since the anchor. Needed to check the tolerance for the next move. */
+  QVector<TrackPoint> dropped;
+
+  QSharedMemory sharedMemory;
+};
+
+/*
+ * Reads the track from the shared memory region of a TrackHistory. Can be used in other processes.
+ */
+class TrackHistoryReader
+{
+public:
+  TrackHistoryReader();
+  ~TrackHistoryReader();
+
+  bool attach();
+  void detach();
+
+  /* Append all points starting at sequence fromSequence to points. Points which were already
+   * overwritten in the ring are skipped.
+   * Returns the sequence to pass on the next call. This is the sequence of the provisional
+   * last point if any so it is fetched again when it was moved. Returns fromSequence on error. */
+  quint64 read(quint64 fromSequence, QVector<TrackPoint>& points);
+
+  /* Revision of the last read. Nothing changed if this is the same for two calls. */
+  quint64 getRevision() const
+  {
+    return revision;
+  }
+
+private:
+  quint64 revision = 0;
+  QSharedMemory sharedMemory;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_TRACKHISTORY_H
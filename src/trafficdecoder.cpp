@@ -0,0 +1,137 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "trafficdecoder.h"
+
+#include "fieldreader.h"
+#include "tracezone.h"
+
+#include <QDebug>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+
+namespace lfgc {
+
+/* Fields smaller than this are decoded in the calling thread - roughly 100 records */
+static const int MIN_PARALLEL_BYTES = 4096;
+
+/* Do not split into chunks smaller than this */
+static const int MIN_CHUNK_BYTES = 2048;
+
+TrafficDecoder::TrafficDecoder(int maxThreads)
+{
+  if(maxThreads > 0)
+    threadPool.setMaxThreadCount(maxThreads);
+
+  for(int i = 0; i < threadPool.maxThreadCount(); i++)
+    chunks.append(new Chunk);
+}
+
+TrafficDecoder::~TrafficDecoder()
+{
+  threadPool.waitForDone();
+  qDeleteAll(chunks);
+}
+
+void TrafficDecoder::decode(const QByteArray& aiObjects, TrafficStore& traffic)
+{
+  traffic.clear();
+
+  const char *begin = aiObjects.constData(), *end = begin + aiObjects.size();
+  if(aiObjects.size() < MIN_PARALLEL_BYTES || chunks.size() < 2)
+  {
+    // Not worth the thread handover - first chunk pool is used for interning
+    decodeRecords(begin, end, traffic, chunks.first()->pool);
+    return;
+  }
+
+  // Split at record separators into chunks of about equal size
+  int numChunks = std::min(chunks.size(), std::max(aiObjects.size() / MIN_CHUNK_BYTES, 1));
+  int chunkSize = aiObjects.size() / numChunks;
+  const char *chunkBegin = begin;
+  int used = 0;
+  for(; used < numChunks && chunkBegin < end; used++)
+  {
+    const char *chunkEnd = used == numChunks - 1 ? end : std::min(chunkBegin + chunkSize, end);
+    chunkEnd = std::find(chunkEnd, end, '|');
+
+    chunks[used]->begin = chunkBegin;
+    chunks[used]->end = chunkEnd;
+    chunkBegin = chunkEnd < end ? chunkEnd + 1 : end;
+  }
+
+  QVector<QFuture<void> > futures;
+  for(int i = 0; i < used; i++)
+  {
+    Chunk *chunk = chunks.at(i);
+    futures.append(QtConcurrent::run(&threadPool, [chunk]() {
+      chunk->traffic.clear();
+      decodeRecords(chunk->begin, chunk->end, chunk->traffic, chunk->pool);
+    }));
+  }
+
+  // Merge in field order
+  for(int i = 0; i < used; i++)
+  {
+    futures[i].waitForFinished();
+
+    const TrafficStore& chunkTraffic = chunks.at(i)->traffic;
+    traffic.reserve(traffic.size() + chunkTraffic.size());
+    for(int row = 0; row < chunkTraffic.size(); row++)
+      traffic.appendRow(chunkTraffic, row);
+  }
+}
+
+void TrafficDecoder::decodeRecords(const char *begin, const char *end, TrafficStore& traffic, StringPool& pool)
+{
+  LFGC_TRACE_ZONE("parse ai");
+  FieldReader aircrafts(begin, end, '|');
+  while(begin < end && aircrafts.next())
+  {
+    if(aircrafts.isFieldEmpty())
+      continue;
+
+    int numItems = static_cast<int>(std::count(aircrafts.fieldBegin(), aircrafts.fieldEnd(), '^')) + 1;
+    if(numItems != 6)
+    {
+      qDebug() << Q_FUNC_INFO << "ERROR: AI Object size not 6 items: "
+               << QByteArray(aircrafts.fieldBegin(), aircrafts.fieldLength());
+      continue;
+    }
+
+    FieldReader aircraftItem(aircrafts.fieldBegin(), aircrafts.fieldEnd(), '^');
+    QString callsign = aircraftItem.readString(pool);
+    QString arrivalAirportId = aircraftItem.readString(pool);
+    QString departureAirportId = aircraftItem.readString(pool);
+    float altitudeFt = aircraftItem.readFloat();
+    float latitudeDeg = aircraftItem.readFloat();
+    float longitudeDeg = aircraftItem.readFloat();
+
+    int row = traffic.append();
+    traffic.setCallsign(row, callsign);
+    traffic.setFromIdent(row, departureAirportId);
+    traffic.setToIdent(row, arrivalAirportId);
+    traffic.setModel(row, QString());
+    traffic.setPosition(row, longitudeDeg, latitudeDeg, altitudeFt);
+  }
+}
+
+} // namespace lfgc
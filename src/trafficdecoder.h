@@ -0,0 +1,67 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_TRAFFICDECODER_H
+#define LITTLEFGCONNECT_TRAFFICDECODER_H
+
+#include "stringpool.h"
+#include "trafficstore.h"
+
+#include <QThreadPool>
+
+namespace lfgc {
+
+/*
+ * Decodes the AI objects field "callsign^arrival^departure^altitude^latitude^longitude|..." into a traffic store.
+ *
+ * Large fields are split at record boundaries into chunks of about the same size which are decoded
+ * concurrently on a bounded thread pool. Each chunk has its own store and string pool. The chunk results
+ * are appended in field order so the result does not depend on thread scheduling.
+ *
+ * decode() blocks until all chunks are done. Not thread safe. Used in the writer thread.
+ */
+class TrafficDecoder
+{
+public:
+  /* maxThreads 0 uses the number of cores */
+  explicit TrafficDecoder(int maxThreads = 0);
+  ~TrafficDecoder();
+
+  /* Decode all records of aiObjects into traffic which is cleared before */
+  void decode(const QByteArray& aiObjects, TrafficStore& traffic);
+
+  /* Decode the records between begin and end and append them to traffic */
+  static void decodeRecords(const char *begin, const char *end, TrafficStore& traffic, StringPool& pool);
+
+private:
+  struct Chunk
+  {
+    const char *begin = nullptr, *end = nullptr;
+    TrafficStore traffic;
+    StringPool pool;
+  };
+
+  QThreadPool threadPool;
+
+  /* Kept between calls to reuse the store memory and the interned strings */
+  QVector<Chunk *> chunks;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_TRAFFICDECODER_H
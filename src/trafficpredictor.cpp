@@ -0,0 +1,222 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "trafficpredictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lfgc {
+
+static const double PI = 3.14159265358979323846;
+
+/* Dumps closer than this give too noisy velocities */
+static const double MIN_INTERVAL_SECONDS = 1.;
+
+/* Pilots not seen for longer start again without velocity */
+static const double MAX_INTERVAL_SECONDS = 60.;
+
+/* Faster movements are caused by teleporting or a changed server and are not extrapolated */
+static const double MAX_SPEED_KTS = 1200.;
+
+/* Differences between extrapolated and new positions larger than this are not blended */
+static const double MAX_CORRECTION_NM = 2.;
+
+/* Time to blend out the difference after a new dump */
+static const double CORRECTION_SECONDS = 2.;
+
+/* Weight of the latest velocity sample */
+static const double VELOCITY_WEIGHT = 0.6;
+
+/* Distance of a position difference in nautical miles. Flat earth is fine for a few miles. */
+static double distanceNm(double lonXDelta, double latYDelta, double latY)
+{
+  return std::hypot(lonXDelta * 60. * std::cos(latY * PI / 180.), latYDelta * 60.);
+}
+
+/* Longitude difference normalized to -180 to 180 */
+static double lonXDelta(double to, double from)
+{
+  double delta = to - from;
+  if(delta > 180.)
+    delta -= 360.;
+  else if(delta < -180.)
+    delta += 360.;
+  return delta;
+}
+
+void TrafficPredictor::update(const TrafficStore& traffic, qint64 nowNs)
+{
+  QVector<Track> newTracks(traffic.size());
+
+  for(int i = 0; i < traffic.size(); i++)
+  {
+    Track& track = newTracks[i];
+    double lonX = traffic.getLonX(i), latY = traffic.getLatY(i), altFt = traffic.getAltitudeFt(i);
+
+    int row = rowByCallsign.value(traffic.getCallsign(i), -1);
+    if(row != -1 && observed.getLonX(row) == traffic.getLonX(i) && observed.getLatY(row) == traffic.getLatY(i) &&
+       observed.getAltitudeFt(row) == traffic.getAltitudeFt(i))
+    {
+      // Same sample again - keep age and track
+      track = tracks.at(row);
+      continue;
+    }
+
+    track.observedNs = nowNs;
+    track.anchorNs = nowNs;
+    track.anchorLonX = lonX;
+    track.anchorLatY = latY;
+    track.anchorAltFt = altFt;
+
+    if(row == -1)
+      continue;
+
+    const Track& last = tracks.at(row);
+    double seconds = (nowNs - last.anchorNs) / 1000000000.;
+    if(seconds > MAX_INTERVAL_SECONDS)
+      // Start over without velocity
+      continue;
+
+    double lonXPerSec = last.lonXPerSec, latYPerSec = last.latYPerSec, altFtPerSec = last.altFtPerSec;
+    bool hasVelocity = last.hasVelocity;
+    if(seconds < MIN_INTERVAL_SECONDS)
+    {
+      // Too close for a new velocity sample - keep the velocity and measure from the older sample
+      track.anchorNs = last.anchorNs;
+      track.anchorLonX = last.anchorLonX;
+      track.anchorLatY = last.anchorLatY;
+      track.anchorAltFt = last.anchorAltFt;
+    }
+    else
+    {
+      double dLon = lonXDelta(lonX, last.anchorLonX);
+      double dLat = latY - last.anchorLatY;
+      if(distanceNm(dLon, dLat, latY) / seconds * 3600. > MAX_SPEED_KTS)
+        // Teleported - start over without velocity
+        continue;
+
+      double sampleLonXPerSec = dLon / seconds, sampleLatYPerSec = dLat / seconds;
+      double sampleAltFtPerSec = (altFt - last.anchorAltFt) / seconds;
+      if(hasVelocity)
+      {
+        // Smooth the jitter of the dump arrival times
+        lonXPerSec = VELOCITY_WEIGHT * sampleLonXPerSec + (1. - VELOCITY_WEIGHT) * lonXPerSec;
+        latYPerSec = VELOCITY_WEIGHT * sampleLatYPerSec + (1. - VELOCITY_WEIGHT) * latYPerSec;
+        altFtPerSec = VELOCITY_WEIGHT * sampleAltFtPerSec + (1. - VELOCITY_WEIGHT) * altFtPerSec;
+      }
+      else
+      {
+        lonXPerSec = sampleLonXPerSec;
+        latYPerSec = sampleLatYPerSec;
+        altFtPerSec = sampleAltFtPerSec;
+        hasVelocity = true;
+      }
+    }
+
+    if(!hasVelocity)
+      continue;
+
+    if(last.hasVelocity)
+    {
+      // Start from the position shown until now and move to the new track
+      double shownLonX, shownLatY, shownAltFt;
+      position(row, nowNs, shownLonX, shownLatY, shownAltFt);
+      double errLon = lonXDelta(shownLonX, lonX), errLat = shownLatY - latY;
+      if(distanceNm(errLon, errLat, latY) < MAX_CORRECTION_NM)
+      {
+        track.lonXError = errLon;
+        track.latYError = errLat;
+        track.altFtError = shownAltFt - altFt;
+      }
+    }
+
+    track.lonXPerSec = lonXPerSec;
+    track.latYPerSec = latYPerSec;
+    track.altFtPerSec = altFtPerSec;
+    track.hasVelocity = true;
+  }
+
+  observed = traffic;
+  tracks.swap(newTracks);
+
+  rowByCallsign.clear();
+  rowByCallsign.reserve(observed.size());
+  for(int i = 0; i < observed.size(); i++)
+    rowByCallsign.insert(observed.getCallsign(i), i);
+}
+
+void TrafficPredictor::position(int row, qint64 nowNs, double& lonX, double& latY, double& altFt) const
+{
+  const Track& track = tracks.at(row);
+  double age = std::max((nowNs - track.observedNs) / 1000000000., 0.);
+  double seconds = std::min(age, static_cast<double>(limitSeconds));
+  double correction = std::max(1. - age / CORRECTION_SECONDS, 0.);
+
+  lonX = observed.getLonX(row) + track.lonXPerSec * seconds + track.lonXError * correction;
+  latY = observed.getLatY(row) + track.latYPerSec * seconds + track.latYError * correction;
+  altFt = observed.getAltitudeFt(row) + track.altFtPerSec * seconds + track.altFtError * correction;
+
+  if(lonX > 180.)
+    lonX -= 360.;
+  else if(lonX < -180.)
+    lonX += 360.;
+}
+
+void TrafficPredictor::predict(TrafficStore& traffic, qint64 nowNs) const
+{
+  traffic.clear();
+  traffic.reserve(observed.size());
+
+  for(int i = 0; i < observed.size(); i++)
+  {
+    int row = traffic.appendRow(observed, i);
+    const Track& track = tracks.at(i);
+    traffic.setAgeSeconds(row, static_cast<float>(std::max((nowNs - track.observedNs) / 1000000000., 0.)));
+
+    if(limitSeconds > 0.f && track.hasVelocity)
+    {
+      double lonX, latY, altFt;
+      position(i, nowNs, lonX, latY, altFt);
+      traffic.setPosition(row, static_cast<float>(lonX), static_cast<float>(latY), static_cast<float>(altFt));
+      traffic.setPredicted(row, true);
+
+      // Dumps contain positions only - fill speeds and heading from the estimated velocity
+      double eastKts = track.lonXPerSec * 60. * std::cos(latY * PI / 180.) * 3600.;
+      double northKts = track.latYPerSec * 60. * 3600.;
+      double groundSpeedKts = std::hypot(eastKts, northKts);
+      traffic.setGroundSpeedKts(row, static_cast<float>(groundSpeedKts));
+      traffic.setVerticalSpeedFeetPerMin(row, static_cast<float>(track.altFtPerSec * 60.));
+      if(groundSpeedKts > 1.)
+      {
+        double heading = std::atan2(eastKts, northKts) * 180. / PI;
+        traffic.setHeadingTrueDeg(row, static_cast<float>(heading < 0. ? heading + 360. : heading));
+      }
+    }
+  }
+}
+
+void TrafficPredictor::clear()
+{
+  observed.clear();
+  tracks.clear();
+  rowByCallsign.clear();
+}
+
+} // namespace lfgc
@@ -0,0 +1,97 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLEFGCONNECT_TRAFFICPREDICTOR_H
+#define LITTLEFGCONNECT_TRAFFICPREDICTOR_H
+
+#include "trafficstore.h"
+
+#include <QHash>
+
+namespace lfgc {
+
+/*
+ * Extrapolates multiplayer traffic between two server dumps.
+ *
+ * The velocity of each pilot is estimated from the positions of the same callsign in successive dumps.
+ * Positions are extrapolated along this velocity for at most a limited time after the position was received.
+ *
+ * Each pilot keeps the time its position last changed. A pilot passed again with an unchanged position,
+ * like the results of a failed server which are merged again, keeps its age and track. Positions arriving
+ * too soon after the last velocity sample keep the estimated velocity.
+ * The difference between the extrapolated and the newly received position is blended out over a short
+ * time to avoid jumps when a new dump arrives.
+ *
+ * Rows filled by predict() have the predicted flag set if extrapolated and the age of the last
+ * observation. Not thread safe.
+ */
+class TrafficPredictor
+{
+public:
+  /* Extrapolate at most this number of seconds after the last dump. 0 disables extrapolation
+   * but still sets the age of all rows. */
+  void setLimitSeconds(float value)
+  {
+    limitSeconds = value;
+  }
+
+  /* Pass all pilots after a new dump was received at monotonic time nowNs */
+  void update(const TrafficStore& traffic, qint64 nowNs);
+
+  /* Fill traffic with all pilots of the last dump at their positions at monotonic time nowNs.
+   * Reuses the rows and strings already in traffic. */
+  void predict(TrafficStore& traffic, qint64 nowNs) const;
+
+  /* Forget all pilots */
+  void clear();
+
+private:
+  /* Movement of one pilot in degrees and feet per second */
+  struct Track
+  {
+    /* Time the current position was received */
+    qint64 observedNs = 0;
+
+    /* Position and time of the last sample used to estimate the velocity */
+    qint64 anchorNs = 0;
+    double anchorLonX = 0., anchorLatY = 0., anchorAltFt = 0.;
+
+    double lonXPerSec = 0., latYPerSec = 0., altFtPerSec = 0.;
+
+    /* Offset from the observed position at observedNs which is reduced to zero over the correction time */
+    double lonXError = 0., latYError = 0., altFtError = 0.;
+    bool hasVelocity = false;
+  };
+
+  /* Extrapolated position of row at nowNs */
+  void position(int row, qint64 nowNs, double& lonX, double& latY, double& altFt) const;
+
+  /* Last dump and the tracks with the same row index */
+  TrafficStore observed;
+  QVector<Track> tracks;
+
+  /* Callsign to row index in observed */
+  QHash<QString, int> rowByCallsign;
+
+  float limitSeconds = 20.f;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_TRAFFICPREDICTOR_H
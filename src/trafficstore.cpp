@@ -0,0 +1,122 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "trafficstore.h"
+
+#include "fs/sc/simconnecttypes.h"
+
+#include <algorithm>
+
+namespace lfgc {
+
+/* Initial number of rows. Grows by doubling if exceeded. */
+static const int INITIAL_CAPACITY = 64;
+
+TrafficStore::TrafficStore()
+{
+  grow(INITIAL_CAPACITY);
+}
+
+void TrafficStore::clear()
+{
+  count = 0;
+}
+
+void TrafficStore::reserve(int rows)
+{
+  if(rows > capacity())
+    grow(rows);
+}
+
+int TrafficStore::append()
+{
+  if(count >= capacity())
+    grow(std::max(INITIAL_CAPACITY, capacity() * 2));
+
+  int index = count++;
+
+  longitudeDeg[index] = atools::fs::sc::SC_INVALID_FLOAT;
+  latitudeDeg[index] = atools::fs::sc::SC_INVALID_FLOAT;
+  altitudeFt[index] = atools::fs::sc::SC_INVALID_FLOAT;
+  headingTrueDeg[index] = atools::fs::sc::SC_INVALID_FLOAT;
+  groundSpeedKts[index] = atools::fs::sc::SC_INVALID_FLOAT;
+  verticalSpeedFeetPerMin[index] = atools::fs::sc::SC_INVALID_FLOAT;
+  ageSeconds[index] = 0.f;
+  predicted[index] = false;
+
+  // Strings are left as they are to allow skipping the assignment if unchanged
+  return index;
+}
+
+void TrafficStore::copyRow(int index, const TrafficStore& other, int otherIndex)
+{
+  longitudeDeg[index] = other.longitudeDeg.at(otherIndex);
+  latitudeDeg[index] = other.latitudeDeg.at(otherIndex);
+  altitudeFt[index] = other.altitudeFt.at(otherIndex);
+  headingTrueDeg[index] = other.headingTrueDeg.at(otherIndex);
+  groundSpeedKts[index] = other.groundSpeedKts.at(otherIndex);
+  verticalSpeedFeetPerMin[index] = other.verticalSpeedFeetPerMin.at(otherIndex);
+  ageSeconds[index] = other.ageSeconds.at(otherIndex);
+  predicted[index] = other.predicted.at(otherIndex);
+
+  assignIfChanged(callsign[index], other.callsign.at(otherIndex));
+  assignIfChanged(fromIdent[index], other.fromIdent.at(otherIndex));
+  assignIfChanged(toIdent[index], other.toIdent.at(otherIndex));
+  assignIfChanged(model[index], other.model.at(otherIndex));
+}
+
+void TrafficStore::removeFast(int index)
+{
+  int last = count - 1;
+  if(index != last)
+  {
+    longitudeDeg[index] = longitudeDeg.at(last);
+    latitudeDeg[index] = latitudeDeg.at(last);
+    altitudeFt[index] = altitudeFt.at(last);
+    headingTrueDeg[index] = headingTrueDeg.at(last);
+    groundSpeedKts[index] = groundSpeedKts.at(last);
+    verticalSpeedFeetPerMin[index] = verticalSpeedFeetPerMin.at(last);
+    ageSeconds[index] = ageSeconds.at(last);
+    predicted[index] = predicted.at(last);
+
+    callsign[index].swap(callsign[last]);
+    fromIdent[index].swap(fromIdent[last]);
+    toIdent[index].swap(toIdent[last]);
+    model[index].swap(model[last]);
+  }
+  count--;
+}
+
+void TrafficStore::grow(int rows)
+{
+  longitudeDeg.resize(rows);
+  latitudeDeg.resize(rows);
+  altitudeFt.resize(rows);
+  headingTrueDeg.resize(rows);
+  groundSpeedKts.resize(rows);
+  verticalSpeedFeetPerMin.resize(rows);
+  ageSeconds.resize(rows);
+  predicted.resize(rows);
+
+  callsign.resize(rows);
+  fromIdent.resize(rows);
+  toIdent.resize(rows);
+  model.resize(rows);
+}
+
+} // namespace lfgc
@@ -0,0 +1,230 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_TRAFFICSTORE_H
+#define LITTLEFGCONNECT_TRAFFICSTORE_H
+
+#include <QString>
+#include <QVector>
+
+namespace lfgc {
+
+/* Values of a published traffic object which are not contained in SimConnectAircraft */
+struct TrafficStatus
+{
+  /* Seconds since the position was received */
+  float ageSeconds = 0.f;
+
+  /* Position is extrapolated */
+  bool predicted = false;
+};
+
+/*
+ * Structure-of-arrays store for AI and multiplayer traffic.
+ *
+ * Numeric fields are kept in contiguous columns which are never shrunk. clear() only resets the
+ * number of used rows so the allocated capacity is reused by the next frame. Strings are kept in
+ * separate columns and are only assigned if the value differs from the one already stored in the row.
+ *
+ * SimConnectAircraft objects are not created here. See XpConnect::materializeTraffic().
+ */
+class TrafficStore
+{
+public:
+  TrafficStore();
+
+  /* Reset number of used rows. Keeps all allocated memory. */
+  void clear();
+
+  /* Make sure that at least this number of rows can be used without allocation */
+  void reserve(int rows);
+
+  /* Add a new row and return its index. All numeric fields are set to SC_INVALID_FLOAT except age and
+   * predicted flag which are cleared. */
+  int append();
+
+  /* Copy all fields of row otherIndex from other into row index of this */
+  void copyRow(int index, const TrafficStore& other, int otherIndex);
+
+  /* Append a copy of row otherIndex from other and return the new index */
+  int appendRow(const TrafficStore& other, int otherIndex)
+  {
+    int index = append();
+    copyRow(index, other, otherIndex);
+    return index;
+  }
+
+  /* Remove the row at index by moving the last row into its place. Order is not kept. */
+  void removeFast(int index);
+
+  int size() const
+  {
+    return count;
+  }
+
+  bool isEmpty() const
+  {
+    return count == 0;
+  }
+
+  /* Number of rows that can be used without allocation */
+  int capacity() const
+  {
+    return latitudeDeg.size();
+  }
+
+  /* Numeric fields ============================================ */
+  void setPosition(int index, float lonX, float latY, float altFt)
+  {
+    longitudeDeg[index] = lonX;
+    latitudeDeg[index] = latY;
+    altitudeFt[index] = altFt;
+  }
+
+  void setHeadingTrueDeg(int index, float value)
+  {
+    headingTrueDeg[index] = value;
+  }
+
+  void setGroundSpeedKts(int index, float value)
+  {
+    groundSpeedKts[index] = value;
+  }
+
+  void setVerticalSpeedFeetPerMin(int index, float value)
+  {
+    verticalSpeedFeetPerMin[index] = value;
+  }
+
+  void setAgeSeconds(int index, float value)
+  {
+    ageSeconds[index] = value;
+  }
+
+  void setPredicted(int index, bool value)
+  {
+    predicted[index] = value;
+  }
+
+  float getLonX(int index) const
+  {
+    return longitudeDeg.at(index);
+  }
+
+  float getLatY(int index) const
+  {
+    return latitudeDeg.at(index);
+  }
+
+  float getAltitudeFt(int index) const
+  {
+    return altitudeFt.at(index);
+  }
+
+  float getHeadingTrueDeg(int index) const
+  {
+    return headingTrueDeg.at(index);
+  }
+
+  float getGroundSpeedKts(int index) const
+  {
+    return groundSpeedKts.at(index);
+  }
+
+  float getVerticalSpeedFeetPerMin(int index) const
+  {
+    return verticalSpeedFeetPerMin.at(index);
+  }
+
+  float getAgeSeconds(int index) const
+  {
+    return ageSeconds.at(index);
+  }
+
+  bool isPredicted(int index) const
+  {
+    return predicted.at(index);
+  }
+
+  /* String fields - assigned only if changed ============================================ */
+  void setCallsign(int index, const QString& value)
+  {
+    assignIfChanged(callsign[index], value);
+  }
+
+  void setFromIdent(int index, const QString& value)
+  {
+    assignIfChanged(fromIdent[index], value);
+  }
+
+  void setToIdent(int index, const QString& value)
+  {
+    assignIfChanged(toIdent[index], value);
+  }
+
+  void setModel(int index, const QString& value)
+  {
+    assignIfChanged(model[index], value);
+  }
+
+  const QString& getCallsign(int index) const
+  {
+    return callsign.at(index);
+  }
+
+  const QString& getFromIdent(int index) const
+  {
+    return fromIdent.at(index);
+  }
+
+  const QString& getToIdent(int index) const
+  {
+    return toIdent.at(index);
+  }
+
+  const QString& getModel(int index) const
+  {
+    return model.at(index);
+  }
+
+private:
+  static void assignIfChanged(QString& target, const QString& value)
+  {
+    // Comparing is cheaper than detaching and copying for the common case of unchanged values
+    if(!target.isSharedWith(value) && target != value)
+      target = value;
+  }
+
+  /* Grow all columns to the given number of rows */
+  void grow(int rows);
+
+  /* Number of used rows. Columns can be larger. */
+  int count = 0;
+
+  /* Numeric columns */
+  QVector<float> longitudeDeg, latitudeDeg, altitudeFt, headingTrueDeg, groundSpeedKts, verticalSpeedFeetPerMin,
+                 ageSeconds;
+  QVector<bool> predicted;
+
+  /* String columns */
+  QVector<QString> callsign, fromIdent, toIdent, model;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_TRAFFICSTORE_H
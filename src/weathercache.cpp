@@ -0,0 +1,192 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "weathercache.h"
+
+#include "fs/sc/simconnectuseraircraft.h"
+#include "fs/sc/simconnecttypes.h"
+#include "geo/pos.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lfgc {
+
+/* Samples above this altitude do not say anything about the surface */
+static const float MAX_ALTITUDE_FT = 60000.f;
+
+/* Standard lapse rate for the temperature reduction to ground */
+static const float LAPSE_RATE_CELSIUS_PER_FT = 0.0019812f;
+
+/* Remove expired samples after this number of records */
+static const int EXPIRE_INTERVAL = 1024;
+
+WeatherCache::WeatherCache(float cellSizeDegParam, float bandFtParam, int maxAgeSecondsParam)
+  : cellSizeDeg(cellSizeDegParam), bandFt(bandFtParam), maxAgeMs(maxAgeSecondsParam * 1000LL)
+{
+  numLonCells = static_cast<int>(std::ceil(360.f / cellSizeDeg));
+  numLatCells = static_cast<int>(std::ceil(180.f / cellSizeDeg));
+  numBands = static_cast<int>(std::ceil(MAX_ALTITUDE_FT / bandFt));
+}
+
+quint64 WeatherCache::key(int latCellParam, int lonCellParam, int band) const
+{
+  return (static_cast<quint64>(latCellParam) * static_cast<quint64>(numLonCells) +
+          static_cast<quint64>(lonCellParam)) * static_cast<quint64>(numBands) + static_cast<quint64>(band);
+}
+
+int WeatherCache::latCell(float latY) const
+{
+  return std::min(std::max(static_cast<int>(std::floor((latY + 90.f) / cellSizeDeg)), 0), numLatCells - 1);
+}
+
+int WeatherCache::lonCell(float lonX) const
+{
+  int cell = static_cast<int>(std::floor((lonX + 180.f) / cellSizeDeg)) % numLonCells;
+  return cell < 0 ? cell + numLonCells : cell;
+}
+
+void WeatherCache::record(const atools::fs::sc::SimConnectUserAircraft& aircraft)
+{
+  const atools::geo::Pos& pos = aircraft.getPosition();
+  if(!pos.isValid() || aircraft.getSeaLevelPressureMbar() <= 0.f)
+    return;
+
+  float altitudeFt = pos.getAltitude();
+  if(altitudeFt >= MAX_ALTITUDE_FT)
+    return;
+
+  qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+  int band = std::max(static_cast<int>(altitudeFt / bandFt), 0);
+
+  // Inserts only for new cells - the same cell is overwritten while flying through it
+  Sample& sample = cells[key(latCell(pos.getLatY()), lonCell(pos.getLonX()), band)];
+  sample.zuluTime = aircraft.getZuluTime();
+  sample.recordedMs = nowMs;
+  sample.windDirectionDegT = aircraft.getWindDirectionDegT();
+  sample.windSpeedKts = aircraft.getWindSpeedKts();
+  sample.surfaceTemperatureCelsius = aircraft.getAmbientTemperatureCelsius() +
+                                     std::max(aircraft.getAltitudeAboveGroundFt(), 0.f) * LAPSE_RATE_CELSIUS_PER_FT;
+  sample.seaLevelPressureMbar = aircraft.getSeaLevelPressureMbar();
+  sample.visibilityMeter = aircraft.getAmbientVisibilityMeter();
+
+  if(++recordsSinceExpire >= EXPIRE_INTERVAL)
+  {
+    recordsSinceExpire = 0;
+    expire(nowMs);
+  }
+}
+
+void WeatherCache::expire(qint64 nowMs)
+{
+  for(auto it = cells.begin(); it != cells.end();)
+  {
+    if(nowMs - it->recordedMs > maxAgeMs)
+      it = cells.erase(it);
+    else
+      ++it;
+  }
+}
+
+const WeatherCache::Sample *WeatherCache::findCell(int latCellParam, int lonCellParam, qint64 nowMs) const
+{
+  for(int band = 0; band < numBands; band++)
+  {
+    auto it = cells.constFind(key(latCellParam, lonCellParam, band));
+    if(it != cells.constEnd() && nowMs - it->recordedMs <= maxAgeMs)
+      return &it.value();
+  }
+  return nullptr;
+}
+
+bool WeatherCache::lookup(const QString& ident, const atools::geo::Pos& pos,
+                          atools::fs::sc::MetarResult& result) const
+{
+  if(!pos.isValid() || cells.isEmpty())
+    return false;
+
+  qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+  int latC = latCell(pos.getLatY()), lonC = lonCell(pos.getLonX());
+
+  const Sample *sample = findCell(latC, lonC, nowMs);
+  const Sample *nearest = sample;
+  if(nearest == nullptr)
+  {
+    // Freshest sample of the eight neighbours
+    for(int latOffset = -1; latOffset <= 1; latOffset++)
+    {
+      int lat = latC + latOffset;
+      if(lat < 0 || lat >= numLatCells)
+        continue;
+
+      for(int lonOffset = -1; lonOffset <= 1; lonOffset++)
+      {
+        const Sample *neighbour = findCell(lat, (lonC + lonOffset + numLonCells) % numLonCells, nowMs);
+        if(neighbour != nullptr && (nearest == nullptr || neighbour->recordedMs > nearest->recordedMs))
+          nearest = neighbour;
+      }
+    }
+  }
+
+  if(nearest == nullptr)
+    return false;
+
+  result.requestIdent = ident;
+  result.requestPos = pos;
+  result.timestamp = nearest->zuluTime.isValid() ? nearest->zuluTime : QDateTime::currentDateTimeUtc();
+  result.metarForNearest = metar(ident, *nearest);
+  if(sample != nullptr)
+  {
+    // Cell contains the position
+    result.metarForStation = result.metarForNearest;
+    result.metarForInterpolated = result.metarForNearest;
+  }
+  return true;
+}
+
+QString WeatherCache::metar(const QString& ident, const Sample& sample)
+{
+  // "EDDF 121350Z 27015KT 9999 12/// Q1013"
+  QDateTime time = sample.zuluTime.isValid() ? sample.zuluTime : QDateTime::fromMSecsSinceEpoch(sample.recordedMs,
+                                                                                                  Qt::UTC);
+  QString text = ident.isEmpty() ? QString("XXXX") : ident.toUpper();
+  text.append(' ').append(time.toString("ddHHmm")).append("Z ");
+
+  int speed = static_cast<int>(std::round(sample.windSpeedKts));
+  if(speed < 1)
+    text.append("00000KT ");
+  else
+  {
+    int direction = static_cast<int>(std::round(sample.windDirectionDegT / 10.f)) * 10 % 360;
+    text.append(QString("%1%2KT ").arg(direction == 0 ? 360 : direction, 3, 10, QChar('0')).
+                arg(speed, 2, 10, QChar('0')));
+  }
+
+  int visibility = std::min(static_cast<int>(sample.visibilityMeter), 9999);
+  if(visibility > 0)
+    text.append(QString("%1 ").arg(visibility, 4, 10, QChar('0')));
+
+  int temperature = static_cast<int>(std::round(sample.surfaceTemperatureCelsius));
+  text.append(QString("%1%2/// ").arg(temperature < 0 ? "M" : "").arg(std::abs(temperature), 2, 10, QChar('0')));
+
+  text.append(QString("Q%1").arg(static_cast<int>(std::round(sample.seaLevelPressureMbar)), 4, 10, QChar('0')));
+  return text;
+}
+
+} // namespace lfgc
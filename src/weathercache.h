@@ -0,0 +1,106 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLEFGCONNECT_WEATHERCACHE_H
+#define LITTLEFGCONNECT_WEATHERCACHE_H
+
+#include <QDateTime>
+#include <QHash>
+
+namespace atools {
+namespace geo {
+class Pos;
+}
+namespace fs {
+namespace sc {
+class SimConnectUserAircraft;
+struct MetarResult;
+}
+}
+}
+
+namespace lfgc {
+
+/*
+ * Answers weather requests from the ambient values which FlightGear sends for the user aircraft.
+ *
+ * Samples are kept in a grid of cells keyed by latitude, longitude and altitude band. A sample overwrites
+ * the older one of the same cell. Requests are answered from the cell containing the requested position
+ * and its direct neighbours, which is constant time. The lowest band wins since METAR describe the surface.
+ * Temperature is reduced to the ground with the standard lapse rate and dewpoint is reported as missing.
+ *
+ * Samples older than maxAgeSeconds are ignored and removed.
+ *
+ * Not thread safe.
+ */
+class WeatherCache
+{
+public:
+  explicit WeatherCache(float cellSizeDegParam = 0.5f, float bandFtParam = 3000.f, int maxAgeSecondsParam = 3600);
+
+  /* Store the ambient values at the position of the user aircraft */
+  void record(const atools::fs::sc::SimConnectUserAircraft& aircraft);
+
+  /* Fill METAR strings for the station ident at pos. Returns false if no sample is near. */
+  bool lookup(const QString& ident, const atools::geo::Pos& pos, atools::fs::sc::MetarResult& result) const;
+
+  void clear()
+  {
+    cells.clear();
+  }
+
+  int size() const
+  {
+    return cells.size();
+  }
+
+private:
+  struct Sample
+  {
+    /* Simulator time for the METAR and system time for expiry */
+    QDateTime zuluTime;
+    qint64 recordedMs = 0;
+
+    float windDirectionDegT = 0.f, windSpeedKts = 0.f, surfaceTemperatureCelsius = 0.f,
+          seaLevelPressureMbar = 0.f, visibilityMeter = 0.f;
+  };
+
+  /* Get sample of lowest band in cell or null if none or expired */
+  const Sample *findCell(int latCell, int lonCell, qint64 nowMs) const;
+
+  quint64 key(int latCell, int lonCell, int band) const;
+  int latCell(float latY) const;
+  int lonCell(float lonX) const;
+
+  /* Remove expired samples */
+  void expire(qint64 nowMs);
+
+  static QString metar(const QString& ident, const Sample& sample);
+
+  float cellSizeDeg, bandFt;
+  int numLonCells, numLatCells, numBands;
+  qint64 maxAgeMs;
+
+  QHash<quint64, Sample> cells;
+  int recordsSinceExpire = 0;
+};
+
+} // namespace lfgc
+
+#endif // LITTLEFGCONNECT_WEATHERCACHE_H
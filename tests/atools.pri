@@ -0,0 +1,36 @@
+#*****************************************************************************
+# Copyright 2020 Alexander Barthel alex@littlenavmap.org
+#                Slawek Mikula slawek.mikula@gmail.com
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#****************************************************************************
+
+# Include and library paths of atools for tests which use its types.
+# Uses the same environment variables ATOOLS_INC_PATH and ATOOLS_LIB_PATH as littlefgconnect.pro.
+
+ATOOLS_INC_PATH=$$(ATOOLS_INC_PATH)
+ATOOLS_LIB_PATH=$$(ATOOLS_LIB_PATH)
+
+CONFIG(debug, debug|release) : CONF_TYPE=debug
+CONFIG(release, debug|release) : CONF_TYPE=release
+
+isEmpty(ATOOLS_INC_PATH) : ATOOLS_INC_PATH=$$PWD/../../atools/src
+isEmpty(ATOOLS_LIB_PATH) : ATOOLS_LIB_PATH=$$PWD/../../build-atools-$$CONF_TYPE
+
+unix:!macx : QMAKE_LFLAGS += -no-pie
+
+LIBS += -L$$ATOOLS_LIB_PATH -latools
+PRE_TARGETDEPS += $$ATOOLS_LIB_PATH/libatools.a
+DEPENDPATH += $$ATOOLS_INC_PATH
+INCLUDEPATH += $$ATOOLS_INC_PATH
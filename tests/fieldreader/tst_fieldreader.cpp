@@ -0,0 +1,231 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "fieldreader.h"
+#include "stringpool.h"
+
+#include <QtTest>
+
+using lfgc::FieldReader;
+using lfgc::StringPool;
+
+class FieldReaderTest :
+  public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void emptyBuffer();
+  void emptyFields();
+  void missingFields();
+  void readDouble();
+  void readDouble_data();
+  void readInt();
+  void readInt_data();
+  void rawView();
+  void internShared();
+  void internUtf8();
+  void internEmpty();
+  void internGrowAndClear();
+};
+
+void FieldReaderTest::emptyBuffer()
+{
+  QByteArray buffer;
+  FieldReader reader(buffer, ',');
+  QVERIFY(reader.next());
+  QVERIFY(reader.isFieldEmpty());
+  QVERIFY(!reader.next());
+  QCOMPARE(reader.readFloat(), 0.f);
+  QCOMPARE(reader.readInt(), 0);
+}
+
+void FieldReaderTest::emptyFields()
+{
+  QByteArray buffer("1,,3,");
+  FieldReader reader(buffer, ',');
+  QCOMPARE(reader.readInt(), 1);
+  QCOMPARE(reader.readDouble(), 0.);
+  QVERIFY(reader.isFieldEmpty());
+  QCOMPARE(reader.readInt(), 3);
+
+  // Separator at the end gives one more empty field
+  QVERIFY(reader.next());
+  QVERIFY(reader.isFieldEmpty());
+  QVERIFY(!reader.next());
+}
+
+void FieldReaderTest::missingFields()
+{
+  QByteArray buffer("1.5;C172");
+  StringPool pool;
+  FieldReader reader(buffer, ';');
+  QCOMPARE(reader.readFloat(), 1.5f);
+  QCOMPARE(reader.readString(pool), QStringLiteral("C172"));
+
+  // Truncated datagram - all missing fields are empty
+  QCOMPARE(reader.readFloat(), 0.f);
+  QCOMPARE(reader.readInt(), 0);
+  QVERIFY(reader.readString(pool).isEmpty());
+  QVERIFY(reader.readRaw().isEmpty());
+}
+
+void FieldReaderTest::readDouble_data()
+{
+  QTest::addColumn<QByteArray>("field");
+  QTest::addColumn<double>("expected");
+
+  QTest::newRow("integer") << QByteArray("42") << 42.;
+  QTest::newRow("fraction") << QByteArray("12.375") << 12.375;
+  QTest::newRow("negative") << QByteArray("-0.5") << -0.5;
+  QTest::newRow("plus") << QByteArray("+7.25") << 7.25;
+  QTest::newRow("no integer part") << QByteArray(".5") << .5;
+  QTest::newRow("no fraction part") << QByteArray("5.") << 5.;
+  QTest::newRow("line feed") << QByteArray(" 3.5\r\n") << 3.5;
+  QTest::newRow("exponent") << QByteArray("1.5e3") << 1500.;
+  QTest::newRow("long fraction") << QByteArray("0.1234567890123456789012") << 0.123456789012345678;
+  QTest::newRow("empty") << QByteArray("") << 0.;
+  QTest::newRow("blank") << QByteArray("  ") << 0.;
+  QTest::newRow("sign only") << QByteArray("-") << 0.;
+  QTest::newRow("dot only") << QByteArray(".") << 0.;
+  QTest::newRow("two dots") << QByteArray("1.2.3") << 0.;
+  QTest::newRow("garbage") << QByteArray("abc") << 0.;
+  QTest::newRow("trailing garbage") << QByteArray("12abc") << 0.;
+  QTest::newRow("comma") << QByteArray("1,5") << 0.;
+}
+
+void FieldReaderTest::readDouble()
+{
+  QFETCH(QByteArray, field);
+  QFETCH(double, expected);
+
+  QByteArray buffer = field + ";next";
+  FieldReader reader(buffer, ';');
+  QCOMPARE(reader.readDouble(), expected);
+  QCOMPARE(reader.readRaw(), QByteArray("next"));
+  QCOMPARE(FieldReader::parseDouble(field.constData(), field.size()), expected);
+}
+
+void FieldReaderTest::readInt_data()
+{
+  QTest::addColumn<QByteArray>("field");
+  QTest::addColumn<int>("expected");
+
+  QTest::newRow("integer") << QByteArray("7200") << 7200;
+  QTest::newRow("negative") << QByteArray("-3600") << -3600;
+  QTest::newRow("plus") << QByteArray("+1") << 1;
+  QTest::newRow("line feed") << QByteArray("1\n") << 1;
+  QTest::newRow("maximum") << QByteArray("2147483647") << 2147483647;
+  QTest::newRow("minimum") << QByteArray("-2147483648") << -2147483647 - 1;
+
+  // Same as QString::toInt()
+  QTest::newRow("fraction") << QByteArray("7200.5") << 0;
+  QTest::newRow("exponent") << QByteArray("1e3") << 0;
+  QTest::newRow("overflow") << QByteArray("2147483648") << 0;
+  QTest::newRow("long overflow") << QByteArray("99999999999999999999") << 0;
+  QTest::newRow("empty") << QByteArray("") << 0;
+  QTest::newRow("sign only") << QByteArray("-") << 0;
+  QTest::newRow("garbage") << QByteArray("abc") << 0;
+}
+
+void FieldReaderTest::readInt()
+{
+  QFETCH(QByteArray, field);
+  QFETCH(int, expected);
+
+  FieldReader reader(field, ',');
+  QCOMPARE(reader.readInt(), expected);
+  QCOMPARE(QString::fromLatin1(field).toInt(), expected);
+  QCOMPARE(FieldReader::parseInt(field.constData(), field.size()), expected);
+}
+
+void FieldReaderTest::rawView()
+{
+  QByteArray buffer("ab;cd;rest;of;it");
+  FieldReader reader(buffer, ';');
+  reader.skip();
+  QByteArray raw = reader.readRaw();
+  QCOMPARE(raw, QByteArray("cd"));
+
+  // No copy of the buffer
+  QCOMPARE(raw.constData(), buffer.constData() + 3);
+  QCOMPARE(reader.remainingBegin(), buffer.constData() + 6);
+  QCOMPARE(reader.bufferEnd(), buffer.constData() + buffer.size());
+}
+
+void FieldReaderTest::internShared()
+{
+  StringPool pool;
+  QByteArray buffer("D-EFGH;D-EFGH;N123AB");
+  FieldReader reader(buffer, ';');
+
+  QString first = reader.readString(pool);
+  QString second = reader.readString(pool);
+  QString third = reader.readString(pool);
+  QCOMPARE(first, QStringLiteral("D-EFGH"));
+  QCOMPARE(third, QStringLiteral("N123AB"));
+
+  // Second occurrence returns the same shared string
+  QCOMPARE(first.constData(), second.constData());
+  QCOMPARE(pool.size(), 2);
+}
+
+void FieldReaderTest::internUtf8()
+{
+  StringPool pool;
+  QByteArray utf8 = QStringLiteral("Zürich Kloten").toUtf8();
+  QCOMPARE(pool.intern(utf8), QStringLiteral("Zürich Kloten"));
+
+  // Prefix is a different key
+  QCOMPARE(pool.intern(utf8.constData(), 3), QStringLiteral("Zü"));
+  QCOMPARE(pool.size(), 2);
+}
+
+void FieldReaderTest::internEmpty()
+{
+  StringPool pool;
+  QVERIFY(pool.intern(QByteArray()).isEmpty());
+  QVERIFY(pool.intern("abc", 0).isEmpty());
+  QCOMPARE(pool.size(), 0);
+}
+
+void FieldReaderTest::internGrowAndClear()
+{
+  StringPool pool(1000);
+  QVector<QString> strings;
+  for(int i = 0; i < 1000; i++)
+    strings.append(pool.intern(QByteArray::number(i)));
+  QCOMPARE(pool.size(), 1000);
+
+  // Found again after growing
+  for(int i = 0; i < 1000; i++)
+    QCOMPARE(pool.intern(QByteArray::number(i)).constData(), strings.at(i).constData());
+
+  // Full pool is emptied before adding a new string
+  QCOMPARE(pool.intern(QByteArray("new")), QStringLiteral("new"));
+  QCOMPARE(pool.size(), 1);
+
+  pool.clear();
+  QCOMPARE(pool.size(), 0);
+  QCOMPARE(pool.intern(QByteArray("1")), QStringLiteral("1"));
+}
+
+QTEST_APPLESS_MAIN(FieldReaderTest)
+
+#include "tst_fieldreader.moc"
@@ -0,0 +1,341 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "flightrecordreader.h"
+
+#include <QtTest>
+
+#include <cstring>
+
+using lfgc::FlightRecordReader;
+using lfgc::RecorderFrame;
+
+static const qint64 START_MS = 1600000000000LL;
+static const qint64 STEP_MS = 200;
+
+class FlightRecordReaderTest :
+  public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void readFrames();
+  void findRow();
+  void value();
+  void readColumn();
+  void truncatedChunk();
+  void truncatedChunkHeader();
+  void zeroSizeChunk();
+  void invalidHeader();
+
+private:
+  /* Frame with values derived from the row number */
+  static RecorderFrame frameForRow(int row);
+
+  /* Header, columns and one chunk for each entry in chunkRows with the given number of rows */
+  static QByteArray recording(const QVector<int>& chunkRows);
+
+  /* Chunk of the rows starting at firstRow in the file layout */
+  static QByteArray chunk(int firstRow, int numRows);
+
+  static bool writeFile(const QString& filename, const QByteArray& bytes);
+
+  QTemporaryDir tempDir;
+};
+
+RecorderFrame FlightRecordReaderTest::frameForRow(int row)
+{
+  RecorderFrame frame;
+  std::memset(&frame, 0, sizeof(frame));
+  frame.timestampMs = START_MS + row * STEP_MS;
+  frame.lonX = 8. + row * 0.01;
+  frame.latY = 47. + row * 0.001;
+  frame.indicatedAltitudeFt = 1000.f + row;
+  frame.groundSpeedKts = row * 0.5f;
+  frame.seaLevelPressureMbar = 1013.f;
+  frame.flags = static_cast<quint32>(row);
+  return frame;
+}
+
+QByteArray FlightRecordReaderTest::chunk(int firstRow, int numRows)
+{
+  int rowSize = 0;
+  for(int i = 0; i < lfgc::REC_NUM_COLUMNS; i++)
+    rowSize += lfgc::recorderColumnInfo(i).size;
+
+  lfgc::RecorderChunkHeader header;
+  header.magic = lfgc::RECORDER_CHUNK_MAGIC;
+  header.numRows = static_cast<quint32>(numRows);
+  header.firstTimestampMs = frameForRow(firstRow).timestampMs;
+  header.lastTimestampMs = frameForRow(firstRow + numRows - 1).timestampMs;
+  header.byteSize = sizeof(header) + static_cast<quint64>(rowSize * numRows);
+
+  QByteArray bytes(reinterpret_cast<const char *>(&header), sizeof(header));
+  for(int i = 0; i < lfgc::REC_NUM_COLUMNS; i++)
+  {
+    const lfgc::RecorderColumnInfo& info = lfgc::recorderColumnInfo(i);
+    for(int row = firstRow; row < firstRow + numRows; row++)
+    {
+      RecorderFrame frame = frameForRow(row);
+      bytes.append(reinterpret_cast<const char *>(&frame) + info.frameOffset, info.size);
+    }
+  }
+  return bytes;
+}
+
+QByteArray FlightRecordReaderTest::recording(const QVector<int>& chunkRows)
+{
+  lfgc::RecorderFileHeader header;
+  header.magic = lfgc::RECORDER_FILE_MAGIC;
+  header.version = lfgc::RECORDER_FILE_VERSION;
+  header.numColumns = lfgc::REC_NUM_COLUMNS;
+  header.reserved = 0;
+  QByteArray bytes(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  for(int i = 0; i < lfgc::REC_NUM_COLUMNS; i++)
+  {
+    const lfgc::RecorderColumnInfo& info = lfgc::recorderColumnInfo(i);
+    lfgc::RecorderFileColumn column;
+    std::memset(&column, 0, sizeof(column));
+    std::strncpy(column.name, info.name, sizeof(column.name) - 1);
+    column.type = info.type;
+    column.size = static_cast<quint32>(info.size);
+    bytes.append(reinterpret_cast<const char *>(&column), sizeof(column));
+  }
+
+  int row = 0;
+  for(int numRows : chunkRows)
+  {
+    bytes.append(chunk(row, numRows));
+    row += numRows;
+  }
+  return bytes;
+}
+
+bool FlightRecordReaderTest::writeFile(const QString& filename, const QByteArray& bytes)
+{
+  QFile file(filename);
+  return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size();
+}
+
+void FlightRecordReaderTest::readFrames()
+{
+  QString filename = tempDir.filePath("frames.lfgr");
+  QVERIFY(writeFile(filename, recording({4, 3, 5})));
+
+  FlightRecordReader reader;
+  QVERIFY(reader.open(filename));
+  QCOMPARE(reader.size(), 12);
+  QCOMPARE(reader.getFirstTimestampMs(), START_MS);
+  QCOMPARE(reader.getLastTimestampMs(), START_MS + 11 * STEP_MS);
+
+  for(int row = 0; row < reader.size(); row++)
+  {
+    RecorderFrame frame, expected = frameForRow(row);
+    QVERIFY(reader.readFrame(row, frame));
+    QCOMPARE(frame.timestampMs, expected.timestampMs);
+    QCOMPARE(frame.lonX, expected.lonX);
+    QCOMPARE(frame.latY, expected.latY);
+    QCOMPARE(frame.indicatedAltitudeFt, expected.indicatedAltitudeFt);
+    QCOMPARE(frame.groundSpeedKts, expected.groundSpeedKts);
+    QCOMPARE(frame.seaLevelPressureMbar, expected.seaLevelPressureMbar);
+    QCOMPARE(frame.flags, expected.flags);
+  }
+
+  RecorderFrame frame;
+  QVERIFY(!reader.readFrame(-1, frame));
+  QVERIFY(!reader.readFrame(12, frame));
+}
+
+void FlightRecordReaderTest::findRow()
+{
+  QString filename = tempDir.filePath("find.lfgr");
+  QVERIFY(writeFile(filename, recording({4, 3, 5})));
+
+  FlightRecordReader reader;
+  QVERIFY(reader.open(filename));
+
+  QCOMPARE(reader.findRow(START_MS - 1000), 0);
+  QCOMPARE(reader.findRow(START_MS), 0);
+  QCOMPARE(reader.findRow(START_MS + 5 * STEP_MS), 5);
+  QCOMPARE(reader.findRow(START_MS + 5 * STEP_MS + 1), 6);
+
+  // Between the last row of the first chunk and the first of the second
+  QCOMPARE(reader.findRow(START_MS + 3 * STEP_MS + 1), 4);
+  QCOMPARE(reader.findRow(START_MS + 4 * STEP_MS), 4);
+
+  QCOMPARE(reader.findRow(START_MS + 11 * STEP_MS), 11);
+  QCOMPARE(reader.findRow(START_MS + 11 * STEP_MS + 1), reader.size());
+}
+
+void FlightRecordReaderTest::value()
+{
+  QString filename = tempDir.filePath("value.lfgr");
+  QVERIFY(writeFile(filename, recording({4, 3, 5})));
+
+  FlightRecordReader reader;
+  QVERIFY(reader.open(filename));
+
+  bool ok = false;
+  QCOMPARE(reader.value(lfgc::REC_TIMESTAMP, 6, &ok), static_cast<double>(START_MS + 6 * STEP_MS));
+  QVERIFY(ok);
+  QCOMPARE(reader.value(lfgc::REC_LATY, 9, &ok), frameForRow(9).latY);
+  QVERIFY(ok);
+  QCOMPARE(reader.value(lfgc::REC_INDICATED_ALTITUDE, 3), 1003.);
+  QCOMPARE(reader.value(lfgc::REC_FLAGS, 11), 11.);
+
+  QCOMPARE(reader.value(lfgc::REC_LATY, 12, &ok), 0.);
+  QVERIFY(!ok);
+  QCOMPARE(reader.value(lfgc::REC_LATY, -1, &ok), 0.);
+  QVERIFY(!ok);
+  QCOMPARE(reader.value(lfgc::REC_NUM_COLUMNS, 0, &ok), 0.);
+  QVERIFY(!ok);
+  QCOMPARE(reader.value(-1, 0, &ok), 0.);
+  QVERIFY(!ok);
+}
+
+void FlightRecordReaderTest::readColumn()
+{
+  QString filename = tempDir.filePath("column.lfgr");
+  QVERIFY(writeFile(filename, recording({4, 3, 5})));
+
+  FlightRecordReader reader;
+  QVERIFY(reader.open(filename));
+
+  // Appends across all three chunks
+  QVector<double> values({-1.});
+  reader.readColumn(lfgc::REC_LATY, 2, 8, values);
+  QCOMPARE(values.size(), 9);
+  QCOMPARE(values.at(0), -1.);
+  for(int i = 1; i < values.size(); i++)
+    QCOMPARE(values.at(i), frameForRow(i + 1).latY);
+
+  // Clipped at the end
+  values.clear();
+  reader.readColumn(lfgc::REC_TIMESTAMP, 10, 5, values);
+  QCOMPARE(values, QVector<double>({static_cast<double>(START_MS + 10 * STEP_MS),
+                                    static_cast<double>(START_MS + 11 * STEP_MS)}));
+
+  values.clear();
+  reader.readColumn(lfgc::REC_GROUND_SPEED, 0, 12, values);
+  QCOMPARE(values.size(), 12);
+  QCOMPARE(values.at(7), 3.5);
+
+  // Nothing for invalid ranges
+  values.clear();
+  reader.readColumn(lfgc::REC_LATY, 12, 3, values);
+  reader.readColumn(lfgc::REC_LATY, -1, 3, values);
+  reader.readColumn(lfgc::REC_LATY, 0, 0, values);
+  reader.readColumn(lfgc::REC_NUM_COLUMNS, 0, 3, values);
+  QVERIFY(values.isEmpty());
+}
+
+void FlightRecordReaderTest::truncatedChunk()
+{
+  // Last chunk cut by a crash - the complete chunks are still readable
+  QByteArray bytes = recording({4, 3, 5});
+  bytes.chop(10);
+  QString filename = tempDir.filePath("truncated.lfgr");
+  QVERIFY(writeFile(filename, bytes));
+
+  FlightRecordReader reader;
+  QVERIFY(reader.open(filename));
+  QCOMPARE(reader.size(), 7);
+  QCOMPARE(reader.getLastTimestampMs(), START_MS + 6 * STEP_MS);
+  QCOMPARE(reader.findRow(START_MS + 8 * STEP_MS), 7);
+
+  RecorderFrame frame;
+  QVERIFY(reader.readFrame(6, frame));
+  QCOMPARE(frame.latY, frameForRow(6).latY);
+  QVERIFY(!reader.readFrame(7, frame));
+
+  bool ok = true;
+  reader.value(lfgc::REC_LATY, 7, &ok);
+  QVERIFY(!ok);
+
+  QVector<double> values;
+  reader.readColumn(lfgc::REC_FLAGS, 5, 10, values);
+  QCOMPARE(values, QVector<double>({5., 6.}));
+}
+
+void FlightRecordReaderTest::truncatedChunkHeader()
+{
+  // Only a part of the header of the last chunk was written
+  QByteArray bytes = recording({4, 3});
+  bytes.append(chunk(7, 5).left(static_cast<int>(sizeof(lfgc::RecorderChunkHeader) / 2)));
+  QString filename = tempDir.filePath("truncatedheader.lfgr");
+  QVERIFY(writeFile(filename, bytes));
+
+  FlightRecordReader reader;
+  QVERIFY(reader.open(filename));
+  QCOMPARE(reader.size(), 7);
+  QCOMPARE(reader.getLastTimestampMs(), START_MS + 6 * STEP_MS);
+}
+
+void FlightRecordReaderTest::zeroSizeChunk()
+{
+  lfgc::RecorderChunkHeader header;
+  header.magic = lfgc::RECORDER_CHUNK_MAGIC;
+  header.numRows = 0;
+  header.firstTimestampMs = header.lastTimestampMs = START_MS;
+  header.byteSize = 0;
+
+  // Reading stops at the invalid chunk and ignores everything behind it
+  QByteArray bytes = recording({4});
+  bytes.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  bytes.append(chunk(4, 3));
+  QString filename = tempDir.filePath("zerosize.lfgr");
+  QVERIFY(writeFile(filename, bytes));
+
+  FlightRecordReader reader;
+  QVERIFY(reader.open(filename));
+  QCOMPARE(reader.size(), 4);
+  QCOMPARE(reader.findRow(START_MS + 10 * STEP_MS), 4);
+
+  // Size does not match the number of rows
+  reader.close();
+  header.numRows = 3;
+  header.byteSize = sizeof(header);
+  bytes = recording({4});
+  bytes.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  QVERIFY(writeFile(filename, bytes));
+
+  QVERIFY(reader.open(filename));
+  QCOMPARE(reader.size(), 4);
+}
+
+void FlightRecordReaderTest::invalidHeader()
+{
+  QByteArray bytes = recording({4});
+  bytes[0] = 'X';
+  QString filename = tempDir.filePath("invalid.lfgr");
+  QVERIFY(writeFile(filename, bytes));
+
+  FlightRecordReader reader;
+  QVERIFY(!reader.open(filename));
+  QCOMPARE(reader.size(), 0);
+
+  // Too small for the column table
+  QVERIFY(writeFile(filename, recording({}).left(static_cast<int>(sizeof(lfgc::RecorderFileHeader)) + 4)));
+  QVERIFY(!reader.open(filename));
+
+  QVERIFY(!reader.open(tempDir.filePath("missing.lfgr")));
+}
+
+QTEST_GUILESS_MAIN(FlightRecordReaderTest)
+
+#include "tst_flightrecordreader.moc"
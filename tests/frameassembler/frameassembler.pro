@@ -0,0 +1,43 @@
+#*****************************************************************************
+# Copyright 2020 Alexander Barthel alex@littlenavmap.org
+#                Slawek Mikula slawek.mikula@gmail.com
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#****************************************************************************
+
+# Unit tests for the reassembly of framed datagrams.
+
+QT += core testlib
+QT -= gui
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle debug_and_release debug_and_release_target
+
+TARGET = tst_frameassembler
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/../../src
+DEFINES += QT_NO_CAST_FROM_BYTEARRAY
+DEFINES += QT_NO_CAST_TO_ASCII
+
+SOURCES += \
+  ../../src/fieldreader.cpp \
+  ../../src/frameassembler.cpp \
+  ../../src/stringpool.cpp \
+  tst_frameassembler.cpp
+
+HEADERS += \
+  ../../src/fieldreader.h \
+  ../../src/frameassembler.h \
+  ../../src/stringpool.h
@@ -0,0 +1,246 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "frameassembler.h"
+
+#include <QtTest>
+
+using lfgc::FrameAssembler;
+
+class FrameAssemblerTest :
+  public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void notFramed();
+  void singleFragment();
+  void reassembleReordered();
+  void duplicateFragment();
+  void invalidHeader();
+  void evictOldest();
+  void timeoutPartial();
+  void staleFrame();
+  void sequenceWrap();
+  void restartBackwardJump();
+  void restartStaleRun();
+  void restartReceiveGap();
+  void resetStatistics();
+
+private:
+  /* Payload which needs count fragments of size 10 */
+  static QByteArray payload(int count);
+  static QVector<QByteArray> split(const QByteArray& data, quint32 sequence);
+
+  /* Add a single fragment frame and return true if it was published */
+  static bool addSingle(FrameAssembler& assembler, quint32 sequence, qint64 nowMs);
+};
+
+QByteArray FrameAssemblerTest::payload(int count)
+{
+  QByteArray data;
+  for(int i = 0; i < count * 10; i++)
+    data.append(static_cast<char>('a' + i % 26));
+  return data;
+}
+
+QVector<QByteArray> FrameAssemblerTest::split(const QByteArray& data, quint32 sequence)
+{
+  // 24 bytes are reserved for the header
+  return FrameAssembler::split(data, sequence, 34);
+}
+
+bool FrameAssemblerTest::addSingle(FrameAssembler& assembler, quint32 sequence, qint64 nowMs)
+{
+  QByteArray frame;
+  return assembler.addDatagram(FrameAssembler::split(QByteArray("x"), sequence, 1400).constFirst(), nowMs, frame);
+}
+
+void FrameAssemblerTest::notFramed()
+{
+  QVERIFY(!FrameAssembler::isFramed(QByteArray("1.0,2.0,3.0")));
+  QVERIFY(FrameAssembler::isFramed(FrameAssembler::split(QByteArray("abc"), 1, 1400).constFirst()));
+}
+
+void FrameAssemblerTest::singleFragment()
+{
+  FrameAssembler assembler;
+  QVector<QByteArray> datagrams = FrameAssembler::split(QByteArray("abc;def"), 7, 1400);
+  QCOMPARE(datagrams.size(), 1);
+
+  QByteArray frame;
+  QVERIFY(assembler.addDatagram(datagrams.constFirst(), 0, frame));
+  QCOMPARE(frame, QByteArray("abc;def"));
+  QCOMPARE(assembler.getStatistics().completed, quint64(1));
+}
+
+void FrameAssemblerTest::reassembleReordered()
+{
+  FrameAssembler assembler;
+  QByteArray data = payload(10);
+  QVector<QByteArray> datagrams = split(data, 1);
+  QCOMPARE(datagrams.size(), 10);
+
+  QByteArray frame;
+  for(int i = datagrams.size() - 1; i > 0; i--)
+    QVERIFY(!assembler.addDatagram(datagrams.at(i), 0, frame));
+  QVERIFY(assembler.addDatagram(datagrams.at(0), 0, frame));
+  QCOMPARE(frame, data);
+}
+
+void FrameAssemblerTest::duplicateFragment()
+{
+  FrameAssembler assembler;
+  QVector<QByteArray> datagrams = split(payload(3), 1);
+
+  QByteArray frame;
+  QVERIFY(!assembler.addDatagram(datagrams.at(0), 0, frame));
+  QVERIFY(!assembler.addDatagram(datagrams.at(0), 0, frame));
+  QCOMPARE(assembler.getStatistics().duplicates, quint64(1));
+
+  QVERIFY(!assembler.addDatagram(datagrams.at(1), 0, frame));
+  QVERIFY(assembler.addDatagram(datagrams.at(2), 0, frame));
+  QCOMPARE(frame, payload(3));
+
+  // Fragment of the completed frame arriving late
+  QVERIFY(!assembler.addDatagram(datagrams.at(1), 0, frame));
+  QCOMPARE(assembler.getStatistics().stale, quint64(1));
+}
+
+void FrameAssemblerTest::invalidHeader()
+{
+  FrameAssembler assembler;
+  QByteArray frame;
+  QVERIFY(!assembler.addDatagram(QByteArray("LFGF;x;0;1;abc"), 0, frame));
+  QVERIFY(!assembler.addDatagram(QByteArray("LFGF;1;2;2;abc"), 0, frame));
+  QVERIFY(!assembler.addDatagram(QByteArray("LFGF;1;0;0;abc"), 0, frame));
+  QVERIFY(!assembler.addDatagram(QByteArray("LFGF;1;0;65;abc"), 0, frame));
+  QVERIFY(!assembler.addDatagram(QByteArray("LFGF;1"), 0, frame));
+  QCOMPARE(assembler.getStatistics().invalid, quint64(5));
+
+  // Same sequence with a different fragment count
+  QVERIFY(!assembler.addDatagram(QByteArray("LFGF;2;0;2;abc"), 0, frame));
+  QVERIFY(!assembler.addDatagram(QByteArray("LFGF;2;0;3;abc"), 0, frame));
+  QCOMPARE(assembler.getStatistics().invalid, quint64(6));
+}
+
+void FrameAssemblerTest::evictOldest()
+{
+  FrameAssembler assembler;
+  QByteArray frame;
+
+  // One more partial frame than slots
+  for(quint32 sequence = 1; sequence <= 9; sequence++)
+    QVERIFY(!assembler.addDatagram(split(payload(2), sequence).at(0), 0, frame));
+  QCOMPARE(assembler.getStatistics().evicted, quint64(1));
+
+  // Sequence 1 was dropped and starts over which drops sequence 2 - sequence 3 is still complete
+  QVERIFY(!assembler.addDatagram(split(payload(2), 1).at(1), 0, frame));
+  QCOMPARE(assembler.getStatistics().evicted, quint64(2));
+  QVERIFY(assembler.addDatagram(split(payload(2), 3).at(1), 0, frame));
+  QCOMPARE(frame, payload(2));
+}
+
+void FrameAssemblerTest::timeoutPartial()
+{
+  FrameAssembler assembler(500);
+  QVector<QByteArray> datagrams = split(payload(2), 1);
+
+  QByteArray frame;
+  QVERIFY(!assembler.addDatagram(datagrams.at(0), 0, frame));
+  QVERIFY(!assembler.addDatagram(datagrams.at(1), 501, frame));
+  QCOMPARE(assembler.getStatistics().timedOut, quint64(1));
+  QCOMPARE(assembler.getStatistics().completed, quint64(0));
+}
+
+void FrameAssemblerTest::staleFrame()
+{
+  FrameAssembler assembler;
+  QVERIFY(addSingle(assembler, 5, 0));
+  QVERIFY(!addSingle(assembler, 4, 0));
+  QVERIFY(!addSingle(assembler, 5, 0));
+  QCOMPARE(assembler.getStatistics().stale, quint64(2));
+  QVERIFY(addSingle(assembler, 6, 0));
+
+  // Partial frame older than a completed one is dropped
+  QByteArray frame;
+  QVERIFY(!assembler.addDatagram(split(payload(2), 7).at(0), 0, frame));
+  QVERIFY(addSingle(assembler, 8, 0));
+  QCOMPARE(assembler.getStatistics().stale, quint64(3));
+  QCOMPARE(assembler.getStatistics().restarts, quint64(0));
+}
+
+void FrameAssemblerTest::sequenceWrap()
+{
+  FrameAssembler assembler;
+  QVERIFY(addSingle(assembler, 0xffffffff, 0));
+  QVERIFY(addSingle(assembler, 0, 0));
+  QVERIFY(!addSingle(assembler, 0xfffffffe, 0));
+  QCOMPARE(assembler.getStatistics().restarts, quint64(0));
+}
+
+void FrameAssemblerTest::restartBackwardJump()
+{
+  FrameAssembler assembler;
+  QVERIFY(addSingle(assembler, 5000, 0));
+  QVERIFY(addSingle(assembler, 0, 10));
+  QVERIFY(addSingle(assembler, 1, 20));
+  QCOMPARE(assembler.getStatistics().restarts, quint64(1));
+}
+
+void FrameAssemblerTest::restartStaleRun()
+{
+  FrameAssembler assembler;
+  QVERIFY(addSingle(assembler, 100, 0));
+
+  // Sender restarted shortly before - only a run of stale frames tells
+  for(quint32 sequence = 1; sequence < 16; sequence++)
+    QVERIFY(!addSingle(assembler, sequence, 0));
+  QVERIFY(addSingle(assembler, 16, 0));
+  QVERIFY(addSingle(assembler, 17, 0));
+  QCOMPARE(assembler.getStatistics().stale, quint64(15));
+  QCOMPARE(assembler.getStatistics().restarts, quint64(1));
+}
+
+void FrameAssemblerTest::restartReceiveGap()
+{
+  FrameAssembler assembler(500);
+  QVERIFY(addSingle(assembler, 100, 0));
+  QVERIFY(!addSingle(assembler, 99, 2000));
+  QVERIFY(addSingle(assembler, 98, 2001));
+  QCOMPARE(assembler.getStatistics().restarts, quint64(1));
+}
+
+void FrameAssemblerTest::resetStatistics()
+{
+  FrameAssembler assembler;
+  QVERIFY(addSingle(assembler, 5, 0));
+  QVERIFY(!addSingle(assembler, 5, 0));
+
+  assembler.reset();
+  QCOMPARE(assembler.getStatistics().completed, quint64(0));
+  QCOMPARE(assembler.getStatistics().stale, quint64(0));
+
+  // Last sequence is forgotten as well
+  QVERIFY(addSingle(assembler, 1, 0));
+}
+
+QTEST_APPLESS_MAIN(FrameAssemblerTest)
+
+#include "tst_frameassembler.moc"
@@ -0,0 +1,47 @@
+#*****************************************************************************
+# Copyright 2020 Alexander Barthel alex@littlenavmap.org
+#                Slawek Mikula slawek.mikula@gmail.com
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#****************************************************************************
+
+# Unit tests for the multiplayer protocol and the multiplayer listener.
+
+QT += core network testlib
+QT -= gui
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle debug_and_release debug_and_release_target
+
+TARGET = tst_multiplayer
+TEMPLATE = app
+
+include(../atools.pri)
+
+INCLUDEPATH += $$PWD/../../src
+DEFINES += QT_NO_CAST_FROM_BYTEARRAY
+DEFINES += QT_NO_CAST_TO_ASCII
+
+SOURCES += \
+  ../../src/multiplayerlistener.cpp \
+  ../../src/multiplayerprotocol.cpp \
+  ../../src/stringpool.cpp \
+  ../../src/trafficstore.cpp \
+  tst_multiplayer.cpp
+
+HEADERS += \
+  ../../src/multiplayerlistener.h \
+  ../../src/multiplayerprotocol.h \
+  ../../src/stringpool.h \
+  ../../src/trafficstore.h
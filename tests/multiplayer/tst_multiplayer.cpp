@@ -0,0 +1,244 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "multiplayerlistener.h"
+#include "multiplayerprotocol.h"
+
+#include <QtEndian>
+#include <QtTest>
+#include <QUdpSocket>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using lfgc::MultiplayerPosition;
+
+/* Offsets in the position message */
+static const int POSITION_OFFSET = 144, ORIENTATION_OFFSET = 168;
+
+class MultiplayerTest :
+  public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void roundTrip();
+  void roundTrip_data();
+  void cartesianPosition();
+  void orientation();
+  void invalidPackets();
+  void listenerTimeout();
+
+private:
+  static MultiplayerPosition position(double lonX, double latY, double altitudeFt, float heading, float pitch,
+                                      float roll);
+  static double cartesian(const QByteArray& datagram, int index);
+  static float angleAxis(const QByteArray& datagram, int index);
+};
+
+MultiplayerPosition MultiplayerTest::position(double lonX, double latY, double altitudeFt, float heading,
+                                              float pitch, float roll)
+{
+  MultiplayerPosition pos;
+  pos.callsign = "TEST01";
+  pos.model = "Aircraft/c172p/Models/c172p.xml";
+  pos.time = 1234.5;
+  pos.lonX = lonX;
+  pos.latY = latY;
+  pos.altitudeFt = altitudeFt;
+  pos.headingTrueDeg = heading;
+  pos.pitchDeg = pitch;
+  pos.rollDeg = roll;
+  return pos;
+}
+
+double MultiplayerTest::cartesian(const QByteArray& datagram, int index)
+{
+  quint64 bits = qFromBigEndian<quint64>(datagram.constData() + POSITION_OFFSET + index * 8);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+float MultiplayerTest::angleAxis(const QByteArray& datagram, int index)
+{
+  quint32 bits = qFromBigEndian<quint32>(datagram.constData() + ORIENTATION_OFFSET + index * 4);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void MultiplayerTest::roundTrip_data()
+{
+  QTest::addColumn<double>("lonX");
+  QTest::addColumn<double>("latY");
+  QTest::addColumn<double>("altitudeFt");
+  QTest::addColumn<float>("heading");
+  QTest::addColumn<float>("pitch");
+  QTest::addColumn<float>("roll");
+  QTest::addColumn<float>("groundSpeed");
+  QTest::addColumn<float>("verticalSpeed");
+
+  QTest::newRow("Zurich") << 8.55 << 47.46 << 1416. << 123.f << 5.f << -10.f << 120.f << 500.f;
+  QTest::newRow("West south") << -122.37 << -37.62 << 35000. << 271.f << -2.f << 25.f << 450.f << -1500.f;
+  QTest::newRow("Date line") << 179.99 << 12.5 << 0. << 359.f << 0.f << 0.f << 0.f << 0.f;
+  QTest::newRow("North") << 15.5 << 78.25 << 2000. << 10.f << 15.f << 45.f << 90.f << 2000.f;
+}
+
+void MultiplayerTest::roundTrip()
+{
+  QFETCH(double, lonX);
+  QFETCH(double, latY);
+  QFETCH(double, altitudeFt);
+  QFETCH(float, heading);
+  QFETCH(float, pitch);
+  QFETCH(float, roll);
+  QFETCH(float, groundSpeed);
+  QFETCH(float, verticalSpeed);
+
+  MultiplayerPosition sent = position(lonX, latY, altitudeFt, heading, pitch, roll);
+  sent.groundSpeedKts = groundSpeed;
+  sent.verticalSpeedFeetPerMin = verticalSpeed;
+
+  QByteArray datagram = lfgc::encodeMultiplayerPosition(sent);
+  MultiplayerPosition received;
+  QVERIFY(lfgc::decodeMultiplayerPosition(datagram, received));
+
+  QCOMPARE(received.callsign, sent.callsign);
+  QCOMPARE(received.model, sent.model);
+  QCOMPARE(received.time, sent.time);
+  QVERIFY(std::abs(received.lonX - lonX) < 1.e-7);
+  QVERIFY(std::abs(received.latY - latY) < 1.e-7);
+  QVERIFY(std::abs(received.altitudeFt - altitudeFt) < 0.01);
+
+  // Orientation is sent as float
+  float headingDiff = std::abs(received.headingTrueDeg - heading);
+  QVERIFY(std::min(headingDiff, 360.f - headingDiff) < 0.01f);
+  QVERIFY(std::abs(received.pitchDeg - pitch) < 0.01f);
+  QVERIFY(std::abs(received.rollDeg - roll) < 0.01f);
+  QVERIFY(std::abs(received.groundSpeedKts - groundSpeed) < 0.1f);
+  QVERIFY(std::abs(received.verticalSpeedFeetPerMin - verticalSpeed) < 1.f);
+}
+
+void MultiplayerTest::cartesianPosition()
+{
+  // WGS84 semi major and semi minor axis
+  QByteArray equator = lfgc::encodeMultiplayerPosition(position(0., 0., 0., 0.f, 0.f, 0.f));
+  QVERIFY(std::abs(cartesian(equator, 0) - 6378137.) < 1.e-3);
+  QVERIFY(std::abs(cartesian(equator, 1)) < 1.e-3);
+  QVERIFY(std::abs(cartesian(equator, 2)) < 1.e-3);
+
+  QByteArray east = lfgc::encodeMultiplayerPosition(position(90., 0., 1000. / 0.3048, 0.f, 0.f, 0.f));
+  QVERIFY(std::abs(cartesian(east, 0)) < 1.e-3);
+  QVERIFY(std::abs(cartesian(east, 1) - 6379137.) < 1.e-3);
+  QVERIFY(std::abs(cartesian(east, 2)) < 1.e-3);
+
+  QByteArray pole = lfgc::encodeMultiplayerPosition(position(0., 90., 0., 0.f, 0.f, 0.f));
+  QVERIFY(std::abs(cartesian(pole, 0)) < 1.e-3);
+  QVERIFY(std::abs(cartesian(pole, 2) - 6356752.314245) < 1.e-3);
+}
+
+void MultiplayerTest::orientation()
+{
+  // Level and north at 0/0 is a rotation of -90 degrees around the earth y axis
+  QByteArray north = lfgc::encodeMultiplayerPosition(position(0., 0., 0., 0.f, 0.f, 0.f));
+  QVERIFY(std::abs(angleAxis(north, 0)) < 1.e-6f);
+  QVERIFY(std::abs(angleAxis(north, 1) + 1.5707963f) < 1.e-6f);
+  QVERIFY(std::abs(angleAxis(north, 2)) < 1.e-6f);
+
+  // Quaternion (0.5, -0.5, -0.5, 0.5) - 120 degrees around (-1, -1, 1)
+  QByteArray east = lfgc::encodeMultiplayerPosition(position(0., 0., 0., 90.f, 0.f, 0.f));
+  QVERIFY(std::abs(angleAxis(east, 0) + 1.2091996f) < 1.e-6f);
+  QVERIFY(std::abs(angleAxis(east, 1) + 1.2091996f) < 1.e-6f);
+  QVERIFY(std::abs(angleAxis(east, 2) - 1.2091996f) < 1.e-6f);
+}
+
+void MultiplayerTest::invalidPackets()
+{
+  QByteArray valid = lfgc::encodeMultiplayerPosition(position(8.55, 47.46, 1416., 123.f, 5.f, -10.f));
+  MultiplayerPosition received;
+  QVERIFY(lfgc::decodeMultiplayerPosition(valid, received));
+
+  QByteArray magic(valid);
+  magic[0] = 'X';
+  QVERIFY(!lfgc::decodeMultiplayerPosition(magic, received));
+
+  QByteArray version(valid);
+  version[7] = 2;
+  QVERIFY(!lfgc::decodeMultiplayerPosition(version, received));
+
+  // Chat or other message
+  QByteArray messageId(valid);
+  messageId[11] = 1;
+  QVERIFY(!lfgc::decodeMultiplayerPosition(messageId, received));
+
+  // Length in header beyond the datagram
+  QByteArray length(valid);
+  length[14] = 1;
+  QVERIFY(!lfgc::decodeMultiplayerPosition(length, received));
+
+  QVERIFY(!lfgc::decodeMultiplayerPosition(valid.left(valid.size() - 1), received));
+  QVERIFY(!lfgc::decodeMultiplayerPosition(valid.left(32), received));
+  QVERIFY(!lfgc::decodeMultiplayerPosition(QByteArray(), received));
+
+  MultiplayerPosition noCallsign = position(8.55, 47.46, 1416., 123.f, 5.f, -10.f);
+  noCallsign.callsign.clear();
+  QVERIFY(!lfgc::decodeMultiplayerPosition(lfgc::encodeMultiplayerPosition(noCallsign), received));
+}
+
+void MultiplayerTest::listenerTimeout()
+{
+  // Find a free port
+  QUdpSocket probe;
+  QVERIFY(probe.bind(QHostAddress::LocalHost, 0));
+  quint16 port = probe.localPort();
+  probe.close();
+
+  // Shorter timeout than the 10 seconds used by the program
+  const int timeoutMs = 500;
+  lfgc::MultiplayerListener listener(port, timeoutMs, 50);
+  int numPilots = -1;
+  QString model;
+  connect(&listener, &lfgc::MultiplayerListener::onlineTrafficUpdated, this,
+          [&numPilots, &model](const lfgc::TrafficStore& traffic) {
+    numPilots = traffic.size();
+    model = numPilots > 0 ? traffic.getModel(0) : QString();
+  });
+  QVERIFY(listener.start());
+
+  QUdpSocket sender;
+  QElapsedTimer timer;
+  timer.start();
+  sender.writeDatagram(QByteArray("garbage"), QHostAddress::LocalHost, port);
+  sender.writeDatagram(lfgc::encodeMultiplayerPosition(position(8.55, 47.46, 1416., 123.f, 5.f, -10.f)),
+                       QHostAddress::LocalHost, port);
+
+  QTRY_COMPARE(numPilots, 1);
+  QCOMPARE(model, QStringLiteral("c172p"));
+  QCOMPARE(listener.getNumIgnored(), quint64(1));
+
+  // Removed after the timeout without further packets
+  QTRY_COMPARE_WITH_TIMEOUT(numPilots, 0, 5000);
+  QVERIFY(timer.elapsed() >= timeoutMs);
+}
+
+QTEST_GUILESS_MAIN(MultiplayerTest)
+
+#include "tst_multiplayer.moc"
@@ -0,0 +1,30 @@
+#*****************************************************************************
+# Copyright 2020 Alexander Barthel alex@littlenavmap.org
+#                Slawek Mikula slawek.mikula@gmail.com
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#****************************************************************************
+
+# Unit tests for Little FGconnect which do not need a running simulator.
+# Build with qmake and run with "make check". Some tests need atools - see atools.pri.
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+  fieldreader \
+  flightrecordreader \
+  frameassembler \
+  multiplayer \
+  trafficpredictor \
+  xpconnect
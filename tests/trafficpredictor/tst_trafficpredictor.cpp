@@ -0,0 +1,193 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "trafficpredictor.h"
+
+#include <QtTest>
+
+#include <cmath>
+
+using lfgc::TrafficPredictor;
+using lfgc::TrafficStore;
+
+static const qint64 SECOND_NS = 1000000000LL;
+
+class TrafficPredictorTest :
+  public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void extrapolate();
+  void closeUpdatesKeepVelocity();
+  void unchangedKeepsAge();
+  void teleportResets();
+  void limitDisabled();
+
+private:
+  /* Add a pilot at lonX 8 and latY */
+  static void addPilot(TrafficStore& traffic, const QString& callsign, float latY);
+
+  /* Row of callsign in traffic or -1 */
+  static int findRow(const TrafficStore& traffic, const QString& callsign);
+};
+
+void TrafficPredictorTest::addPilot(TrafficStore& traffic, const QString& callsign, float latY)
+{
+  int row = traffic.append();
+  traffic.setCallsign(row, callsign);
+  traffic.setPosition(row, 8.f, latY, 5000.f);
+}
+
+int TrafficPredictorTest::findRow(const TrafficStore& traffic, const QString& callsign)
+{
+  for(int i = 0; i < traffic.size(); i++)
+  {
+    if(traffic.getCallsign(i) == callsign)
+      return i;
+  }
+  return -1;
+}
+
+void TrafficPredictorTest::extrapolate()
+{
+  TrafficPredictor predictor;
+  TrafficStore dump, predicted;
+
+  addPilot(dump, QStringLiteral("A"), 10.f);
+  predictor.update(dump, 0);
+
+  // No velocity after the first dump
+  predictor.predict(predicted, SECOND_NS);
+  QCOMPARE(predicted.size(), 1);
+  QVERIFY(!predicted.isPredicted(0));
+  QCOMPARE(predicted.getLatY(0), 10.f);
+
+  // Moving north with 0.001 degrees per second
+  dump.clear();
+  addPilot(dump, QStringLiteral("A"), 10.002f);
+  predictor.update(dump, 2 * SECOND_NS);
+
+  predictor.predict(predicted, 3 * SECOND_NS);
+  QVERIFY(predicted.isPredicted(0));
+  QVERIFY(std::abs(predicted.getLatY(0) - 10.003f) < 1.e-5f);
+  QVERIFY(std::abs(predicted.getHeadingTrueDeg(0)) < 0.1f || std::abs(predicted.getHeadingTrueDeg(0) - 360.f) < 0.1f);
+  QVERIFY(std::abs(predicted.getAgeSeconds(0) - 1.f) < 1.e-6f);
+}
+
+void TrafficPredictorTest::closeUpdatesKeepVelocity()
+{
+  TrafficPredictor predictor;
+  TrafficStore dump, predicted;
+
+  addPilot(dump, QStringLiteral("A"), 10.f);
+  predictor.update(dump, 0);
+  dump.clear();
+  addPilot(dump, QStringLiteral("A"), 10.002f);
+  predictor.update(dump, 2 * SECOND_NS);
+
+  // Dump of a second server shortly after with the same pilot from the first
+  dump.clear();
+  addPilot(dump, QStringLiteral("B"), 20.f);
+  addPilot(dump, QStringLiteral("A"), 10.002f);
+  predictor.update(dump, 2 * SECOND_NS + SECOND_NS / 2);
+
+  predictor.predict(predicted, 3 * SECOND_NS);
+  int row = findRow(predicted, QStringLiteral("A"));
+  QVERIFY(row != -1);
+  QVERIFY(predicted.isPredicted(row));
+  QVERIFY(std::abs(predicted.getLatY(row) - 10.003f) < 1.e-5f);
+  QVERIFY(std::abs(predicted.getAgeSeconds(row) - 1.f) < 1.e-6f);
+
+  // New position shortly after the last sample keeps the velocity
+  dump.clear();
+  addPilot(dump, QStringLiteral("A"), 10.0027f);
+  addPilot(dump, QStringLiteral("B"), 20.f);
+  predictor.update(dump, 2 * SECOND_NS + SECOND_NS * 7 / 10);
+
+  predictor.predict(predicted, 3 * SECOND_NS + SECOND_NS * 7 / 10);
+  row = findRow(predicted, QStringLiteral("A"));
+  QVERIFY(predicted.isPredicted(row));
+  QVERIFY(std::abs(predicted.getLatY(row) - 10.0037f) < 1.e-5f);
+  QVERIFY(std::abs(predicted.getAgeSeconds(row) - 1.f) < 1.e-6f);
+
+  // Pilot seen only once has no velocity
+  row = findRow(predicted, QStringLiteral("B"));
+  QVERIFY(!predicted.isPredicted(row));
+  QVERIFY(std::abs(predicted.getAgeSeconds(row) - 1.2f) < 1.e-6f);
+}
+
+void TrafficPredictorTest::unchangedKeepsAge()
+{
+  TrafficPredictor predictor;
+  TrafficStore dump, predicted;
+
+  addPilot(dump, QStringLiteral("A"), 10.f);
+  predictor.update(dump, 0);
+
+  // Merged again from a server which failed since
+  predictor.update(dump, 5 * SECOND_NS);
+  predictor.update(dump, 10 * SECOND_NS);
+
+  predictor.predict(predicted, 11 * SECOND_NS);
+  QVERIFY(std::abs(predicted.getAgeSeconds(0) - 11.f) < 1.e-6f);
+}
+
+void TrafficPredictorTest::teleportResets()
+{
+  TrafficPredictor predictor;
+  TrafficStore dump, predicted;
+
+  addPilot(dump, QStringLiteral("A"), 10.f);
+  predictor.update(dump, 0);
+  dump.clear();
+  addPilot(dump, QStringLiteral("A"), 10.002f);
+  predictor.update(dump, 2 * SECOND_NS);
+
+  // One degree in two seconds is far beyond any aircraft
+  dump.clear();
+  addPilot(dump, QStringLiteral("A"), 11.002f);
+  predictor.update(dump, 4 * SECOND_NS);
+
+  predictor.predict(predicted, 5 * SECOND_NS);
+  QVERIFY(!predicted.isPredicted(0));
+  QCOMPARE(predicted.getLatY(0), 11.002f);
+}
+
+void TrafficPredictorTest::limitDisabled()
+{
+  TrafficPredictor predictor;
+  predictor.setLimitSeconds(0.f);
+  TrafficStore dump, predicted;
+
+  addPilot(dump, QStringLiteral("A"), 10.f);
+  predictor.update(dump, 0);
+  dump.clear();
+  addPilot(dump, QStringLiteral("A"), 10.002f);
+  predictor.update(dump, 2 * SECOND_NS);
+
+  predictor.predict(predicted, 3 * SECOND_NS);
+  QVERIFY(!predicted.isPredicted(0));
+  QCOMPARE(predicted.getLatY(0), 10.002f);
+  QVERIFY(std::abs(predicted.getAgeSeconds(0) - 1.f) < 1.e-6f);
+}
+
+QTEST_APPLESS_MAIN(TrafficPredictorTest)
+
+#include "tst_trafficpredictor.moc"
@@ -0,0 +1,206 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "fgconnect.h"
+#include "propertysubscriber.h"
+
+#include "fs/sc/simconnectdata.h"
+#include "fs/sc/simconnectuseraircraft.h"
+
+#include <QtTest>
+
+using atools::fs::sc::SimConnectData;
+using atools::fs::sc::SimConnectUserAircraft;
+using lfgc::PropertyChange;
+
+class XpConnectTest :
+  public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void fullBatch();
+  void partialBatch();
+  void flightModelAndFlags();
+  void noPosition();
+
+private:
+  static PropertyChange number(lfgc::PropertyId id, double value);
+  static PropertyChange text(lfgc::PropertyId id, const QString& value);
+
+  /* All properties like sent by the subscriber after connecting */
+  static QVector<PropertyChange> initialBatch();
+};
+
+PropertyChange XpConnectTest::number(lfgc::PropertyId id, double value)
+{
+  return {id, value, QString()};
+}
+
+PropertyChange XpConnectTest::text(lfgc::PropertyId id, const QString& value)
+{
+  return {id, 0., value};
+}
+
+QVector<PropertyChange> XpConnectTest::initialBatch()
+{
+  return {
+    text(lfgc::PROP_TIME_GMT, QStringLiteral("2020-06-01T12:30:15")),
+    number(lfgc::PROP_TIME_LOCAL_OFFSET, 7200.),
+    number(lfgc::PROP_LATITUDE, 47.46),
+    number(lfgc::PROP_LONGITUDE, 8.55),
+    number(lfgc::PROP_ALTITUDE_AGL, 2500.),
+    number(lfgc::PROP_GROUND_ELEVATION, 1400.),
+    number(lfgc::PROP_INDICATED_ALTITUDE, 3900.),
+    number(lfgc::PROP_HEADING_TRUE, 123.),
+    number(lfgc::PROP_HEADING_MAG, 121.),
+    number(lfgc::PROP_TRACK_TRUE, 125.),
+    number(lfgc::PROP_TRACK_MAG, 123.),
+    number(lfgc::PROP_MAG_VAR, 2.),
+    number(lfgc::PROP_GROUND_SPEED, 110.),
+    number(lfgc::PROP_INDICATED_SPEED, 100.),
+    number(lfgc::PROP_TRUE_AIRSPEED, 105.),
+    number(lfgc::PROP_MACH, 0.16),
+    number(lfgc::PROP_VERTICAL_SPEED, 500.),
+    number(lfgc::PROP_WIND_SPEED, 12.),
+    number(lfgc::PROP_WIND_DIRECTION, 270.),
+    number(lfgc::PROP_TEMPERATURE, 15.),
+    number(lfgc::PROP_SEA_LEVEL_PRESSURE, 29.92),
+    number(lfgc::PROP_VISIBILITY, 10000.),
+    number(lfgc::PROP_WEIGHT_YASIM, 2300.),
+    number(lfgc::PROP_WEIGHT_JSBSIM, 2400.),
+    number(lfgc::PROP_FUEL_WEIGHT, 300.),
+    number(lfgc::PROP_FUEL_QUANTITY, 50.),
+    number(lfgc::PROP_FUEL_FLOW_GPH, 9.),
+    number(lfgc::PROP_FUEL_FLOW_PPS, 0.015),
+    text(lfgc::PROP_TITLE, QStringLiteral("Cessna 172P Skyhawk")),
+    text(lfgc::PROP_MODEL, QStringLiteral("c172p")),
+    text(lfgc::PROP_CALLSIGN, QStringLiteral("D-EFGH")),
+    text(lfgc::PROP_FLIGHT_MODEL, QStringLiteral("jsb"))
+  };
+}
+
+void XpConnectTest::fullBatch()
+{
+  xpc::XpConnect xpConnect;
+  SimConnectData data;
+  QVERIFY(xpConnect.applyProperties(initialBatch(), data, false));
+
+  const SimConnectUserAircraft& ac = data.getUserAircraftConst();
+  QCOMPARE(ac.getPosition().getLatY(), 47.46f);
+  QCOMPARE(ac.getPosition().getLonX(), 8.55f);
+  QCOMPARE(ac.getAltitudeAboveGroundFt(), 2500.f);
+  QCOMPARE(ac.getGroundAltitudeFt(), 1400.f);
+  QCOMPARE(ac.getIndicatedAltitudeFt(), 3900.f);
+  QCOMPARE(ac.getHeadingDegTrue(), 123.f);
+  QCOMPARE(ac.getHeadingDegMag(), 121.f);
+  QCOMPARE(ac.getTrackDegTrue(), 125.f);
+  QCOMPARE(ac.getMagVarDeg(), 2.f);
+  QCOMPARE(ac.getGroundSpeedKts(), 110.f);
+  QCOMPARE(ac.getIndicatedSpeedKts(), 100.f);
+  QCOMPARE(ac.getTrueAirspeedKts(), 105.f);
+  QCOMPARE(ac.getMachSpeed(), 0.16f);
+  QCOMPARE(ac.getVerticalSpeedFeetPerMin(), 500.f);
+  QCOMPARE(ac.getWindSpeedKts(), 12.f);
+  QCOMPARE(ac.getWindDirectionDegT(), 270.f);
+  QCOMPARE(ac.getAmbientTemperatureCelsius(), 15.f);
+  QVERIFY(std::abs(ac.getSeaLevelPressureMbar() - 1013.2f) < 0.1f);
+  QCOMPARE(ac.getAmbientVisibilityMeter(), 10000.f);
+
+  // JSBSim weights and fuel flow
+  QCOMPARE(ac.getAirplaneTotalWeightLbs(), 2400.f);
+  QCOMPARE(ac.getFuelTotalWeightLbs(), 300.f);
+  QCOMPARE(ac.getFuelFlowGPH(), 9.f);
+  QVERIFY(std::abs(ac.getFuelFlowPPH() - 54.f) < 0.01f);
+
+  QCOMPARE(ac.getAirplaneTitle(), QStringLiteral("Cessna 172P Skyhawk"));
+  QCOMPARE(ac.getAirplaneModel(), QStringLiteral("c172p"));
+  QCOMPARE(ac.getAirplaneRegistration(), QStringLiteral("D-EFGH"));
+  QCOMPARE(ac.getZuluTime(), QDateTime(QDate(2020, 6, 1), QTime(12, 30, 15)));
+  QVERIFY(!ac.isOnGround());
+  QVERIFY(!ac.isSimPaused());
+}
+
+void XpConnectTest::partialBatch()
+{
+  xpc::XpConnect xpConnect;
+  SimConnectData data;
+  QVERIFY(xpConnect.applyProperties(initialBatch(), data, false));
+
+  // Only changed values are pushed - everything else keeps the last value
+  QVERIFY(xpConnect.applyProperties({number(lfgc::PROP_HEADING_TRUE, 130.),
+                                   number(lfgc::PROP_LATITUDE, 47.47),
+                                   text(lfgc::PROP_TITLE, QStringLiteral("Cessna 172P"))}, data, false));
+
+  const SimConnectUserAircraft& ac = data.getUserAircraftConst();
+  QCOMPARE(ac.getHeadingDegTrue(), 130.f);
+  QCOMPARE(ac.getPosition().getLatY(), 47.47f);
+  QCOMPARE(ac.getPosition().getLonX(), 8.55f);
+  QCOMPARE(ac.getAirplaneTitle(), QStringLiteral("Cessna 172P"));
+  QCOMPARE(ac.getAirplaneModel(), QStringLiteral("c172p"));
+  QCOMPARE(ac.getGroundSpeedKts(), 110.f);
+  QCOMPARE(ac.getWindSpeedKts(), 12.f);
+  QCOMPARE(ac.getAirplaneTotalWeightLbs(), 2400.f);
+
+  // Empty batch builds the same aircraft again
+  QVERIFY(xpConnect.applyProperties({}, data, false));
+  QCOMPARE(data.getUserAircraftConst().getHeadingDegTrue(), 130.f);
+}
+
+void XpConnectTest::flightModelAndFlags()
+{
+  xpc::XpConnect xpConnect;
+  SimConnectData data;
+  QVERIFY(xpConnect.applyProperties(initialBatch(), data, false));
+
+  // YASIM uses the other weight and sums up the engine fuel flows
+  QVERIFY(xpConnect.applyProperties({text(lfgc::PROP_FLIGHT_MODEL, QStringLiteral("yasim")),
+                                   number(lfgc::PROP_FUEL_FLOW_GPH0, 4.),
+                                   number(lfgc::PROP_FUEL_FLOW_GPH1, 3.),
+                                   number(lfgc::PROP_FREEZE, 1.),
+                                   number(lfgc::PROP_ALTITUDE_AGL, 0.)}, data, false));
+
+  const SimConnectUserAircraft& ac = data.getUserAircraftConst();
+  QCOMPARE(ac.getAirplaneTotalWeightLbs(), 2300.f);
+  QCOMPARE(ac.getFuelFlowGPH(), 7.f);
+  QVERIFY(ac.isSimPaused());
+  QVERIFY(ac.isOnGround());
+
+  QVERIFY(xpConnect.applyProperties({number(lfgc::PROP_FREEZE, 0.)}, data, false));
+  QVERIFY(!data.getUserAircraftConst().isSimPaused());
+}
+
+void XpConnectTest::noPosition()
+{
+  xpc::XpConnect xpConnect;
+  SimConnectData data;
+
+  // Nothing to publish before the position arrived
+  QVERIFY(!xpConnect.applyProperties({number(lfgc::PROP_HEADING_TRUE, 130.),
+                                    text(lfgc::PROP_TITLE, QStringLiteral("Cessna 172P"))}, data, false));
+
+  QVERIFY(xpConnect.applyProperties({number(lfgc::PROP_LATITUDE, 47.46),
+                                   number(lfgc::PROP_LONGITUDE, 8.55)}, data, false));
+  QCOMPARE(data.getUserAircraftConst().getHeadingDegTrue(), 130.f);
+  QCOMPARE(data.getUserAircraftConst().getAirplaneTitle(), QStringLiteral("Cessna 172P"));
+}
+
+QTEST_GUILESS_MAIN(XpConnectTest)
+
+#include "tst_xpconnect.moc"
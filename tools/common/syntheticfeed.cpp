@@ -0,0 +1,142 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "syntheticfeed.h"
+
+#include <QDateTime>
+#include <QList>
+
+#include <cmath>
+
+namespace synthetic {
+
+static const double DEG_TO_RAD = 3.14159265358979323846 / 180.;
+
+/* Traffic is spread in a grid around this position */
+static const double CENTER_LAT = 50.03, CENTER_LON = 8.57;
+
+static const char *const MODELS[] = {"c172p", "777-200ER", "A320-neo", "ufo", "ec135", "737-800"};
+static const int NUM_MODELS = sizeof(MODELS) / sizeof(MODELS[0]);
+
+static const char *const AIRPORTS[] = {"EDDF", "EDDM", "KSFO", "EGLL", "LFPG", "EHAM"};
+static const int NUM_AIRPORTS = sizeof(AIRPORTS) / sizeof(AIRPORTS[0]);
+
+static QByteArray num(double value, int precision = 4)
+{
+  return QByteArray::number(value, 'f', precision);
+}
+
+static QByteArray zuluTime()
+{
+  return QDateTime::currentDateTimeUtc().toString("yyyy-MM-ddTHH:mm:ss").toLatin1();
+}
+
+/* User aircraft flies north slowly */
+static double userLat(quint64 counter)
+{
+  return CENTER_LAT + static_cast<double>(counter % 100000) * 0.00005;
+}
+
+/* Position of traffic object index in a grid which moves with the counter */
+void trafficPosition(quint64 counter, int index, double& lat, double& lon, double& altFt)
+{
+  double offset = static_cast<double>(counter % 10000) * 0.0001;
+  lat = CENTER_LAT + (index / 64 - 32) * 0.05 + offset;
+  lon = CENTER_LON + (index % 64 - 32) * 0.05 + offset;
+  altFt = 1000. + (index % 40) * 1000.;
+}
+
+QByteArray aiObjects(quint64 counter, int numAi)
+{
+  QByteArray field;
+  field.reserve(numAi * 48);
+  for(int i = 0; i < numAi; i++)
+  {
+    double lat, lon, alt;
+    trafficPosition(counter, i, lat, lon, alt);
+
+    if(i > 0)
+      field.append('|');
+    field.append("AI").append(QByteArray::number(i)).append('^').
+    append(AIRPORTS[i % NUM_AIRPORTS]).append('^').
+    append(AIRPORTS[(i + 1) % NUM_AIRPORTS]).append('^').
+    append(num(alt, 1)).append('^').append(num(lat, 6)).append('^').append(num(lon, 6));
+  }
+  return field;
+}
+
+QByteArray combinedDatagram(quint64 counter, int numAi)
+{
+  QList<QByteArray> fields;
+  fields << zuluTime() << "3600" << "3000" << "500" << "10" << "270" << "15" << "29.92" << "2500" << "2500"
+         << "40" << "240" << "0" << "0" << "8" << "0" << "0" << "0" << "2" << "20000" << "358" << "0"
+         << "Synthetic" << "c172p" << "SYNTH" << num(userLat(counter), 6) << num(CENTER_LON, 6) << "0" << "358"
+         << "120" << "3500" << "110" << "125" << "0.19" << "0" << "yasim" << "false" << "0" << "false" << ""
+         << aiObjects(counter, numAi);
+  return fields.join(';');
+}
+
+QByteArray kinematicsDatagram(quint64 counter)
+{
+  QList<QByteArray> fields;
+  fields << zuluTime() << num(userLat(counter), 6) << num(CENTER_LON, 6) << "3000" << "500" << "3500"
+         << "0" << "358" << "0" << "358" << "120" << "110" << "125" << "0.19" << "0" << "false" << "0";
+  return fields.join(';');
+}
+
+QByteArray metadataDatagram(quint64 counter, int numAi)
+{
+  QList<QByteArray> fields;
+  fields << "3600" << "10" << "270" << "15" << "29.92" << "2500" << "2500" << "40" << "240" << "0" << "0"
+         << "8" << "0" << "0" << "0" << "2" << "20000" << "Synthetic" << "c172p" << "SYNTH" << "yasim"
+         << "false" << "" << aiObjects(counter, numAi);
+  return fields.join(';');
+}
+
+QByteArray multiplayerDump(quint64 counter, int numPilots)
+{
+  QByteArray dump;
+  dump.reserve(numPilots * 160 + 64);
+  dump.append("# ").append(QByteArray::number(numPilots)).append(" pilots online\n");
+
+  for(int i = 0; i < numPilots; i++)
+  {
+    double lat, lon, alt;
+    trafficPosition(counter, i, lat, lon, alt);
+
+    // Cartesian coordinates on a spherical earth - ignored by the parser but kept plausible
+    double radius = 6371000. + alt * 0.3048;
+    double x = radius * std::cos(lat * DEG_TO_RAD) * std::cos(lon * DEG_TO_RAD);
+    double y = radius * std::cos(lat * DEG_TO_RAD) * std::sin(lon * DEG_TO_RAD);
+    double z = radius * std::sin(lat * DEG_TO_RAD);
+
+    dump.append("MP").append(QByteArray::number(i)).append("@mpserver01: ").
+    append(num(x, 6)).append(' ').append(num(y, 6)).append(' ').append(num(z, 6)).append(' ').
+    append(num(lat, 6)).append(' ').append(num(lon, 6)).append(' ').append(num(alt, 6)).append(' ').
+    append("-1.734371 0.059653 0.326972 ").append(modelPath(i)).append('\n');
+  }
+  return dump;
+}
+
+QByteArray modelPath(int index)
+{
+  const char *model = MODELS[index % NUM_MODELS];
+  return QByteArray("Aircraft/").append(model).append("/Models/").append(model).append(".xml");
+}
+
+} // namespace synthetic
@@ -0,0 +1,56 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLEFGCONNECT_SYNTHETICFEED_H
+#define LITTLEFGCONNECT_SYNTHETICFEED_H
+
+#include <QByteArray>
+
+/*
+ * Builds synthetic FlightGear input in the layouts read by XpConnect and OnlineStatusParser.
+ * Used by the command line tools to drive Little FGconnect without a simulator.
+ *
+ * counter is increased by the caller for each frame. All positions move with the counter so that
+ * every frame differs.
+ */
+namespace synthetic {
+
+/* AI objects field "callsign^arrival^departure^altitudeFt^lat^lon|..." with numAi objects */
+QByteArray aiObjects(quint64 counter, int numAi);
+
+/* Combined layout as read by XpConnect::fillSimConnectData() */
+QByteArray combinedDatagram(quint64 counter, int numAi);
+
+/* High rate layout as read by XpConnect::fillKinematics() */
+QByteArray kinematicsDatagram(quint64 counter);
+
+/* Low rate layout as read by XpConnect::updateMetadata() */
+QByteArray metadataDatagram(quint64 counter, int numAi);
+
+/* Pilot list dump of a multiplayer server with a header line and numPilots pilot lines */
+QByteArray multiplayerDump(quint64 counter, int numPilots);
+
+/* Position of traffic object or pilot index as used in the AI objects and the dumps */
+void trafficPosition(quint64 counter, int index, double& lat, double& lon, double& altFt);
+
+/* Model path like "Aircraft/c172p/Models/c172p.xml" of pilot index */
+QByteArray modelPath(int index);
+
+} // namespace synthetic
+
+#endif // LITTLEFGCONNECT_SYNTHETICFEED_H
@@ -0,0 +1,41 @@
+#*****************************************************************************
+# Copyright 2020 Alexander Barthel alex@littlenavmap.org
+#                Slawek Mikula slawek.mikula@gmail.com
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#****************************************************************************
+
+# Command line tool which attaches to the snapshot shared memory region of Little FGconnect
+# and reports latency distributions. Does not need atools.
+
+QT += core network
+QT -= gui
+
+CONFIG += console c++14
+CONFIG -= app_bundle debug_and_release debug_and_release_target
+
+TARGET = latencyprobe
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/../../src $$PWD/../common
+DEFINES += QT_NO_CAST_FROM_BYTEARRAY
+DEFINES += QT_NO_CAST_TO_ASCII
+
+SOURCES += \
+  ../common/syntheticfeed.cpp \
+  main.cpp
+
+HEADERS += \
+  ../../src/snapshotlayout.h \
+  ../common/syntheticfeed.h
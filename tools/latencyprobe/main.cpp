@@ -0,0 +1,211 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "snapshotlayout.h"
+#include "syntheticfeed.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QHostInfo>
+#include <QSharedMemory>
+#include <QTextStream>
+#include <QThread>
+#include <QUdpSocket>
+
+#include <algorithm>
+
+/*
+ * Attaches to the snapshot region of Little FGconnect and measures for each published frame:
+ * - receive to publish: datagram received until frame visible in the snapshot region
+ * - publish to read: frame visible until seen by this probe (includes the polling interval)
+ * - missed frames: gaps in the frame sequence
+ *
+ * Optionally sends synthetic FlightGear datagrams to drive Little FGconnect without a simulator.
+ */
+
+namespace {
+
+QTextStream out(stdout);
+
+/* Collects latency samples in nanoseconds and prints percentiles */
+class LatencyStats
+{
+public:
+  void add(qint64 ns)
+  {
+    samples.append(ns);
+  }
+
+  void print(const QString& name)
+  {
+    out << name.leftJustified(20);
+    if(samples.isEmpty())
+    {
+      out << "no samples" << Qt::endl;
+      return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [this](double p) -> double {
+      int index = std::min(static_cast<int>(p * samples.size()), samples.size() - 1);
+      return samples.at(index) / 1000.;
+    };
+
+    out << QString("n %1 min %2 p50 %3 p90 %4 p99 %5 max %6 us").
+      arg(samples.size()).
+      arg(samples.constFirst() / 1000., 0, 'f', 1).
+      arg(percentile(0.5), 0, 'f', 1).
+      arg(percentile(0.9), 0, 'f', 1).
+      arg(percentile(0.99), 0, 'f', 1).
+      arg(samples.constLast() / 1000., 0, 'f', 1) << Qt::endl;
+  }
+
+private:
+  QVector<qint64> samples;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("latencyprobe");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Measures latency of the Little FGconnect snapshot shared memory region.");
+  parser.addHelpOption();
+
+  QCommandLineOption durationOpt({"d", "duration"}, "Measure for <seconds>. Default is 10.", "seconds", "10");
+  QCommandLineOption pollOpt({"p", "poll"}, "Poll the region every <microseconds>. Default is 500.",
+                             "microseconds", "500");
+  QCommandLineOption sendOpt({"s", "send"}, "Send synthetic datagrams to <host:port>.", "host:port");
+  QCommandLineOption rateOpt({"r", "rate"}, "Synthetic datagrams per second. Default is 20.", "hz", "20");
+  QCommandLineOption fastOpt({"f", "fast"}, "Send the high rate layout used for dual rate input.");
+  parser.addOptions({durationOpt, pollOpt, sendOpt, rateOpt, fastOpt});
+  parser.process(app);
+
+  qint64 durationNs = parser.value(durationOpt).toLongLong() * 1000000000LL;
+  unsigned long pollUs = parser.value(pollOpt).toULong();
+  bool fast = parser.isSet(fastOpt);
+
+  // Synthetic sender =====================================
+  QUdpSocket socket;
+  QHostAddress sendAddress;
+  quint16 sendPort = 0;
+  qint64 sendIntervalNs = 0;
+  if(parser.isSet(sendOpt))
+  {
+    QString target = parser.value(sendOpt);
+    sendPort = static_cast<quint16>(target.section(':', -1).toUInt());
+    QString host = target.section(':', 0, -2);
+    if(!sendAddress.setAddress(host))
+    {
+      QHostInfo info = QHostInfo::fromName(host);
+      if(!info.addresses().isEmpty())
+        sendAddress = info.addresses().constFirst();
+    }
+
+    if(sendAddress.isNull() || sendPort == 0)
+    {
+      out << "Invalid target " << target << Qt::endl;
+      return 1;
+    }
+    sendIntervalNs = 1000000000LL / std::max(parser.value(rateOpt).toLongLong(), 1LL);
+  }
+
+  // Attach to region =====================================
+  QSharedMemory sharedMemory(QLatin1String(lfgc::SNAPSHOT_SHARED_MEMORY_KEY));
+  if(!sharedMemory.attach(QSharedMemory::ReadOnly))
+  {
+    out << "Cannot attach to " << sharedMemory.key() << ": " << sharedMemory.errorString() << Qt::endl;
+    return 1;
+  }
+  const lfgc::SnapshotHeader *header = static_cast<const lfgc::SnapshotHeader *>(sharedMemory.constData());
+  if(header->magic != lfgc::SNAPSHOT_MAGIC || header->version != lfgc::SNAPSHOT_VERSION)
+  {
+    out << "Incompatible snapshot region version " << header->version << Qt::endl;
+    return 1;
+  }
+
+  out << "Attached to " << sharedMemory.nativeKey() << Qt::endl;
+
+  LatencyStats receiveToPublish, publishToRead;
+  quint64 lastFrame = 0, framesSeen = 0, framesMissed = 0, datagramsSent = 0, retries = 0;
+  qint64 start = lfgc::monotonicNowNs(), nextSend = start;
+
+  while(lfgc::monotonicNowNs() - start < durationNs)
+  {
+    if(sendIntervalNs > 0 && lfgc::monotonicNowNs() >= nextSend)
+    {
+      QByteArray datagram = fast ?
+                            synthetic::kinematicsDatagram(datagramsSent) :
+                            synthetic::combinedDatagram(datagramsSent, 0);
+      if(socket.writeDatagram(datagram, sendAddress, sendPort) > 0)
+        datagramsSent++;
+      nextSend += sendIntervalNs;
+    }
+
+    // Sequence lock read of the header fields
+    quint32 seq1 = header->sequence.load(std::memory_order_acquire);
+    if(seq1 & 1)
+    {
+      // Writer active - let it finish instead of spinning on the sequence
+      retries++;
+      QThread::yieldCurrentThread();
+      continue;
+    }
+    quint64 frame = header->frameSequence;
+    qint64 receiveNs = header->receiveTimeNs, publishNs = header->publishTimeNs;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(header->sequence.load(std::memory_order_relaxed) != seq1)
+    {
+      retries++;
+      QThread::yieldCurrentThread();
+      continue;
+    }
+
+    if(frame != lastFrame && frame > 0)
+    {
+      qint64 now = lfgc::monotonicNowNs();
+
+      if(frame < lastFrame)
+        // Writer restarted
+        lastFrame = 0;
+      else if(lastFrame > 0 && frame > lastFrame + 1)
+        framesMissed += frame - lastFrame - 1;
+
+      framesSeen++;
+      publishToRead.add(now - publishNs);
+      if(receiveNs > 0)
+        receiveToPublish.add(publishNs - receiveNs);
+      lastFrame = frame;
+    }
+
+    QThread::usleep(pollUs);
+  }
+
+  out << "Frames seen " << framesSeen << ", missed " << framesMissed << ", read retries " << retries;
+  if(sendIntervalNs > 0)
+    out << ", datagrams sent " << datagramsSent;
+  out << Qt::endl;
+
+  receiveToPublish.print("receive to publish");
+  publishToRead.print("publish to read");
+
+  return 0;
+}
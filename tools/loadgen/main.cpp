@@ -0,0 +1,370 @@
+/*****************************************************************************
+* Copyright 2015-2020 Alexander Barthel alex@littlenavmap.org
+*           2020 Slawomir Mikula slawek.mikula@gmail.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "frameassembler.h"
+#include "multiplayerprotocol.h"
+#include "propertysubscriber.h"
+#include "syntheticfeed.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHostInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QWebSocket>
+#include <QWebSocketServer>
+
+#include <algorithm>
+#include <cmath>
+
+/*
+ * Load generator for Little FGconnect.
+ *
+ * Sends generic protocol datagrams in the combined layout or, if a metadata port is given, in the dual rate
+ * layouts. Optionally acts as a multiplayer server which serves a pilot list dump to each connecting client.
+ * Can also stand in for the FlightGear property listener websocket and push changed properties only
+ * or send multiplayer protocol position packets for all pilots.
+ *
+ * Run Little FGconnect with "Options/MultiplayerServerHost" set to "localhost:<port>" to use the dumps,
+ * with "Options/PropertyListenerUrl" set to "ws://localhost:<port>/PropertyListener" for the websocket
+ * and with "Options/MultiplayerListenPort" set to the multiplayer port for the position packets.
+ */
+
+namespace {
+
+QTextStream out(stdout);
+
+/* Maximum number of datagrams sent in one timer tick to catch up after a delay */
+const int MAX_BURST = 100;
+
+struct Counters
+{
+  quint64 datagrams = 0, bytes = 0, errors = 0, dumps = 0, dumpBytes = 0, properties = 0, mpPackets = 0;
+  int largestDatagram = 0;
+};
+
+/* Property listener client and the values last sent to it */
+struct PropertyClient
+{
+  QWebSocket *socket = nullptr;
+  QVector<bool> subscribed = QVector<bool>(lfgc::PROP_NUM_PROPERTIES, false);
+  QVector<QByteArray> lastSent = QVector<QByteArray>(lfgc::PROP_NUM_PROPERTIES);
+};
+
+/* Current property values taken from the combined layout which has the same field order */
+QList<QByteArray> propertyValues(quint64 counter)
+{
+  QList<QByteArray> values = synthetic::combinedDatagram(counter, 0).split(';').mid(0, lfgc::PROP_NUM_PROPERTIES);
+
+  // Datagram has feet per minute
+  values[lfgc::PROP_VERTICAL_SPEED] = QByteArray::number(values.at(lfgc::PROP_VERTICAL_SPEED).toDouble() / 60.);
+  return values;
+}
+
+void sendProperty(PropertyClient& client, int id, const QByteArray& value, Counters& counters)
+{
+  QJsonObject message;
+  message.insert("path", QString::fromLatin1(lfgc::PropertySubscriber::propertyPath(static_cast<lfgc::PropertyId>(id))));
+  message.insert("value", QString::fromUtf8(value));
+  client.socket->sendTextMessage(QString::fromUtf8(QJsonDocument(message).toJson(QJsonDocument::Compact)));
+  client.lastSent[id] = value;
+  counters.properties++;
+}
+
+/* Position packet of pilot index moving along the synthetic grid */
+QByteArray multiplayerPacket(quint64 counter, int index, double rate)
+{
+  lfgc::MultiplayerPosition position;
+  position.callsign = "MP" + QByteArray::number(index);
+  position.model = synthetic::modelPath(index);
+  position.time = counter / rate;
+  synthetic::trafficPosition(counter, index, position.latY, position.lonX, position.altitudeFt);
+
+  // Grid moves by 0.0001 degree north and east for each counter step
+  double northKts = 0.0001 * rate * 60. * 3600.;
+  double eastKts = northKts * std::cos(position.latY * 3.14159265358979323846 / 180.);
+  position.groundSpeedKts = static_cast<float>(std::hypot(northKts, eastKts));
+  position.headingTrueDeg = static_cast<float>(std::atan2(eastKts, northKts) * 180. / 3.14159265358979323846);
+  return lfgc::encodeMultiplayerPosition(position);
+}
+
+QHostAddress resolve(const QString& host)
+{
+  QHostAddress address;
+  if(!address.setAddress(host))
+  {
+    QHostInfo info = QHostInfo::fromName(host);
+    if(!info.addresses().isEmpty())
+      address = info.addresses().constFirst();
+  }
+  return address;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("loadgen");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Synthetic FlightGear and multiplayer server load generator for Little FGconnect.");
+  parser.addHelpOption();
+
+  QCommandLineOption targetOpt({"t", "target"}, "Send datagrams to <host:port>. Default is localhost:7755.",
+                               "host:port", "localhost:7755");
+  QCommandLineOption rateOpt({"r", "rate"}, "Datagrams per second. Default is 20.", "hz", "20");
+  QCommandLineOption aiOpt({"a", "ai"}, "Number of AI objects per datagram. Default is 0.", "number", "0");
+  QCommandLineOption metadataPortOpt({"m", "metadata-port"},
+                                     "Use dual rate layouts and send metadata to <port> on the target host.", "port");
+  QCommandLineOption metadataRateOpt("metadata-rate", "Metadata datagrams per second. Default is 1.", "hz", "1");
+  QCommandLineOption serverPortOpt({"s", "mp-server-port"}, "Serve multiplayer pilot lists on TCP <port>.", "port");
+  QCommandLineOption pilotsOpt({"n", "pilots"}, "Number of pilots in each dump. Default is 1000.", "number", "1000");
+  QCommandLineOption websocketPortOpt({"w", "websocket-port"},
+                                      "Serve the property listener websocket on <port> at the datagram rate.", "port");
+  QCommandLineOption fragmentOpt({"f", "fragment-size"},
+                                 "Use the framed protocol and split datagrams into fragments of at most <bytes>.",
+                                 "bytes");
+  QCommandLineOption mpPortOpt("mp-port", "Send multiplayer position packets of all pilots to <port> on the "
+                                          "target host.", "port");
+  QCommandLineOption mpRateOpt("mp-rate", "Multiplayer packets per pilot and second. Default is 10.", "hz", "10");
+  QCommandLineOption durationOpt({"d", "duration"}, "Stop after <seconds>. Default is 0 which runs until killed.",
+                                 "seconds", "0");
+  parser.addOptions({targetOpt, rateOpt, aiOpt, metadataPortOpt, metadataRateOpt, serverPortOpt, pilotsOpt,
+                     websocketPortOpt, fragmentOpt, mpPortOpt, mpRateOpt, durationOpt});
+  parser.process(app);
+
+  QString target = parser.value(targetOpt);
+  QHostAddress address = resolve(target.section(':', 0, -2));
+  quint16 port = static_cast<quint16>(target.section(':', -1).toUInt());
+  if(address.isNull() || port == 0)
+  {
+    out << "Invalid target " << target << Qt::endl;
+    return 1;
+  }
+
+  double rate = std::max(parser.value(rateOpt).toDouble(), 0.1);
+  int numAi = parser.value(aiOpt).toInt();
+  quint16 metadataPort = static_cast<quint16>(parser.value(metadataPortOpt).toUInt());
+  double metadataRate = std::max(parser.value(metadataRateOpt).toDouble(), 0.1);
+  int numPilots = parser.value(pilotsOpt).toInt();
+  int fragmentSize = parser.value(fragmentOpt).toInt();
+
+  // Property listener replaces the generic protocol datagrams
+  bool websocketMode = parser.isSet(websocketPortOpt);
+
+  Counters counters, lastCounters;
+  QUdpSocket socket;
+
+  auto send = [&](const QByteArray& datagram, quint16 toPort) {
+    if(socket.writeDatagram(datagram, address, toPort) == datagram.size())
+    {
+      counters.datagrams++;
+      counters.bytes += static_cast<quint64>(datagram.size());
+      counters.largestDatagram = std::max(counters.largestDatagram, datagram.size());
+    }
+    else
+      // Usually exceeding the maximum datagram size with many AI objects
+      counters.errors++;
+  };
+
+  // Datagram sender =====================================
+  // Timer fires often and sends all datagrams that are due to keep the rate exact
+  QElapsedTimer elapsed;
+  elapsed.start();
+  quint64 numSent = 0, numMetadataSent = 0;
+
+  QTimer sendTimer;
+  sendTimer.setTimerType(Qt::PreciseTimer);
+  QObject::connect(&sendTimer, &QTimer::timeout, [&]() {
+    double seconds = elapsed.nsecsElapsed() / 1.e9;
+
+    int burst = 0;
+    while(!websocketMode && numSent < static_cast<quint64>(seconds * rate) && burst++ < MAX_BURST)
+    {
+      QByteArray datagram = metadataPort > 0 ?
+                            synthetic::kinematicsDatagram(numSent) :
+                            synthetic::combinedDatagram(numSent, numAi);
+
+      if(fragmentSize > 0)
+      {
+        for(const QByteArray& fragment : lfgc::FrameAssembler::split(datagram, static_cast<quint32>(numSent),
+                                                                     fragmentSize))
+          send(fragment, port);
+      }
+      else
+        send(datagram, port);
+      numSent++;
+    }
+
+    if(!websocketMode && metadataPort > 0 && numMetadataSent <= static_cast<quint64>(seconds * metadataRate))
+      send(synthetic::metadataDatagram(numMetadataSent++, numAi), metadataPort);
+  });
+  sendTimer.start(1);
+
+  // Property listener =====================================
+  QWebSocketServer websocketServer("loadgen", QWebSocketServer::NonSecureMode);
+  QVector<PropertyClient *> propertyClients;
+  quint64 numPropertyUpdates = 0;
+  if(websocketMode)
+  {
+    quint16 websocketPort = static_cast<quint16>(parser.value(websocketPortOpt).toUInt());
+    if(!websocketServer.listen(QHostAddress::Any, websocketPort))
+    {
+      out << "Cannot listen on " << websocketPort << ": " << websocketServer.errorString() << Qt::endl;
+      return 1;
+    }
+
+    QObject::connect(&websocketServer, &QWebSocketServer::newConnection, [&]() {
+      while(QWebSocket *socket = websocketServer.nextPendingConnection())
+      {
+        PropertyClient *client = new PropertyClient;
+        client->socket = socket;
+        propertyClients.append(client);
+
+        // Handle "addListener" and "get" like FlightGear
+        QObject::connect(socket, &QWebSocket::textMessageReceived, [&, client](const QString& text) {
+          QJsonObject command = QJsonDocument::fromJson(text.toUtf8()).object();
+          QString node = command.value("node").toString().remove("[0]");
+          QList<QByteArray> values = propertyValues(numPropertyUpdates);
+          for(int id = 0; id < lfgc::PROP_NUM_PROPERTIES; id++)
+          {
+            if(QString::fromLatin1(lfgc::PropertySubscriber::propertyPath(static_cast<lfgc::PropertyId>(id))).
+               remove("[0]") != node)
+              continue;
+
+            if(command.value("command").toString() == "addListener")
+              client->subscribed[id] = true;
+            else if(command.value("command").toString() == "get")
+              sendProperty(*client, id, values.at(id), counters);
+          }
+        });
+        QObject::connect(socket, &QWebSocket::disconnected, [&, client]() {
+          propertyClients.removeOne(client);
+          client->socket->deleteLater();
+          delete client;
+        });
+      }
+    });
+
+    // Push only changed values at the datagram rate
+    QObject::connect(&sendTimer, &QTimer::timeout, [&]() {
+      double seconds = elapsed.nsecsElapsed() / 1.e9;
+      if(numPropertyUpdates >= static_cast<quint64>(seconds * rate))
+        return;
+
+      QList<QByteArray> values = propertyValues(numPropertyUpdates++);
+      for(PropertyClient *client : propertyClients)
+      {
+        for(int id = 0; id < lfgc::PROP_NUM_PROPERTIES; id++)
+        {
+          if(client->subscribed.at(id) && client->lastSent.at(id) != values.at(id))
+            sendProperty(*client, id, values.at(id), counters);
+        }
+      }
+    });
+    out << "Serving property listener on port " << websocketPort << Qt::endl;
+  }
+
+  // Multiplayer server =====================================
+  QTcpServer server;
+  if(parser.isSet(serverPortOpt))
+  {
+    quint16 serverPort = static_cast<quint16>(parser.value(serverPortOpt).toUInt());
+    if(!server.listen(QHostAddress::Any, serverPort))
+    {
+      out << "Cannot listen on " << serverPort << ": " << server.errorString() << Qt::endl;
+      return 1;
+    }
+
+    QObject::connect(&server, &QTcpServer::newConnection, [&]() {
+      while(QTcpSocket *client = server.nextPendingConnection())
+      {
+        // Send the whole dump and close like the real server
+        QByteArray dump = synthetic::multiplayerDump(counters.dumps, numPilots);
+        client->write(dump);
+        client->disconnectFromHost();
+        QObject::connect(client, &QTcpSocket::disconnected, client, &QObject::deleteLater);
+
+        counters.dumps++;
+        counters.dumpBytes += static_cast<quint64>(dump.size());
+      }
+    });
+    out << "Serving " << numPilots << " pilots on port " << serverPort << Qt::endl;
+  }
+
+  // Multiplayer position packets =====================================
+  quint64 numMpSent = 0;
+  if(parser.isSet(mpPortOpt))
+  {
+    quint16 mpPort = static_cast<quint16>(parser.value(mpPortOpt).toUInt());
+    double mpRate = std::max(parser.value(mpRateOpt).toDouble(), 0.1);
+
+    QObject::connect(&sendTimer, &QTimer::timeout, [&, mpPort, mpRate]() {
+      double seconds = elapsed.nsecsElapsed() / 1.e9;
+      if(numMpSent >= static_cast<quint64>(seconds * mpRate))
+        return;
+
+      for(int i = 0; i < numPilots; i++)
+      {
+        if(socket.writeDatagram(multiplayerPacket(numMpSent, i, mpRate), address, mpPort) > 0)
+          counters.mpPackets++;
+        else
+          counters.errors++;
+      }
+      numMpSent++;
+    });
+    out << "Sending multiplayer packets of " << numPilots << " pilots to port " << mpPort << " at " << mpRate
+        << " Hz" << Qt::endl;
+  }
+
+  // Statistics once per second =====================================
+  QTimer statsTimer;
+  QObject::connect(&statsTimer, &QTimer::timeout, [&]() {
+    out << "datagrams/s " << counters.datagrams - lastCounters.datagrams
+        << " kB/s " << (counters.bytes - lastCounters.bytes) / 1024
+        << " largest " << counters.largestDatagram
+        << " errors " << counters.errors
+        << " dumps " << counters.dumps
+        << " properties/s " << counters.properties - lastCounters.properties
+        << " mp packets/s " << counters.mpPackets - lastCounters.mpPackets << Qt::endl;
+    lastCounters = counters;
+  });
+  statsTimer.start(1000);
+
+  int duration = parser.value(durationOpt).toInt();
+  if(duration > 0)
+    QTimer::singleShot(duration * 1000, &app, &QCoreApplication::quit);
+
+  out << "Sending to " << address.toString() << ":" << port << " at " << rate << " Hz with " << numAi
+      << " AI objects" << (metadataPort > 0 ? " using dual rate layouts" : "")
+      << (fragmentSize > 0 ? " framed" : "") << Qt::endl;
+
+  int result = app.exec();
+
+  out << "Total datagrams " << counters.datagrams << " bytes " << counters.bytes << " errors " << counters.errors
+      << " dumps " << counters.dumps << " dump bytes " << counters.dumpBytes
+      << " properties " << counters.properties << " mp packets " << counters.mpPackets << Qt::endl;
+  return result;
+}